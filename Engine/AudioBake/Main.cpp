@@ -0,0 +1,314 @@
+﻿// © 2025 Yanan Liu <yanan.liu0325@gmail.com>
+
+// Bakes WAV/MP3/FLAC/OGG sources into cooked PCM (.cpcm), which the engine loads without decoding.
+//
+//     AudioBake [--loop <startFrame> <endFrame>] [-o <output>] <input>...
+//     AudioBake --bank <output.cbank> [--compress] <file>...
+//
+// Each input is written next to itself with a .cpcm extension, -o names the output when baking a single file.
+// Without --loop, the loop points come from the input's .loop sidecar or its WAV smpl chunk.
+// --bank packs the files as they are into one sound bank, stored under the paths given on the command line.
+// --compress deflates the entries that get smaller, cooked PCM usually does
+
+#define DR_WAV_IMPLEMENTATION
+#define DR_FLAC_IMPLEMENTATION
+#define DR_MP3_IMPLEMENTATION
+#include "Application/Audio/AudioDecoder.h"
+#include "Application/Audio/CookedAudio.h"
+#include "Application/Audio/SoundBank.h"
+#include "Application/Audio/SoundId.h"
+#include "Zlib/zlib.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace Engine;
+
+// Frames decoded per read, MP3 can't tell its length up front so the PCM grows block by block
+static constexpr uint64_t kBlockFrames = 65536;
+
+static IAudio::EAudioFormat GetFormat(const std::string& path)
+{
+    std::string ext = path.substr(path.find_last_of('.') + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+
+    if (ext == "wav") return IAudio::EAudioFormat::kWav;
+    if (ext == "mp3") return IAudio::EAudioFormat::kMp3;
+    if (ext == "flac") return IAudio::EAudioFormat::kFlac;
+    if (ext == "ogg") return IAudio::EAudioFormat::kOgg;
+    return IAudio::EAudioFormat::kOthers;
+}
+
+static std::string GetCookedPath(const std::string& path)
+{
+    size_t dotPos = path.find_last_of('.');
+    size_t slashPos = path.find_last_of("/\\");
+    if (dotPos == std::string::npos || (slashPos != std::string::npos && dotPos < slashPos))
+    {
+        return path + ".cpcm";
+    }
+    return path.substr(0, dotPos) + ".cpcm";
+}
+
+static bool Bake(const std::string& input, const std::string& output, uint64_t loopStart, uint64_t loopEnd)
+{
+    AudioDecoder decoder;
+    if (!decoder.Open(input.c_str(), GetFormat(input)))
+    {
+        printf("Error: Failed to decode '%s'\n", input.c_str());
+        return false;
+    }
+
+    const uint32_t channels = decoder.GetChannels();
+    if (channels != 1 && channels != 2)
+    {
+        printf("Error: '%s' has %u channels, only mono and stereo are supported\n", input.c_str(), channels);
+        return false;
+    }
+
+    std::vector<int16_t> pcm;
+    pcm.reserve(static_cast<size_t>(decoder.GetTotalFrames()) * channels);
+    for (;;)
+    {
+        size_t offset = pcm.size();
+        pcm.resize(offset + static_cast<size_t>(kBlockFrames) * channels);
+        uint64_t framesRead = decoder.ReadFrames(pcm.data() + offset, kBlockFrames);
+        pcm.resize(offset + static_cast<size_t>(framesRead) * channels);
+        if (framesRead == 0) break;
+    }
+
+    const uint64_t frameCount = pcm.size() / channels;
+    if (frameCount == 0)
+    {
+        printf("Error: '%s' contains no valid audio data\n", input.c_str());
+        return false;
+    }
+
+    // Keep the loop points the source already has
+    if (loopEnd == 0)
+    {
+        EncodedAudio sidecar;
+        if (!sidecar.Map((input + kLoopSidecarExtension).c_str()) || !ParseLoopSidecar(sidecar, loopStart, loopEnd))
+        {
+            loopStart = decoder.GetLoopStart();
+            loopEnd = decoder.GetLoopEnd();
+        }
+        if (loopEnd == kLoopToEnd) loopEnd = frameCount;
+    }
+    if (loopEnd != 0 && (loopEnd > frameCount || loopStart >= loopEnd))
+    {
+        printf("Error: Loop %llu-%llu doesn't fit in the %llu frames of '%s'\n",
+            static_cast<unsigned long long>(loopStart), static_cast<unsigned long long>(loopEnd),
+            static_cast<unsigned long long>(frameCount), input.c_str());
+        return false;
+    }
+
+    CookedAudioHeader header = {};
+    std::memcpy(header.magic, kCookedAudioMagic, sizeof(kCookedAudioMagic));
+    header.version = kCookedAudioVersion;
+    header.sampleRate = decoder.GetSampleRate();
+    header.channels = static_cast<uint16_t>(channels);
+    header.bitsPerSample = 16;
+    header.frameCount = frameCount;
+    header.loopStart = loopEnd != 0 ? loopStart : 0;
+    header.loopEnd = loopEnd;
+
+    // The header is exactly one alignment block, so the samples start right after it
+    header.dataOffset = kCookedAudioAlignment;
+
+    std::ofstream file(output, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(pcm.data()), static_cast<std::streamsize>(pcm.size() * sizeof(int16_t)));
+    if (!file)
+    {
+        printf("Error: Failed to write '%s'\n", output.c_str());
+        return false;
+    }
+
+    printf("Baked '%s' -> '%s' (%llu frames, %u Hz, %u channels)\n", input.c_str(), output.c_str(),
+        static_cast<unsigned long long>(frameCount), header.sampleRate, channels);
+    return true;
+}
+
+static bool ReadWholeFile(const std::string& path, std::vector<uint8_t>& out)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file) return false;
+
+    out.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(out.data()), static_cast<std::streamsize>(out.size()));
+    return static_cast<bool>(file);
+}
+
+static uint64_t AlignUp(uint64_t value)
+{
+    return (value + kSoundBankAlignment - 1) & ~static_cast<uint64_t>(kSoundBankAlignment - 1);
+}
+
+static bool BuildBank(const std::vector<std::string>& inputs, const std::string& output, bool compress)
+{
+    struct BankFile
+    {
+        std::string path;
+        std::vector<uint8_t> data;
+        SoundBankEntry entry;
+    };
+
+    std::vector<BankFile> files(inputs.size());
+    for (size_t i = 0; i < inputs.size(); ++i)
+    {
+        BankFile& file = files[i];
+        file.path = inputs[i];
+        std::replace(file.path.begin(), file.path.end(), '\\', '/');
+
+        if (!ReadWholeFile(inputs[i], file.data))
+        {
+            printf("Error: Failed to read '%s'\n", inputs[i].c_str());
+            return false;
+        }
+
+        file.entry = {};
+        file.entry.pathHash = HashAudioPath(file.path);
+        file.entry.pathLength = static_cast<uint32_t>(file.path.size());
+        file.entry.size = file.data.size();
+        file.entry.storedSize = file.data.size();
+
+        // Keep the deflated form only when it actually saves space
+        if (compress && !file.data.empty())
+        {
+            uLongf compressedSize = compressBound(static_cast<uLong>(file.data.size()));
+            std::vector<uint8_t> compressed(compressedSize);
+            if (compress2(compressed.data(), &compressedSize, file.data.data(), static_cast<uLong>(file.data.size()),
+                Z_BEST_COMPRESSION) == Z_OK && compressedSize < file.data.size())
+            {
+                compressed.resize(compressedSize);
+                file.data = std::move(compressed);
+                file.entry.flags |= SoundBank::kCompressed;
+                file.entry.storedSize = compressedSize;
+            }
+        }
+    }
+
+    // The engine binary searches the table by hash
+    std::sort(files.begin(), files.end(), [](const BankFile& a, const BankFile& b) { return a.entry.pathHash < b.entry.pathHash; });
+    for (size_t i = 1; i < files.size(); ++i)
+    {
+        if (files[i].path == files[i - 1].path)
+        {
+            printf("Error: '%s' is listed twice\n", files[i].path.c_str());
+            return false;
+        }
+    }
+
+    SoundBankHeader header = {};
+    std::memcpy(header.magic, kSoundBankMagic, sizeof(kSoundBankMagic));
+    header.version = kSoundBankVersion;
+    header.entryCount = static_cast<uint32_t>(files.size());
+
+    uint64_t offset = sizeof(header) + files.size() * sizeof(SoundBankEntry);
+    for (BankFile& file : files)
+    {
+        file.entry.pathOffset = static_cast<uint32_t>(offset);
+        offset += file.path.size();
+    }
+    for (BankFile& file : files)
+    {
+        offset = AlignUp(offset);
+        file.entry.dataOffset = offset;
+        offset += file.data.size();
+    }
+
+    std::ofstream bank(output, std::ios::binary | std::ios::trunc);
+    bank.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const BankFile& file : files)
+    {
+        bank.write(reinterpret_cast<const char*>(&file.entry), sizeof(file.entry));
+    }
+    for (const BankFile& file : files)
+    {
+        bank.write(file.path.data(), static_cast<std::streamsize>(file.path.size()));
+    }
+
+    static const char kPadding[kSoundBankAlignment] = {};
+    uint64_t storedBytes = 0;
+    for (const BankFile& file : files)
+    {
+        uint64_t position = static_cast<uint64_t>(bank.tellp());
+        bank.write(kPadding, static_cast<std::streamsize>(file.entry.dataOffset - position));
+        bank.write(reinterpret_cast<const char*>(file.data.data()), static_cast<std::streamsize>(file.data.size()));
+        storedBytes += file.data.size();
+    }
+
+    if (!bank)
+    {
+        printf("Error: Failed to write '%s'\n", output.c_str());
+        return false;
+    }
+
+    printf("Packed %zu files into '%s' (%llu bytes of audio)\n", files.size(), output.c_str(),
+        static_cast<unsigned long long>(storedBytes));
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    uint64_t loopStart = 0;
+    uint64_t loopEnd = 0;
+    std::string output;
+    std::string bankOutput;
+    bool compress = false;
+    std::vector<std::string> inputs;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--bank") == 0 && i + 1 < argc)
+        {
+            bankOutput = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--compress") == 0)
+        {
+            compress = true;
+        }
+        else if (std::strcmp(argv[i], "--loop") == 0 && i + 2 < argc)
+        {
+            loopStart = std::strtoull(argv[++i], nullptr, 10);
+            loopEnd = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+        {
+            output = argv[++i];
+        }
+        else
+        {
+            inputs.push_back(argv[i]);
+        }
+    }
+
+    if (inputs.empty() || (!output.empty() && inputs.size() > 1))
+    {
+        printf("Usage: AudioBake [--loop <startFrame> <endFrame>] [-o <output>] <input>...\n");
+        printf("       AudioBake --bank <output.cbank> [--compress] <file>...\n");
+        printf("       -o can only be used with a single input\n");
+        return 1;
+    }
+
+    if (!bankOutput.empty())
+    {
+        return BuildBank(inputs, bankOutput, compress) ? 0 : 1;
+    }
+
+    int failures = 0;
+    for (const std::string& input : inputs)
+    {
+        if (!Bake(input, output.empty() ? GetCookedPath(input) : output, loopStart, loopEnd))
+        {
+            ++failures;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,494 @@
+﻿// © 2025 Yanan Liu <yanan.liu0325@gmail.com>
+
+// Measures the audio system so every change can be compared against a baseline.
+//
+//     AudioBench [-o <results.json>] [--backend loopback|software] [--time <seconds>] [<sound>...]
+//
+//   decode    MB/s of each sound decoded to PCM. Input MB/s counts the encoded file, PCM MB/s the samples it gives
+//   keys      ns per audio key lookup with 10, 1k and 10k registered paths
+//   trigger   PlaySoundEffect calls per second with N looping voices already playing, and the mixing cost of
+//             starting and retiring them
+//   memory    Resident PCM bytes per minute of audio for each sound
+//
+// Without sounds, a generated 10 s stereo WAV is used. The audio system renders on the loopback device, or into the
+// software mixer's null sink, as fast as the CPU allows: nothing is heard and the sound card doesn't matter.
+// --time is the minimum measured time per case, 0.5 s by default.
+// Results are one JSON document written to the -o file, AudioBench_results.json by default. The engine prints its
+// messages to stdout and the bench its own to stderr, so neither stream is meant to be parsed
+
+#include "Application/Audio/AudioAssets.h"
+#include "Application/Audio/AudioKeyIndex.h"
+#include "AL/dr_wav.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Engine;
+using Clock = std::chrono::steady_clock;
+
+// Generated sounds, removed again when the run ends
+static const char* kToneSound = "AudioBench_tone.wav";
+static const char* kClickSound = "AudioBench_click.wav";
+
+// Results file when -o isn't given
+static const char* kDefaultOutput = "AudioBench_results.json";
+
+// Registered paths for the key lookup case
+static const size_t kKeyCounts[] = { 10, 1000, 10000 };
+
+// Looping voices playing while the trigger case runs. Past the OpenAL source pool they are virtual
+static const uint32_t kLiveVoiceCounts[] = { 0, 32, 128, 512 };
+
+// PlaySoundEffect calls between two rendered ticks, the command queue holds 1024
+static constexpr uint32_t kTriggerBatch = 32;
+
+// One mixer tick at the default 5 ms interval
+static constexpr uint32_t kSampleRate = 48000;
+static constexpr uint32_t kTickFrames = kSampleRate / 200;
+
+// One measured value, written as a JSON object
+struct BenchResult
+{
+    std::string benchCase;
+    std::string name;
+    std::vector<std::pair<std::string, std::string>> fields;
+
+    // Default constructor
+    BenchResult(const char* benchCase, const std::string& name) : benchCase(benchCase), name(name) {}
+
+    BenchResult& Text(const char* key, const std::string& value);
+    BenchResult& Number(const char* key, double value);
+    BenchResult& Flag(const char* key, bool value);
+};
+
+static std::string EscapeJson(const std::string& text)
+{
+    std::string escaped;
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            escaped += '\\';
+            escaped += c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20)
+        {
+            char code[8];
+            snprintf(code, sizeof(code), "\\u%04x", static_cast<unsigned>(c));
+            escaped += code;
+        }
+        else
+        {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+BenchResult& BenchResult::Text(const char* key, const std::string& value)
+{
+    fields.emplace_back(key, "\"" + EscapeJson(value) + "\"");
+    return *this;
+}
+
+BenchResult& BenchResult::Number(const char* key, double value)
+{
+    char number[32];
+    snprintf(number, sizeof(number), "%.6g", std::isfinite(value) ? value : 0.0);
+    fields.emplace_back(key, number);
+    return *this;
+}
+
+BenchResult& BenchResult::Flag(const char* key, bool value)
+{
+    fields.emplace_back(key, value ? "true" : "false");
+    return *this;
+}
+
+static double SecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Call fn(i) in batches until minSeconds have passed, returns the seconds per call
+template <typename Fn>
+static double TimePerCall(double minSeconds, uint64_t batch, Fn&& fn)
+{
+    uint64_t calls = 0;
+    double elapsed = 0.0;
+    const Clock::time_point start = Clock::now();
+    do
+    {
+        for (uint64_t i = 0; i < batch; ++i)
+        {
+            fn(calls + i);
+        }
+        calls += batch;
+        elapsed = SecondsSince(start);
+    } while (elapsed < minSeconds);
+    return elapsed / static_cast<double>(calls);
+}
+
+static const char* GetFormatName(IAudio::EAudioFormat format)
+{
+    switch (format)
+    {
+    case IAudio::EAudioFormat::kWav: return "wav";
+    case IAudio::EAudioFormat::kMp3: return "mp3";
+    case IAudio::EAudioFormat::kFlac: return "flac";
+    case IAudio::EAudioFormat::kOgg: return "ogg";
+    case IAudio::EAudioFormat::kCooked: return "cpcm";
+    default: return "other";
+    }
+}
+
+static bool WriteTone(const char* path, uint32_t channels, uint32_t sampleRate, double seconds, double frequency)
+{
+    drwav_data_format format;
+    format.container = drwav_container_riff;
+    format.format = DR_WAVE_FORMAT_PCM;
+    format.channels = channels;
+    format.sampleRate = sampleRate;
+    format.bitsPerSample = 16;
+
+    drwav wav;
+    if (!drwav_init_file_write(&wav, path, &format, nullptr))
+    {
+        return false;
+    }
+
+    const uint64_t frameCount = static_cast<uint64_t>(seconds * sampleRate);
+    std::vector<int16_t> samples(static_cast<size_t>(frameCount) * channels);
+    for (uint64_t frame = 0; frame < frameCount; ++frame)
+    {
+        const double value = std::sin(6.283185307179586 * frequency * static_cast<double>(frame) / sampleRate);
+        for (uint32_t c = 0; c < channels; ++c)
+        {
+            samples[frame * channels + c] = static_cast<int16_t>(value * 12000.0);
+        }
+    }
+
+    const bool written = drwav_write_pcm_frames(&wav, frameCount, samples.data()) == frameCount;
+    drwav_uninit(&wav);
+    return written;
+}
+
+static void RemoveGeneratedSounds()
+{
+    std::remove(kToneSound);
+    std::remove(kClickSound);
+}
+
+static void BenchDecode(const std::vector<std::string>& sounds, double minSeconds, std::vector<BenchResult>& results)
+{
+    for (const std::string& sound : sounds)
+    {
+        EncodedAudio file;
+        if (!file.Map(sound.c_str()))
+        {
+            fprintf(stderr, "Error: Failed to open '%s'\n", sound.c_str());
+            continue;
+        }
+
+        const IAudio::EAudioFormat format = AudioAssets::GetFormat(sound.c_str());
+        DecodedAudio audio;
+        if (!AudioAssets::DecodeAudio(file, format, sound.c_str(), audio) || audio.channels == 0 || audio.sampleRate == 0)
+        {
+            fprintf(stderr, "Error: Failed to decode '%s'\n", sound.c_str());
+            continue;
+        }
+
+        // 16-bit PCM WAVs and cooked files aren't decoded at all, their samples are used in place
+        const double secondsPerDecode = TimePerCall(minSeconds, 1, [&](uint64_t)
+            {
+                DecodedAudio decoded;
+                AudioAssets::DecodeAudio(file, format, sound.c_str(), decoded);
+            });
+
+        const double pcmBytes = static_cast<double>(audio.GetSampleCount() * sizeof(int16_t));
+        const double duration = static_cast<double>(audio.GetSampleCount() / audio.channels) / audio.sampleRate;
+        results.emplace_back("decode", sound);
+        results.back()
+            .Text("format", GetFormatName(format))
+            .Number("inputMBps", static_cast<double>(file.size) / secondsPerDecode / (1024.0 * 1024.0))
+            .Number("pcmMBps", pcmBytes / secondsPerDecode / (1024.0 * 1024.0))
+            .Number("realtimeFactor", duration / secondsPerDecode)
+            .Number("msPerDecode", secondsPerDecode * 1000.0)
+            .Flag("inPlace", audio.mappedSamples != nullptr);
+    }
+}
+
+static void BenchKeys(double minSeconds, std::vector<BenchResult>& results)
+{
+    for (size_t count : kKeyCounts)
+    {
+        std::vector<std::string> paths(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            paths[i] = "Assets/Audio/Sounds/Bench/sound_" + std::to_string(i) + ".wav";
+        }
+
+        AudioKeyIndex index;
+        const Clock::time_point start = Clock::now();
+        for (const std::string& path : paths)
+        {
+            index.Acquire(path);
+        }
+        const double secondsPerRegister = SecondsSince(start) / static_cast<double>(count);
+
+        std::vector<SoundId> ids;
+        ids.reserve(count);
+        for (const std::string& path : paths)
+        {
+            ids.emplace_back(path);
+        }
+
+        // Paths are visited in a scattered order so the cache doesn't flatter large indexes
+        const uint64_t stride = 7919;
+        uint32_t checksum = 0;
+        const double secondsPerAcquire = TimePerCall(minSeconds, 1024, [&](uint64_t i)
+            {
+                checksum += index.Acquire(paths[(i * stride) % count]);
+            });
+        const double secondsPerFind = TimePerCall(minSeconds, 1024, [&](uint64_t i)
+            {
+                checksum += index.Find(paths[(i * stride) % count]);
+            });
+        const double secondsPerResolve = TimePerCall(minSeconds, 1024, [&](uint64_t i)
+            {
+                checksum += index.Resolve(ids[(i * stride) % count]);
+            });
+
+        results.emplace_back("keys", std::to_string(count) + " paths");
+        results.back()
+            .Number("paths", static_cast<double>(count))
+            .Number("nsPerRegister", secondsPerRegister * 1e9)
+            .Number("nsPerAcquire", secondsPerAcquire * 1e9)
+            .Number("nsPerFind", secondsPerFind * 1e9)
+            .Number("nsPerResolve", secondsPerResolve * 1e9)
+            .Number("checksum", checksum);
+    }
+}
+
+// Render one tick, or wait one if the backend mixes on its own thread
+static void RenderTick(IAudio& audio, std::vector<float>& scratch)
+{
+    if (!audio.RenderAudio(scratch.data(), kTickFrames))
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+}
+
+static bool WaitForLoad(IAudio& audio, const IAudio::AudioLoadHandle& load, std::vector<float>& scratch)
+{
+    while (load.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+    {
+        RenderTick(audio, scratch);
+    }
+    return load.get();
+}
+
+static void BenchMemory(IAudio& audio, const std::vector<std::string>& sounds, std::vector<BenchResult>& results,
+    std::vector<float>& scratch)
+{
+    for (const std::string& sound : sounds)
+    {
+        EncodedAudio file;
+        DecodedAudio decoded;
+        if (!file.Map(sound.c_str()) ||
+            !AudioAssets::DecodeAudio(file, AudioAssets::GetFormat(sound.c_str()), sound.c_str(), decoded) ||
+            decoded.channels == 0 || decoded.sampleRate == 0)
+        {
+            continue;
+        }
+        const double minutes = static_cast<double>(decoded.GetSampleCount() / decoded.channels) / decoded.sampleRate / 60.0;
+
+        const uint64_t before = audio.GetBufferCacheStats().residentBytes;
+        if (!WaitForLoad(audio, audio.LoadAudioAsync(sound.c_str()), scratch))
+        {
+            fprintf(stderr, "Error: Failed to load '%s'\n", sound.c_str());
+            continue;
+        }
+        const uint64_t resident = audio.GetBufferCacheStats().residentBytes - before;
+
+        results.emplace_back("memory", sound);
+        results.back()
+            .Text("format", GetFormatName(AudioAssets::GetFormat(sound.c_str())))
+            .Number("residentBytes", static_cast<double>(resident))
+            .Number("minutes", minutes)
+            .Number("bytesPerMinute", minutes > 0.0 ? static_cast<double>(resident) / minutes : 0.0);
+    }
+}
+
+static void BenchTrigger(IAudio& audio, double minSeconds, std::vector<BenchResult>& results, std::vector<float>& scratch)
+{
+    // Both sounds are resident first, the case measures playing them and not loading them
+    if (!WaitForLoad(audio, audio.LoadAudioAsync(kToneSound), scratch) ||
+        !WaitForLoad(audio, audio.LoadAudioAsync(kClickSound), scratch))
+    {
+        fprintf(stderr, "Error: Failed to load the trigger case sounds\n");
+        return;
+    }
+
+    for (uint32_t live : kLiveVoiceCounts)
+    {
+        for (uint32_t started = 0; started < live; started += kTriggerBatch)
+        {
+            for (uint32_t i = started; i < std::min(live, started + kTriggerBatch); ++i)
+            {
+                audio.PlaySoundEffect(kToneSound);
+            }
+            RenderTick(audio, scratch);
+        }
+        audio.OperateCurrentSounds(IAudio::EAudioAction::kLoop);
+        RenderTick(audio, scratch);
+
+        // Every batch of short clicks is started and mostly retired by the tick after it, so voices churn
+        // the whole time on top of the looping ones
+        uint64_t plays = 0;
+        uint64_t ticks = 0;
+        double triggerSeconds = 0.0;
+        double renderSeconds = 0.0;
+        const uint64_t exhaustedBefore = audio.GetSourcePoolStats().exhausted;
+        while (triggerSeconds + renderSeconds < minSeconds)
+        {
+            Clock::time_point start = Clock::now();
+            for (uint32_t i = 0; i < kTriggerBatch; ++i)
+            {
+                audio.PlaySoundEffect(kClickSound);
+            }
+            triggerSeconds += SecondsSince(start);
+            plays += kTriggerBatch;
+
+            start = Clock::now();
+            RenderTick(audio, scratch);
+            renderSeconds += SecondsSince(start);
+            ++ticks;
+        }
+        const IAudio::SourcePoolStats voices = audio.GetSourcePoolStats();
+
+        results.emplace_back("trigger", std::to_string(live) + " live voices");
+        results.back()
+            .Number("liveVoices", live)
+            .Number("callsPerSecond", static_cast<double>(plays) / triggerSeconds)
+            .Number("playsPerSecond", static_cast<double>(plays) / (triggerSeconds + renderSeconds))
+            .Number("msPerTick", renderSeconds / static_cast<double>(ticks) * 1000.0)
+            .Number("realtimeFactor", static_cast<double>(ticks * kTickFrames) / kSampleRate / renderSeconds)
+            .Number("voicesInUse", voices.inUse)
+            .Number("exhausted", static_cast<double>(voices.exhausted - exhaustedBefore));
+
+        audio.OperateCurrentSounds(IAudio::EAudioAction::kStop);
+        RenderTick(audio, scratch);
+    }
+}
+
+static void WriteResults(FILE* out, const char* backend, double minSeconds, const std::vector<BenchResult>& results)
+{
+    fprintf(out, "{\n  \"backend\": \"%s\",\n  \"minSeconds\": %g,\n  \"results\": [\n", backend, minSeconds);
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const BenchResult& result = results[i];
+        fprintf(out, "    { \"case\": \"%s\", \"name\": \"%s\"", result.benchCase.c_str(), EscapeJson(result.name).c_str());
+        for (const auto& field : result.fields)
+        {
+            fprintf(out, ", \"%s\": %s", field.first.c_str(), field.second.c_str());
+        }
+        fprintf(out, " }%s\n", i + 1 < results.size() ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+int main(int argc, char** argv)
+{
+    std::string output = kDefaultOutput;
+    std::string backend = "loopback";
+    double minSeconds = 0.5;
+    std::vector<std::string> sounds;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+        {
+            output = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--backend") == 0 && i + 1 < argc)
+        {
+            backend = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--time") == 0 && i + 1 < argc)
+        {
+            minSeconds = std::max(std::atof(argv[++i]), 0.01);
+        }
+        else
+        {
+            sounds.push_back(argv[i]);
+        }
+    }
+
+    if (backend != "loopback" && backend != "software")
+    {
+        fprintf(stderr, "Usage: AudioBench [-o <results.json>] [--backend loopback|software] [--time <seconds>] [<sound>...]\n");
+        return 1;
+    }
+
+    if (!WriteTone(kToneSound, 2, 44100, 10.0, 440.0) || !WriteTone(kClickSound, 1, 44100, 0.01, 2000.0))
+    {
+        fprintf(stderr, "Error: Failed to write the generated sounds\n");
+        RemoveGeneratedSounds();
+        return 1;
+    }
+    if (sounds.empty())
+    {
+        sounds.push_back(kToneSound);
+    }
+
+    IAudio::AudioSystemOptions options;
+    options.sampleRate = kSampleRate;
+    options.channels = 2;
+    if (backend == "software")
+    {
+        options.backend = IAudio::EAudioBackend::kSoftware;
+        options.sink = IAudio::EAudioSink::kNull;
+    }
+    else
+    {
+        options.backend = IAudio::EAudioBackend::kLoopback;
+    }
+
+    std::vector<BenchResult> results;
+    BenchDecode(sounds, minSeconds, results);
+    BenchKeys(minSeconds, results);
+    {
+        std::unique_ptr<IAudio> audio = IAudio::CreateAudioSystem(options);
+        if (!audio->Init())
+        {
+            fprintf(stderr, "Error: Failed to start the %s backend\n", backend.c_str());
+            RemoveGeneratedSounds();
+            return 1;
+        }
+
+        std::vector<float> scratch(static_cast<size_t>(kTickFrames) * options.channels);
+        BenchMemory(*audio, sounds, results, scratch);
+        BenchTrigger(*audio, minSeconds, results, scratch);
+    }
+
+    RemoveGeneratedSounds();
+
+    FILE* out = fopen(output.c_str(), "w");
+    if (!out)
+    {
+        fprintf(stderr, "Error: Failed to write '%s'\n", output.c_str());
+        return 1;
+    }
+    WriteResults(out, backend.c_str(), minSeconds, results);
+    fclose(out);
+    fprintf(stderr, "Results written to '%s'\n", output.c_str());
+    return 0;
+}
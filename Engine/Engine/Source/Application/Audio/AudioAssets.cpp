@@ -0,0 +1,544 @@
+﻿// © 2025 Yanan Liu <yanan.liu0325@gmail.com>
+
+#include "AudioAssets.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+namespace Engine
+{
+    // Frames decoded between two publishes to progressive voices, small enough that the first 100 ms come in quickly
+    static constexpr uint64_t kProgressiveBlockFrames = 2048;
+
+    AudioAssets::AudioAssets(AudioStatsRecorder* stats)
+        : m_Stats(stats)
+    {
+    }
+
+    bool AudioAssets::MountSoundBank(const char* filepath)
+    {
+        auto bank = std::make_shared<SoundBank>();
+        if (!bank->Open(filepath)) return false;
+
+        // Banks mounted later override earlier ones, like patches over the base content
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Banks.push_back(std::move(bank));
+        return true;
+    }
+
+    bool AudioAssets::LoadCompressedAudio(const char* filepath)
+    {
+        EncodedAudio file;
+        if (!Find(filepath, file))
+        {
+            printf("Error: Failed to open audio file '%s'\n", filepath);
+            return false;
+        }
+
+        // Copy out of the mapping so playing it never waits on the disk
+        auto bytes = std::make_shared<std::vector<uint8_t>>(file.data, file.data + file.size);
+        EncodedAudio resident;
+        resident.data = bytes->data();
+        resident.size = bytes->size();
+        resident.owner = std::move(bytes);
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_CompressedAudio[filepath] = std::move(resident);
+        return true;
+    }
+
+    void AudioAssets::FreeCompressedAudio(const char* filepath)
+    {
+        // Streams still decoding it keep their own reference
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_CompressedAudio.erase(filepath);
+    }
+
+    bool AudioAssets::EnableDecodedAudioCache(const char* directory, uint64_t maxBytes)
+    {
+        if (!directory)
+        {
+            m_DecodedCache.Close();
+            return true;
+        }
+        return m_DecodedCache.Open(directory, maxBytes);
+    }
+
+    bool AudioAssets::Open(const char* filepath, EAudioCategory category, EncodedAudio& out)
+    {
+        if (!Find(filepath, out))
+        {
+            printf("Error: Failed to open audio file '%s'\n", filepath);
+            return false;
+        }
+
+        // Loop points kept next to the asset override the ones inside it. Sound effects rarely loop,
+        // they only pick up sidecars packed into a bank or loaded with the asset
+        std::string sidecarPath = std::string(filepath) + kLoopSidecarExtension;
+        EncodedAudio sidecar;
+        bool found = category == EAudioCategory::kMusic ? Find(sidecarPath.c_str(), sidecar) :
+            FindInMemory(sidecarPath.c_str(), sidecar);
+        if (found && !ParseLoopSidecar(sidecar, out.loopStart, out.loopEnd))
+        {
+            printf("Warning: Ignoring malformed loop points in '%s'\n", sidecarPath.c_str());
+        }
+        return true;
+    }
+
+    bool AudioAssets::Find(const char* filepath, EncodedAudio& out)
+    {
+        return FindInMemory(filepath, out) || out.Map(filepath);
+    }
+
+    bool AudioAssets::FindInMemory(const char* filepath, EncodedAudio& out)
+    {
+        // Take the bank list under the lock and read outside it, inflating an entry can take a while
+        std::vector<std::shared_ptr<SoundBank>> banks;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            auto resident = m_CompressedAudio.find(filepath);
+            if (resident != m_CompressedAudio.end())
+            {
+                out = resident->second;
+                return true;
+            }
+            banks = m_Banks;
+        }
+
+        for (auto it = banks.rbegin(); it != banks.rend(); ++it)
+        {
+            if ((*it)->Read(filepath, out)) return true;
+        }
+        return false;
+    }
+
+    bool AudioAssets::Decode(const char* filepath, EAudioFormat format, EAudioCategory category, DecodedAudio& out)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        const bool decoded = DecodeFile(filepath, format, category, out);
+        if (m_Stats)
+        {
+            m_Stats->RecordDecode(format, std::chrono::steady_clock::now() - start, decoded);
+        }
+        return decoded;
+    }
+
+    bool AudioAssets::DecodeProgressive(const char* filepath, EAudioFormat format,
+        const std::shared_ptr<ProgressiveAudio>& progressive, DecodedAudio& out)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        const bool decoded = DecodeFileProgressive(filepath, format, progressive, out);
+        if (m_Stats)
+        {
+            m_Stats->RecordDecode(format, std::chrono::steady_clock::now() - start, decoded);
+        }
+        return decoded;
+    }
+
+    bool AudioAssets::DecodeFile(const char* filepath, EAudioFormat format, EAudioCategory category, DecodedAudio& out)
+    {
+        EncodedAudio file;
+        if (!Open(filepath, category, file)) return false;
+
+        if (!IsCacheable(format))
+        {
+            return DecodeAudio(file, format, filepath, out);
+        }
+
+        const uint64_t key = DecodedAudioCache::MakeKey(file, format);
+        if (FindCached(key, file, filepath, out)) return true;
+
+        if (!DecodeAudio(file, format, filepath, out)) return false;
+        m_DecodedCache.Store(key, file.size, out);
+        return true;
+    }
+
+    bool AudioAssets::IsCacheable(EAudioFormat format) const
+    {
+        // Only compressed formats are slow enough to decode to be worth caching
+        return (format == EAudioFormat::kMp3 || format == EAudioFormat::kFlac || format == EAudioFormat::kOgg) &&
+            m_DecodedCache.IsOpen();
+    }
+
+    bool AudioAssets::FindCached(uint64_t key, const EncodedAudio& file, const char* filepath, DecodedAudio& out)
+    {
+        EncodedAudio cached;
+        if (!m_DecodedCache.Find(key, file.size, cached)) return false;
+
+        // Loop points aren't cached, take the sidecar's
+        cached.loopStart = file.loopStart;
+        cached.loopEnd = file.loopEnd;
+        if (DecodeAudio(cached, EAudioFormat::kCooked, filepath, out)) return true;
+
+        out = DecodedAudio();
+        return false;
+    }
+
+    bool AudioAssets::DecodeFileProgressive(const char* filepath, EAudioFormat format,
+        const std::shared_ptr<ProgressiveAudio>& progressive, DecodedAudio& out)
+    {
+        EncodedAudio file;
+        if (!Open(filepath, EAudioCategory::kSound, file))
+        {
+            progressive->Finish(false);
+            return false;
+        }
+
+        // A sound already in the decoded cache is handed to the voices whole, there is nothing to wait for
+        const bool cacheable = IsCacheable(format);
+        const uint64_t key = cacheable ? DecodedAudioCache::MakeKey(file, format) : 0;
+        if (cacheable && FindCached(key, file, filepath, out) && (out.channels == 1 || out.channels == 2))
+        {
+            const uint64_t frames = out.GetSampleCount() / out.channels;
+            progressive->Begin(out.channels, out.sampleRate, frames);
+            progressive->Append(out.GetSamples(), frames);
+            progressive->Finish(true);
+            return true;
+        }
+        out = DecodedAudio();
+
+        AudioDecoder decoder;
+        if (!decoder.Open(file, format, filepath))
+        {
+            progressive->Finish(false);
+            return false;
+        }
+
+        const uint32_t channels = decoder.GetChannels();
+        if (channels != 1 && channels != 2)
+        {
+            printf("Error: Sound file '%s' has %u channels, only mono and stereo can be played.\n", filepath, channels);
+            progressive->Finish(false);
+            return false;
+        }
+
+        progressive->Begin(channels, decoder.GetSampleRate(), decoder.GetTotalFrames());
+
+        std::vector<int16_t> block(static_cast<size_t>(kProgressiveBlockFrames) * channels);
+        while (uint64_t framesRead = decoder.ReadFrames(block.data(), kProgressiveBlockFrames))
+        {
+            progressive->Append(block.data(), framesRead);
+        }
+
+        if (progressive->GetDecodedFrames() == 0)
+        {
+            printf("Error: Sound file '%s' contains no valid audio data.\n", filepath);
+            progressive->Finish(false);
+            return false;
+        }
+        progressive->Finish(true);
+
+        // The finished PCM becomes the sound's buffer as it is, the progressive voices are done writing to it
+        out.mappedSamples = progressive->GetSamples().data();
+        out.mappedSampleCount = progressive->GetSamples().size();
+        out.storage = progressive;
+        out.channels = channels;
+        out.sampleRate = decoder.GetSampleRate();
+
+        // Loop points from the sidecar or the file, the decoder already checked them against its length.
+        // MP3 may only know its length now
+        const uint64_t frames = progressive->GetDecodedFrames();
+        out.loopStart = decoder.GetLoopStart();
+        out.loopEnd = std::min(decoder.GetLoopEnd(), frames);
+        if (out.loopStart >= out.loopEnd)
+        {
+            out.loopStart = 0;
+            out.loopEnd = 0;
+        }
+
+        if (cacheable)
+        {
+            m_DecodedCache.Store(key, file.size, out);
+        }
+        return true;
+    }
+
+    bool AudioAssets::DecodeAudio(const EncodedAudio& file, EAudioFormat format, const char* filepath, DecodedAudio& out)
+    {
+        // Decode based on format
+        bool decoded = false;
+        switch (format)
+        {
+        case EAudioFormat::kWav:
+            decoded = DecodeWAVFile(file, filepath, out);
+            break;
+            
+        case EAudioFormat::kMp3:
+            decoded = DecodeMP3File(file, filepath, out);
+            break;
+            
+        case EAudioFormat::kFlac:
+            decoded = DecodeFLACFile(file, filepath, out);
+            break;
+
+        case EAudioFormat::kOgg:
+            decoded = DecodeOGGFile(file, filepath, out);
+            break;
+
+        case EAudioFormat::kCooked:
+            decoded = DecodeCookedFile(file, filepath, out);
+            break;
+            
+        default:
+			printf("Error: Unsupported audio format for file '%s'\n", filepath);
+            return false;
+        }
+        if (!decoded) return false;
+
+        // A sidecar wins over loop points stored in the file
+        if (file.loopEnd != 0)
+        {
+            out.loopStart = file.loopStart;
+            out.loopEnd = file.loopEnd;
+        }
+
+        // Drop a loop that doesn't fit the decoded track
+        if (out.loopEnd != 0)
+        {
+            out.loopEnd = std::min<uint64_t>(out.loopEnd, out.GetSampleCount() / out.channels);
+            if (out.loopStart >= out.loopEnd)
+            {
+                printf("Warning: Loop points of '%s' are outside the track, the whole track will loop\n", filepath);
+                out.loopStart = 0;
+                out.loopEnd = 0;
+            }
+        }
+        return true;
+    }
+
+    IAudio::EAudioFormat AudioAssets::GetFormat(const char* filepath)
+    {
+        std::string path(filepath);
+        std::string ext;
+
+        size_t dotPos = path.find_last_of('.');
+        if (dotPos != std::string::npos)
+        {
+            ext = path.substr(dotPos + 1);
+            // Convert to lowercase for comparison
+            std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        }
+
+        if (ext == "wav") return EAudioFormat::kWav;
+        if (ext == "ogg") return EAudioFormat::kOgg;
+        if (ext == "mp3") return EAudioFormat::kMp3;
+        if (ext == "flac") return EAudioFormat::kFlac;
+        if (ext == "mid" || ext == "midi") return EAudioFormat::kMidi;
+        if (ext == "mod") return EAudioFormat::kMod;
+        if (ext == "aiff") return EAudioFormat::kAiff;
+        if (ext == "raw") return EAudioFormat::kRaw;
+        if (ext == "cpcm") return EAudioFormat::kCooked;
+
+        return EAudioFormat::kOthers;
+    }
+
+    bool AudioAssets::DecodeWAVFile(const EncodedAudio& file, const char* filepath, DecodedAudio& out)
+    {
+        // Initialize WAV decoder
+        drwav wav;
+        if (!drwav_init_memory_with_metadata(&wav, file.data, file.size, 0, nullptr))
+        {
+            // Log error or handle failure
+            return false;
+        }
+
+        // Loop points from the smpl chunk, if the file has one
+        ReadWavLoopPoints(wav, out.loopStart, out.loopEnd);
+
+        // Little-endian 16-bit PCM is already what OpenAL wants, use it where it lies in the file.
+        // Samples that don't start on a 2-byte boundary can't be read in place and are copied below
+        bool littleEndian = wav.container == drwav_container_riff || wav.container == drwav_container_w64 ||
+            wav.container == drwav_container_rf64;
+        bool aligned = wav.dataChunkDataPos < file.size &&
+            reinterpret_cast<uintptr_t>(file.data + wav.dataChunkDataPos) % alignof(int16_t) == 0;
+        if (littleEndian && wav.translatedFormatTag == DR_WAVE_FORMAT_PCM && wav.bitsPerSample == 16 &&
+            (wav.channels == 1 || wav.channels == 2) && aligned)
+        {
+            uint64_t availableFrames = (file.size - wav.dataChunkDataPos) / (wav.channels * sizeof(int16_t));
+            uint64_t frames = std::min<uint64_t>(wav.totalPCMFrameCount, availableFrames);
+            if (frames < wav.totalPCMFrameCount)
+            {
+                printf("Warning: WAV file '%s' may be truncated. Expected %d frames but read %d.\n",
+                    filepath, static_cast<int>(wav.totalPCMFrameCount), static_cast<int>(frames));
+            }
+
+            out.mappedSamples = reinterpret_cast<const int16_t*>(file.data + wav.dataChunkDataPos);
+            out.mappedSampleCount = static_cast<size_t>(frames) * wav.channels;
+            out.storage = file.owner;
+            out.channels = wav.channels;
+            out.sampleRate = wav.sampleRate;
+            drwav_uninit(&wav);
+
+            if (frames == 0)
+            {
+                printf("Error: WAV file '%s' contains no valid audio data.\n", filepath);
+                return false;
+            }
+            return true;
+        }
+
+        // Allocate buffer for audio data
+        out.samples.resize(static_cast<size_t>(wav.totalPCMFrameCount) * wav.channels);
+        
+        // Read PCM frames as 16-bit signed integers
+        drwav_uint64 framesRead = drwav_read_pcm_frames_s16(&wav, wav.totalPCMFrameCount, out.samples.data());
+
+        // If framesRead == 0, it means no valid audio was read
+        if (framesRead == 0)
+        {
+			printf("Error: WAV file '%s' contains no valid audio data.\n", filepath);
+			drwav_uninit(&wav);
+            return false;
+        }
+
+        // check if framesRead < totalPCMFrameCount in case the file is truncated
+        if (framesRead < wav.totalPCMFrameCount)
+        {
+            // Log a warning instead of failing completely
+			printf("Warning: WAV file '%s' may be truncated. Expected %d frames but read %d.\n",
+				filepath, static_cast<int>(wav.totalPCMFrameCount), static_cast<int>(framesRead));
+            out.samples.resize(static_cast<size_t>(framesRead) * wav.channels);
+        }
+
+        out.channels = wav.channels;
+        out.sampleRate = wav.sampleRate;
+
+        // Clean up WAV decoder
+        drwav_uninit(&wav);
+        return true;
+    }
+
+    bool AudioAssets::DecodeMP3File(const EncodedAudio& file, const char* filepath, DecodedAudio& out)
+    {
+        // Initialize MP3 decoder
+        drmp3 mp3;
+        if (!drmp3_init_memory(&mp3, file.data, file.size, nullptr))
+        {
+            return false;
+        }
+
+        // Retrieve the total number of PCM frames
+        drmp3_uint64 totalPCMFrameCount = drmp3_get_pcm_frame_count(&mp3);
+        if (totalPCMFrameCount == 0)
+        {
+            drmp3_uninit(&mp3);
+            return false;
+        }
+
+        // Allocate a buffer for the PCM data
+        out.samples.resize(static_cast<size_t>(totalPCMFrameCount) * mp3.channels);
+
+        // Read the entire MP3 file into the PCM buffer
+        drmp3_uint64 framesRead = drmp3_read_pcm_frames_s16(
+            &mp3,
+            totalPCMFrameCount,
+            out.samples.data()
+        );
+
+        // If framesRead == 0, it means no valid audio was read
+        if (framesRead == 0)
+        {
+			printf("Error: MP3 file '%s' contains no valid audio data.\n", filepath);
+            drmp3_uninit(&mp3);
+            return false;
+        }
+
+        // check if framesRead < totalPCMFrameCount in case the file is truncated
+        if (framesRead < totalPCMFrameCount)
+        {
+            // Log a warning instead of failing completely
+			printf("Warning: MP3 file '%s' may be truncated. Expected %d frames but read %d.\n",
+				filepath, static_cast<int>(totalPCMFrameCount), static_cast<int>(framesRead));
+            out.samples.resize(static_cast<size_t>(framesRead) * mp3.channels);
+        }
+
+        out.channels = mp3.channels;
+        out.sampleRate = mp3.sampleRate;
+
+        // Clean up the MP3 decoder
+        drmp3_uninit(&mp3);
+        return true;
+    }
+
+    bool AudioAssets::DecodeFLACFile(const EncodedAudio& file, const char* filepath, DecodedAudio& out)
+    {
+        // Initialize FLAC decoder
+        drflac* flac = drflac_open_memory(file.data, file.size, nullptr);
+        if (!flac)
+        {
+            printf("Error: Failed to open FLAC file '%s'\n", filepath);
+            return false;
+        }
+
+        // Read PCM data
+        out.samples.resize(static_cast<size_t>(flac->totalPCMFrameCount) * flac->channels);
+        drflac_uint64 framesRead = drflac_read_pcm_frames_s16(flac, flac->totalPCMFrameCount, out.samples.data());
+        out.samples.resize(static_cast<size_t>(framesRead) * flac->channels);
+
+        out.channels = flac->channels;
+        out.sampleRate = flac->sampleRate;
+
+        // Cleanup
+        drflac_close(flac);
+
+        if (framesRead == 0)
+        {
+            printf("Error: FLAC file '%s' contains no valid audio data.\n", filepath);
+            return false;
+        }
+        return true;
+    }
+
+    bool AudioAssets::DecodeOGGFile(const EncodedAudio& file, const char* filepath, DecodedAudio& out)
+    {
+        // SFML's reader decodes Vorbis straight from memory
+        sf::InputSoundFile ogg;
+        if (!ogg.openFromMemory(file.data, file.size) || ogg.getChannelCount() == 0)
+        {
+            return false;
+        }
+
+        // SFML counts interleaved samples, not frames
+        out.samples.resize(static_cast<size_t>(ogg.getSampleCount()));
+        sf::Uint64 samplesRead = ogg.read(out.samples.data(), out.samples.size());
+        if (samplesRead == 0)
+        {
+            printf("Error: OGG file '%s' contains no valid audio data.\n", filepath);
+            return false;
+        }
+
+        if (samplesRead < ogg.getSampleCount())
+        {
+            printf("Warning: OGG file '%s' may be truncated. Expected %d frames but read %d.\n", filepath,
+                static_cast<int>(ogg.getSampleCount() / ogg.getChannelCount()), static_cast<int>(samplesRead / ogg.getChannelCount()));
+            out.samples.resize(static_cast<size_t>(samplesRead));
+        }
+
+        out.channels = ogg.getChannelCount();
+        out.sampleRate = ogg.getSampleRate();
+        return true;
+    }
+
+    bool AudioAssets::DecodeCookedFile(const EncodedAudio& file, const char* filepath, DecodedAudio& out)
+    {
+        // Baked offline, the samples are used exactly as they are in the file
+        CookedAudioHeader header;
+        const int16_t* samples = ReadCookedAudio(file.data, file.size, header);
+        if (!samples || header.frameCount == 0)
+        {
+            printf("Error: '%s' is not a valid cooked audio file\n", filepath);
+            return false;
+        }
+
+        out.mappedSamples = samples;
+        out.mappedSampleCount = static_cast<size_t>(header.frameCount) * header.channels;
+        out.storage = file.owner;
+        out.channels = header.channels;
+        out.sampleRate = header.sampleRate;
+        out.loopStart = header.loopStart;
+        out.loopEnd = header.loopEnd;
+        return true;
+    }
+}
@@ -0,0 +1,95 @@
+﻿// © 2025 Yanan Liu <yanan.liu0325@gmail.com>
+
+#pragma once
+
+#include "IAudio.h"
+#include "AudioDecoder.h"
+#include "SoundBank.h"
+#include "DecodedAudioCache.h"
+#include "ProgressiveSound.h"
+#include "AudioStatsRecorder.h"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Engine
+{
+    // Where audio files come from and how they become PCM, shared by the audio backends.
+    // Files are looked up among the resident compressed files, the mounted sound banks and then the disk,
+    // and compressed formats go through the decoded PCM cache once it is enabled. Safe on any thread,
+    // the decode workers use it while the owner mounts banks
+    class AudioAssets
+    {
+    public:
+        using EAudioFormat = IAudio::EAudioFormat;
+        using EAudioCategory = IAudio::EAudioCategory;
+
+        // Default constructor, decode times go to stats when given
+        explicit AudioAssets(AudioStatsRecorder* stats = nullptr);
+
+        AudioAssets(const AudioAssets&) = delete;
+        AudioAssets& operator=(const AudioAssets&) = delete;
+
+        // Backing for the IAudio calls of the same names
+        bool MountSoundBank(const char* filepath);
+        bool LoadCompressedAudio(const char* filepath);
+        void FreeCompressedAudio(const char* filepath);
+        bool EnableDecodedAudioCache(const char* directory, uint64_t maxBytes);
+
+        // Find the encoded file along with its loop sidecar, printing an error if it's missing.
+        // Sidecars are looked up among the resident files and banks, and on disk only for music,
+        // so loading a loose sound effect doesn't cost a failed file open
+        bool Open(const char* filepath, EAudioCategory category, EncodedAudio& out);
+
+        // Same lookup without the sidecar or the error message, for files that may be missing
+        bool Find(const char* filepath, EncodedAudio& out);
+
+        // Decode the whole file, through the decoded PCM cache for compressed formats
+        bool Decode(const char* filepath, EAudioFormat format, EAudioCategory category, DecodedAudio& out);
+
+        // Decode block by block, publishing each block to progressive before handing back the whole sound
+        bool DecodeProgressive(const char* filepath, EAudioFormat format, const std::shared_ptr<ProgressiveAudio>& progressive,
+            DecodedAudio& out);
+
+        // Decode a file already in memory, touches no member state
+        DLLEXP static bool DecodeAudio(const EncodedAudio& file, EAudioFormat format, const char* filepath, DecodedAudio& out);
+
+        // Format of a file from its extension
+        DLLEXP static EAudioFormat GetFormat(const char* filepath);
+
+    private:
+        // Find among the resident files and mounted banks only
+        bool FindInMemory(const char* filepath, EncodedAudio& out);
+
+        // True if the format goes through the decoded PCM cache and the cache is enabled
+        bool IsCacheable(EAudioFormat format) const;
+
+        // Load the file's PCM from the decoded cache, with the file's sidecar loop points. False on a miss
+        bool FindCached(uint64_t key, const EncodedAudio& file, const char* filepath, DecodedAudio& out);
+
+        // Decode and DecodeProgressive without the timing
+        bool DecodeFile(const char* filepath, EAudioFormat format, EAudioCategory category, DecodedAudio& out);
+        bool DecodeFileProgressive(const char* filepath, EAudioFormat format,
+            const std::shared_ptr<ProgressiveAudio>& progressive, DecodedAudio& out);
+
+        static bool DecodeWAVFile(const EncodedAudio& file, const char* filepath, DecodedAudio& out);
+        static bool DecodeMP3File(const EncodedAudio& file, const char* filepath, DecodedAudio& out);
+        static bool DecodeFLACFile(const EncodedAudio& file, const char* filepath, DecodedAudio& out);
+        static bool DecodeOGGFile(const EncodedAudio& file, const char* filepath, DecodedAudio& out);
+        static bool DecodeCookedFile(const EncodedAudio& file, const char* filepath, DecodedAudio& out);
+
+    private:
+        // Mounted sound banks, searched newest first, and files kept in memory still encoded
+        std::mutex m_Mutex;
+        std::vector<std::shared_ptr<SoundBank>> m_Banks;
+        std::unordered_map<std::string, EncodedAudio> m_CompressedAudio;
+
+        // Decoded PCM kept on disk between runs, off until EnableDecodedAudioCache
+        DecodedAudioCache m_DecodedCache;
+
+        // Owned by the backend, may be null
+        AudioStatsRecorder* m_Stats;
+    };
+}
@@ -0,0 +1,30 @@
+﻿// © 2025 Yanan Liu <yanan.liu0325@gmail.com>
+
+#pragma once
+
+#include "AL/al.h"
+#include <memory>
+
+namespace Engine
+{
+    // A loaded OpenAL buffer
+    struct AudioBuffer
+    {
+        // Buffer ID which helps to identify the sound dat
+        ALuint buffer;
+
+        // Length of the sound in seconds
+        float duration;
+
+        // Memory the samples are played from in place (AL_EXT_STATIC_BUFFER), must outlive the buffer
+        std::shared_ptr<const void> storage;
+
+        // Default constructor
+        AudioBuffer() : buffer(0), duration(0.0f) {}
+    };
+
+    // Reference to a loaded buffer held by the cache, every voice playing it and the buffered music.
+    // Freeing a sound only drops the cache's reference, the OpenAL buffer is deleted after the last
+    // voice lets go of it
+    using AudioBufferHandle = std::shared_ptr<AudioBuffer>;
+}
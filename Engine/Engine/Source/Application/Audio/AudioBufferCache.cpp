@@ -0,0 +1,102 @@
+﻿// © 2025 Yanan Liu <yanan.liu0325@gmail.com>
+
+#include "AudioBufferCache.h"
+
+namespace Engine
+{
+    AudioBufferCache::AudioBufferCache()
+        : m_Budget(kUnlimited)
+    {
+        for (uint64_t& budget : m_CategoryBudgets)
+        {
+            budget = kUnlimited;
+        }
+    }
+
+    void AudioBufferCache::Insert(uint32_t audioKey, uint64_t bytes, IAudio::EAudioCategory category)
+    {
+        Remove(audioKey);
+
+        m_Recency.push_front(audioKey);
+        m_Entries[audioKey] = { bytes, category, m_Recency.begin() };
+
+        m_Stats.residentBytes += bytes;
+        m_Stats.categoryBytes[static_cast<size_t>(category)] += bytes;
+        ++m_Stats.residentBuffers;
+    }
+
+    void AudioBufferCache::Remove(uint32_t audioKey)
+    {
+        auto it = m_Entries.find(audioKey);
+        if (it == m_Entries.end()) return;
+
+        m_Stats.residentBytes -= it->second.bytes;
+        m_Stats.categoryBytes[static_cast<size_t>(it->second.category)] -= it->second.bytes;
+        --m_Stats.residentBuffers;
+
+        m_Recency.erase(it->second.recency);
+        m_Entries.erase(it);
+    }
+
+    void AudioBufferCache::Evict(uint32_t audioKey)
+    {
+        Remove(audioKey);
+        ++m_Stats.evictions;
+    }
+
+    void AudioBufferCache::Touch(uint32_t audioKey)
+    {
+        auto it = m_Entries.find(audioKey);
+        if (it == m_Entries.end()) return;
+
+        ++m_Stats.hits;
+        m_Recency.splice(m_Recency.begin(), m_Recency, it->second.recency);
+    }
+
+    bool AudioBufferCache::IsOverBudget() const
+    {
+        if (Exceeds(m_Stats.residentBytes, m_Budget)) return true;
+
+        for (size_t i = 0; i < kCategoryCount; ++i)
+        {
+            if (Exceeds(m_Stats.categoryBytes[i], m_CategoryBudgets[i])) return true;
+        }
+        return false;
+    }
+
+    void AudioBufferCache::CollectEvictions(const std::function<bool(uint32_t audioKey)>& inUse, std::vector<uint32_t>& out) const
+    {
+        // Walk from the least recently used end, tracking what would stay resident
+        uint64_t total = m_Stats.residentBytes;
+        uint64_t categoryBytes[kCategoryCount];
+        bool categoryOver = false;
+        for (size_t i = 0; i < kCategoryCount; ++i)
+        {
+            categoryBytes[i] = m_Stats.categoryBytes[i];
+            categoryOver |= Exceeds(categoryBytes[i], m_CategoryBudgets[i]);
+        }
+
+        for (auto it = m_Recency.rbegin(); it != m_Recency.rend(); ++it)
+        {
+            bool totalOver = Exceeds(total, m_Budget);
+            if (!totalOver && !categoryOver) break;
+
+            const Entry& entry = m_Entries.at(*it);
+            size_t category = static_cast<size_t>(entry.category);
+
+            // Only evict what helps: anything while the total is over, otherwise just the categories that are
+            if (!totalOver && !Exceeds(categoryBytes[category], m_CategoryBudgets[category])) continue;
+            if (inUse(*it)) continue;
+
+            out.push_back(*it);
+            total -= entry.bytes;
+            categoryBytes[category] -= entry.bytes;
+
+            categoryOver = false;
+            for (size_t i = 0; i < kCategoryCount; ++i)
+            {
+                categoryOver |= Exceeds(categoryBytes[i], m_CategoryBudgets[i]);
+            }
+        }
+    }
+}
@@ -0,0 +1,80 @@
+﻿// © 2025 Yanan Liu <yanan.liu0325@gmail.com>
+
+#pragma once
+
+#include "IAudio.h"
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+namespace Engine
+{
+    // Bookkeeping for resident PCM buffers: bytes per category, recency and hit/miss counters.
+    // It doesn't own the OpenAL buffers, the owner deletes whatever CollectEvictions picks
+    class AudioBufferCache
+    {
+    public:
+        static constexpr size_t kCategoryCount = static_cast<size_t>(IAudio::EAudioCategory::kCount);
+
+        // Budget value meaning no limit
+        static constexpr uint64_t kUnlimited = 0;
+
+        // Default constructor
+        AudioBufferCache();
+
+        AudioBufferCache(const AudioBufferCache&) = delete;
+        AudioBufferCache& operator=(const AudioBufferCache&) = delete;
+
+        // Track a newly resident buffer as the most recently used
+        void Insert(uint32_t audioKey, uint64_t bytes, IAudio::EAudioCategory category);
+
+        // Forget a buffer that was freed explicitly
+        void Remove(uint32_t audioKey);
+
+        // Forget a buffer chosen by CollectEvictions
+        void Evict(uint32_t audioKey);
+
+        // A play found the buffer resident, make it the most recently used
+        void Touch(uint32_t audioKey);
+
+        // A play had to load its buffer
+        void RecordMiss() { ++m_Stats.misses; }
+
+        // True if the total or any category is above its budget
+        bool IsOverBudget() const;
+
+        // Pick buffers to evict, least recently used first, until everything fits its budget again.
+        // Buffers for which inUse returns true are skipped
+        void CollectEvictions(const std::function<bool(uint32_t audioKey)>& inUse, std::vector<uint32_t>& out) const;
+
+    public:
+        // --------------------------------------------------------------------- //
+        // Accessors & Mutators
+        // --------------------------------------------------------------------- //
+        void SetBudget(uint64_t bytes) { m_Budget = bytes; }
+        void SetBudget(IAudio::EAudioCategory category, uint64_t bytes) { m_CategoryBudgets[static_cast<size_t>(category)] = bytes; }
+        const IAudio::BufferCacheStats& GetStats() const { return m_Stats; }
+
+    private:
+        struct Entry
+        {
+            uint64_t bytes;
+            IAudio::EAudioCategory category;
+            std::list<uint32_t>::iterator recency;
+        };
+
+        static bool Exceeds(uint64_t bytes, uint64_t budget) { return budget != kUnlimited && bytes > budget; }
+
+    private:
+        std::unordered_map<uint32_t, Entry> m_Entries;
+
+        // Most recently used at the front
+        std::list<uint32_t> m_Recency;
+
+        uint64_t m_Budget;
+        uint64_t m_CategoryBudgets[kCategoryCount];
+        IAudio::BufferCacheStats m_Stats;
+    };
+}
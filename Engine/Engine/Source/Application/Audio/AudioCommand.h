@@ -0,0 +1,50 @@
+﻿// © 2025 Yanan Liu <yanan.liu0325@gmail.com>
+
+#pragma once
+
+#include "IAudio.h"
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+namespace Engine
+{
+    // A sound request made on any thread and applied on the audio thread. Plain data, so it can be
+    // copied through the lock-free command ring without allocating
+    struct AudioCommand
+    {
+        enum class EType : uint8_t
+        {
+            kPlaySound,         // Play the sound at path
+            kSetSoundVolume,    // Set every voice of the sound at path to value (0-100)
+            kOperateSounds      // Apply action to every sound effect
+        };
+
+        // Longest path a command can carry, keeps a command at 256 bytes
+        static constexpr size_t kMaxPathLength = 240;
+
+        IAudio::EAudioAction action;
+        int32_t value;
+        uint32_t hash;          // HashAudioPath of path, taken from the SoundId or hashed by the caller
+        uint16_t pathLength;
+        EType type;
+        char path[kMaxPathLength + 1];
+
+        std::string_view GetPath() const { return std::string_view(path, pathLength); }
+
+        // Copy the path into the command, returns false if it doesn't fit
+        bool SetPath(std::string_view filepath)
+        {
+            if (filepath.size() > kMaxPathLength) return false;
+
+            std::memcpy(path, filepath.data(), filepath.size());
+            path[filepath.size()] = '\0';
+            pathLength = static_cast<uint16_t>(filepath.size());
+            return true;
+        }
+    };
+
+    static_assert(std::is_trivially_copyable<AudioCommand>::value, "Audio commands are copied through a lock-free ring");
+    static_assert(sizeof(AudioCommand) == 256, "Keep audio commands to four cache lines");
+}
@@ -0,0 +1,95 @@
+﻿// © 2025 Yanan Liu <yanan.liu0325@gmail.com>
+
+#include "AudioDecodePool.h"
+#include <algorithm>
+
+namespace Engine
+{
+    AudioDecodePool::AudioDecodePool(DecodeFunction decode)
+        : m_Decode(std::move(decode))
+        , m_Exit(false)
+    {
+    }
+
+    AudioDecodePool::~AudioDecodePool()
+    {
+        Shutdown();
+    }
+
+    void AudioDecodePool::Start(unsigned workerCount)
+    {
+        if (!m_Workers.empty()) return;
+
+        if (workerCount == 0)
+        {
+            // Leave a core for the game thread, more than four decoders just fight over the disk
+            unsigned cores = std::thread::hardware_concurrency();
+            workerCount = std::max(1u, std::min(cores > 1 ? cores - 1 : 1u, 4u));
+        }
+
+        m_Exit = false;
+        for (unsigned i = 0; i < workerCount; ++i)
+        {
+            m_Workers.emplace_back(&AudioDecodePool::WorkerMain, this);
+        }
+    }
+
+    void AudioDecodePool::Shutdown()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_RequestMutex);
+            m_Exit = true;
+            m_Requests.clear();
+        }
+        m_RequestReady.notify_all();
+
+        for (std::thread& worker : m_Workers)
+        {
+            worker.join();
+        }
+        m_Workers.clear();
+    }
+
+    void AudioDecodePool::Submit(uint32_t audioKey, const char* filepath, IAudio::EAudioFormat format, IAudio::EAudioCategory category,
+        std::shared_ptr<ProgressiveAudio> progressive)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_RequestMutex);
+            m_Requests.push_back({ audioKey, filepath, format, category, std::move(progressive) });
+        }
+        m_RequestReady.notify_one();
+    }
+
+    bool AudioDecodePool::CollectResults(std::vector<Result>& out)
+    {
+        std::lock_guard<std::mutex> lock(m_ResultMutex);
+        if (m_Results.empty()) return false;
+
+        std::move(m_Results.begin(), m_Results.end(), std::back_inserter(out));
+        m_Results.clear();
+        return true;
+    }
+
+    void AudioDecodePool::WorkerMain()
+    {
+        for (;;)
+        {
+            Request request;
+            {
+                std::unique_lock<std::mutex> lock(m_RequestMutex);
+                m_RequestReady.wait(lock, [this] { return m_Exit || !m_Requests.empty(); });
+                if (m_Exit) return;
+
+                request = std::move(m_Requests.front());
+                m_Requests.pop_front();
+            }
+
+            Result result;
+            result.audioKey = request.audioKey;
+            result.success = m_Decode(request.filepath.c_str(), request.format, request.category, request.progressive, result.audio);
+
+            std::lock_guard<std::mutex> lock(m_ResultMutex);
+            m_Results.push_back(std::move(result));
+        }
+    }
+}
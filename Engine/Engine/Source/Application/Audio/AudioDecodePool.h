@@ -0,0 +1,83 @@
+﻿// © 2025 Yanan Liu <yanan.liu0325@gmail.com>
+
+#pragma once
+
+#include "AudioDecoder.h"
+#include "ProgressiveSound.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+namespace Engine
+{
+    // Worker threads decoding audio files to PCM off the caller's thread.
+    // Finished results are collected by the owner, which does the OpenAL upload itself
+    class AudioDecodePool
+    {
+    public:
+        // Decodes one file, must be safe to call from several threads at once. progressive is null unless the
+        // file was submitted for progressive playback, then the PCM is also published to it as it is decoded
+        using DecodeFunction = std::function<bool(const char* filepath, IAudio::EAudioFormat format, IAudio::EAudioCategory category,
+            const std::shared_ptr<ProgressiveAudio>& progressive, DecodedAudio& out)>;
+
+        // One decoded (or failed) file
+        struct Result
+        {
+            uint32_t audioKey;
+            bool success;
+            DecodedAudio audio;
+        };
+
+        // Default constructor
+        explicit AudioDecodePool(DecodeFunction decode);
+
+        // Default destructor, waits for the workers to finish their current file
+        ~AudioDecodePool();
+
+        AudioDecodePool(const AudioDecodePool&) = delete;
+        AudioDecodePool& operator=(const AudioDecodePool&) = delete;
+
+        // Spawn the workers, 0 picks a count from the number of cores
+        void Start(unsigned workerCount = 0);
+
+        // Drop queued requests and join the workers
+        void Shutdown();
+
+        // Queue a file for decoding, category picks how the file's sidecar is looked up
+        void Submit(uint32_t audioKey, const char* filepath, IAudio::EAudioFormat format, IAudio::EAudioCategory category,
+            std::shared_ptr<ProgressiveAudio> progressive = nullptr);
+
+        // Move every finished result into out, returns false if there was none
+        bool CollectResults(std::vector<Result>& out);
+
+    private:
+        struct Request
+        {
+            uint32_t audioKey;
+            std::string filepath;
+            IAudio::EAudioFormat format;
+            IAudio::EAudioCategory category;
+            std::shared_ptr<ProgressiveAudio> progressive;
+        };
+
+        void WorkerMain();
+
+    private:
+        DecodeFunction m_Decode;
+        std::vector<std::thread> m_Workers;
+
+        // Requests waiting for a worker
+        std::mutex m_RequestMutex;
+        std::condition_variable m_RequestReady;
+        std::deque<Request> m_Requests;
+        bool m_Exit;
+
+        // Results waiting for the owner
+        std::mutex m_ResultMutex;
+        std::vector<Result> m_Results;
+    };
+}
@@ -0,0 +1,275 @@
+﻿// © 2025 Yanan Liu <yanan.liu0325@gmail.com>
+
+#include "AudioDecoder.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+namespace Engine
+{
+    AudioDecoder::AudioDecoder()
+        : m_Format(IAudio::EAudioFormat::kOthers)
+        , m_Wav()
+        , m_Mp3()
+        , m_Flac(nullptr)
+        , m_CookedSamples(nullptr)
+        , m_CookedCursor(0)
+        , m_Channels(0)
+        , m_SampleRate(0)
+        , m_TotalFrames(0)
+        , m_LoopStart(0)
+        , m_LoopEnd(0)
+    {
+    }
+
+    AudioDecoder::~AudioDecoder()
+    {
+        Close();
+    }
+
+    bool EncodedAudio::Map(const char* filepath)
+    {
+        auto file = std::make_shared<MappedFile>();
+        if (!file->Open(filepath))
+        {
+            return false;
+        }
+
+        data = file->GetData();
+        size = file->GetSize();
+        owner = std::move(file);
+        return true;
+    }
+
+    bool AudioDecoder::Open(const char* filepath, IAudio::EAudioFormat format)
+    {
+        EncodedAudio file;
+        if (!file.Map(filepath))
+        {
+            printf("Error: Failed to open audio file '%s'\n", filepath);
+            return false;
+        }
+        return Open(file, format, filepath);
+    }
+
+    bool ReadWavLoopPoints(const drwav& wav, uint64_t& loopStart, uint64_t& loopEnd)
+    {
+        for (drwav_uint32 i = 0; i < wav.metadataCount; ++i)
+        {
+            const drwav_metadata& metadata = wav.pMetadata[i];
+            if (metadata.type != drwav_metadata_type_smpl || !metadata.data.smpl.pLoops) continue;
+
+            for (drwav_uint32 j = 0; j < metadata.data.smpl.sampleLoopCount; ++j)
+            {
+                // Despite dr_wav's field names these are frame indices, and the last one is played
+                const drwav_smpl_loop& loop = metadata.data.smpl.pLoops[j];
+                if (loop.type != drwav_smpl_loop_type_forward || loop.lastSampleByteOffset < loop.firstSampleByteOffset) continue;
+
+                loopStart = loop.firstSampleByteOffset;
+                loopEnd = static_cast<uint64_t>(loop.lastSampleByteOffset) + 1;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool ParseLoopSidecar(const EncodedAudio& sidecar, uint64_t& loopStart, uint64_t& loopEnd)
+    {
+        std::string text(reinterpret_cast<const char*>(sidecar.data), sidecar.size);
+        unsigned long long start = 0, end = 0;
+        if (std::sscanf(text.c_str(), "%llu %llu", &start, &end) != 2 || (end != 0 && start >= end))
+        {
+            return false;
+        }
+
+        loopStart = start;
+        loopEnd = end != 0 ? end : kLoopToEnd;
+        return true;
+    }
+
+    bool AudioDecoder::Open(const EncodedAudio& file, IAudio::EAudioFormat format, const char* name)
+    {
+        Close();
+        m_File = file;
+
+        switch (format)
+        {
+        case IAudio::EAudioFormat::kWav:
+            if (!drwav_init_memory_with_metadata(&m_Wav, m_File.data, m_File.size, 0, nullptr))
+            {
+                m_File = EncodedAudio();
+                return false;
+            }
+            m_Channels = m_Wav.channels;
+            m_SampleRate = m_Wav.sampleRate;
+            m_TotalFrames = m_Wav.totalPCMFrameCount;
+            ReadWavLoopPoints(m_Wav, m_LoopStart, m_LoopEnd);
+            break;
+
+        case IAudio::EAudioFormat::kMp3:
+            if (!drmp3_init_memory(&m_Mp3, m_File.data, m_File.size, nullptr))
+            {
+                m_File = EncodedAudio();
+                return false;
+            }
+            m_Channels = m_Mp3.channels;
+            m_SampleRate = m_Mp3.sampleRate;
+            m_TotalFrames = 0; // Counting MP3 frames requires decoding the whole file
+            break;
+
+        case IAudio::EAudioFormat::kFlac:
+            m_Flac = drflac_open_memory(m_File.data, m_File.size, nullptr);
+            if (!m_Flac)
+            {
+                m_File = EncodedAudio();
+                return false;
+            }
+            m_Channels = m_Flac->channels;
+            m_SampleRate = m_Flac->sampleRate;
+            m_TotalFrames = m_Flac->totalPCMFrameCount;
+            break;
+
+        case IAudio::EAudioFormat::kOgg:
+            m_Ogg = std::make_unique<sf::InputSoundFile>();
+            if (!m_Ogg->openFromMemory(m_File.data, m_File.size) || m_Ogg->getChannelCount() == 0)
+            {
+                m_Ogg.reset();
+                m_File = EncodedAudio();
+                return false;
+            }
+            m_Channels = m_Ogg->getChannelCount();
+            m_SampleRate = m_Ogg->getSampleRate();
+            m_TotalFrames = m_Ogg->getSampleCount() / m_Channels;
+            break;
+
+        case IAudio::EAudioFormat::kCooked:
+        {
+            CookedAudioHeader header;
+            m_CookedSamples = ReadCookedAudio(m_File.data, m_File.size, header);
+            if (!m_CookedSamples)
+            {
+                printf("Error: '%s' is not a valid cooked audio file\n", name);
+                m_File = EncodedAudio();
+                return false;
+            }
+            m_CookedCursor = 0;
+            m_Channels = header.channels;
+            m_SampleRate = header.sampleRate;
+            m_TotalFrames = header.frameCount;
+            m_LoopStart = header.loopStart;
+            m_LoopEnd = header.loopEnd;
+            break;
+        }
+
+        default:
+            printf("Error: Unsupported audio format for file '%s'\n", name);
+            m_File = EncodedAudio();
+            return false;
+        }
+
+        // A sidecar wins over loop points stored in the file
+        if (file.loopEnd != 0)
+        {
+            m_LoopStart = file.loopStart;
+            m_LoopEnd = file.loopEnd;
+        }
+
+        // Drop a loop that doesn't fit the track
+        if (m_TotalFrames != 0 && m_LoopEnd != 0)
+        {
+            m_LoopEnd = std::min(m_LoopEnd, m_TotalFrames);
+            if (m_LoopStart >= m_LoopEnd)
+            {
+                printf("Warning: Loop points of '%s' are outside the track, the whole track will loop\n", name);
+                m_LoopStart = 0;
+                m_LoopEnd = 0;
+            }
+        }
+
+        m_Format = format;
+        return true;
+    }
+
+    void AudioDecoder::Close()
+    {
+        switch (m_Format)
+        {
+        case IAudio::EAudioFormat::kWav:
+            drwav_uninit(&m_Wav);
+            break;
+        case IAudio::EAudioFormat::kMp3:
+            drmp3_uninit(&m_Mp3);
+            break;
+        case IAudio::EAudioFormat::kFlac:
+            drflac_close(m_Flac);
+            m_Flac = nullptr;
+            break;
+        case IAudio::EAudioFormat::kOgg:
+            m_Ogg.reset();
+            break;
+        case IAudio::EAudioFormat::kCooked:
+            m_CookedSamples = nullptr;
+            m_CookedCursor = 0;
+            break;
+        default:
+            break;
+        }
+
+        m_File = EncodedAudio();
+        m_Format = IAudio::EAudioFormat::kOthers;
+        m_Channels = 0;
+        m_SampleRate = 0;
+        m_TotalFrames = 0;
+        m_LoopStart = 0;
+        m_LoopEnd = 0;
+    }
+
+    uint64_t AudioDecoder::ReadFrames(int16_t* out, uint64_t frameCount)
+    {
+        switch (m_Format)
+        {
+        case IAudio::EAudioFormat::kWav:
+            return drwav_read_pcm_frames_s16(&m_Wav, frameCount, out);
+        case IAudio::EAudioFormat::kMp3:
+            return drmp3_read_pcm_frames_s16(&m_Mp3, frameCount, out);
+        case IAudio::EAudioFormat::kFlac:
+            return drflac_read_pcm_frames_s16(m_Flac, frameCount, out);
+        case IAudio::EAudioFormat::kOgg:
+            // SFML counts interleaved samples, not frames
+            return m_Ogg->read(out, frameCount * m_Channels) / m_Channels;
+        case IAudio::EAudioFormat::kCooked:
+        {
+            uint64_t frames = std::min(frameCount, m_TotalFrames - m_CookedCursor);
+            std::memcpy(out, m_CookedSamples + m_CookedCursor * m_Channels, static_cast<size_t>(frames) * m_Channels * sizeof(int16_t));
+            m_CookedCursor += frames;
+            return frames;
+        }
+        default:
+            return 0;
+        }
+    }
+
+    bool AudioDecoder::SeekToFrame(uint64_t frame)
+    {
+        switch (m_Format)
+        {
+        case IAudio::EAudioFormat::kWav:
+            return drwav_seek_to_pcm_frame(&m_Wav, frame) == DRWAV_TRUE;
+        case IAudio::EAudioFormat::kMp3:
+            return drmp3_seek_to_pcm_frame(&m_Mp3, frame) == DRMP3_TRUE;
+        case IAudio::EAudioFormat::kFlac:
+            return drflac_seek_to_pcm_frame(m_Flac, frame) == DRFLAC_TRUE;
+        case IAudio::EAudioFormat::kOgg:
+            if (frame > m_TotalFrames) return false;
+            m_Ogg->seek(frame * m_Channels);
+            return true;
+        case IAudio::EAudioFormat::kCooked:
+            if (frame > m_TotalFrames) return false;
+            m_CookedCursor = frame;
+            return true;
+        default:
+            return false;
+        }
+    }
+}
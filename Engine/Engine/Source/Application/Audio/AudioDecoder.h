@@ -0,0 +1,143 @@
+﻿// © 2025 Yanan Liu <yanan.liu0325@gmail.com>
+
+#pragma once
+
+#include "IAudio.h"
+#include "AL/dr_wav.h"
+#include "AL/dr_flac.h"
+#include "AL/dr_mp3.h"
+#include "SFML/Audio/InputSoundFile.hpp"
+#include "CookedAudio.h"
+#include "../../Utility/MappedFile.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Engine
+{
+    // Loop points can also come from a small text file next to the asset, "<path>.loop", holding
+    // "<loopStart> <loopEnd>" in frames. A loopEnd of 0 loops to the end of the track.
+    // Music finds it on disk too, sound effects only in a bank or loaded with LoadCompressedAudio
+    static constexpr const char* kLoopSidecarExtension = ".loop";
+
+    // loopEnd value meaning the loop runs to the end of the track, for decoders that can't tell its length
+    static constexpr uint64_t kLoopToEnd = UINT64_MAX;
+
+    // Contents of an encoded audio file in memory, with whatever keeps them alive
+    // (the file's mapping or an entry inflated out of a sound bank)
+    struct EncodedAudio
+    {
+        std::shared_ptr<const void> owner;
+        const uint8_t* data;
+        size_t size;
+
+        // Loop region from the asset's sidecar, loopEnd == 0 when there is none. Overrides loop points inside the file
+        uint64_t loopStart;
+        uint64_t loopEnd;
+
+        // Default constructor
+        EncodedAudio() : data(nullptr), size(0), loopStart(0), loopEnd(0) {}
+
+        // Map the file under the filepath, returns false if it can't be opened
+        DLLEXP bool Map(const char* filepath);
+    };
+
+    // Loop region of the first forward loop in a WAV's smpl chunk. The wav must have been opened with metadata
+    bool ReadWavLoopPoints(const drwav& wav, uint64_t& loopStart, uint64_t& loopEnd);
+
+    // Parse a loop sidecar, a loopEnd of 0 in the file comes back as kLoopToEnd
+    bool ParseLoopSidecar(const EncodedAudio& sidecar, uint64_t& loopStart, uint64_t& loopEnd);
+
+    // Fully decoded PCM waiting to be handed to alBufferData
+    struct DecodedAudio
+    {
+        // Interleaved 16-bit samples
+        std::vector<int16_t> samples;
+
+        // 16-bit PCM WAVs and cooked files skip decoding: the samples are used in place
+        // from the file's memory, which storage keeps alive
+        std::shared_ptr<const void> storage;
+        const int16_t* mappedSamples;
+        size_t mappedSampleCount;
+
+        uint32_t channels;
+        uint32_t sampleRate;
+
+        // Loop region in frames, loopEnd == 0 when the sound has none
+        uint64_t loopStart;
+        uint64_t loopEnd;
+
+        // Default constructor
+        DecodedAudio() : mappedSamples(nullptr), mappedSampleCount(0), channels(0), sampleRate(0), loopStart(0), loopEnd(0) {}
+
+        const int16_t* GetSamples() const { return mappedSamples ? mappedSamples : samples.data(); }
+        size_t GetSampleCount() const { return mappedSamples ? mappedSampleCount : samples.size(); }
+    };
+
+    // Incremental PCM decoder over dr_wav/dr_mp3/dr_flac, SFML's Vorbis reader and cooked PCM. Frames are always returned as interleaved 16-bit samples
+    class AudioDecoder
+    {
+    public:
+        // Default constructor
+        AudioDecoder();
+
+        // Default destructor
+        ~AudioDecoder();
+
+        AudioDecoder(const AudioDecoder&) = delete;
+        AudioDecoder& operator=(const AudioDecoder&) = delete;
+
+        // Open the file under the filepath with the decoder matching the format
+        bool Open(const char* filepath, IAudio::EAudioFormat format);
+
+        // Open a file already in memory, name is only used in error messages
+        bool Open(const EncodedAudio& file, IAudio::EAudioFormat format, const char* name);
+
+        // Close the decoder and release the file
+        void Close();
+
+        // Decode up to frameCount frames into out, returns the number of frames decoded (0 at the end of the stream)
+        uint64_t ReadFrames(int16_t* out, uint64_t frameCount);
+
+        // Move the read cursor to the target frame
+        bool SeekToFrame(uint64_t frame);
+
+    public:
+        // --------------------------------------------------------------------- //
+        // Accessors
+        // --------------------------------------------------------------------- //
+        bool IsOpen() const { return m_Format != IAudio::EAudioFormat::kOthers; }
+        uint32_t GetChannels() const { return m_Channels; }
+        uint32_t GetSampleRate() const { return m_SampleRate; }
+
+        // Total frame count, 0 if the decoder can't tell without scanning the whole file (MP3)
+        uint64_t GetTotalFrames() const { return m_TotalFrames; }
+
+        // Loop region in frames, GetLoopEnd() == 0 when the track has none. It may be kLoopToEnd for MP3
+        uint64_t GetLoopStart() const { return m_LoopStart; }
+        uint64_t GetLoopEnd() const { return m_LoopEnd; }
+
+    private:
+        // Format of the opened file, kOthers when nothing is open
+        IAudio::EAudioFormat m_Format;
+
+        // The decoders read straight from the file's memory
+        EncodedAudio m_File;
+
+        // Decoder states, only the one matching m_Format is valid
+        drwav m_Wav;
+        drmp3 m_Mp3;
+        drflac* m_Flac;
+        std::unique_ptr<sf::InputSoundFile> m_Ogg;    // Can't be closed and reopened, a new one per file
+
+        // Cooked files need no decoder, frames are copied out of the mapping
+        const int16_t* m_CookedSamples;
+        uint64_t m_CookedCursor;
+
+        uint32_t m_Channels;
+        uint32_t m_SampleRate;
+        uint64_t m_TotalFrames;
+        uint64_t m_LoopStart;
+        uint64_t m_LoopEnd;
+    };
+}
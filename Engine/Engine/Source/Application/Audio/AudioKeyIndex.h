@@ -0,0 +1,116 @@
+﻿// © 2025 Yanan Liu <yanan.liu0325@gmail.com>
+
+#pragma once
+
+#include "SoundId.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace Engine
+{
+	// Bidirectional audio path <-> key index. Every path is stored once; the path -> key side holds
+	// views into those strings, so looking up a path never allocates.
+	// A path's key is its HashAudioPath, so a compile-time SoundId already knows the key of its sound
+	class AudioKeyIndex
+	{
+	public:
+		// Key reserved for "no audio"
+		static constexpr uint32_t kInvalidKey = 0;
+
+		// Return the key of the path, registering it if it's new
+		uint32_t Acquire(std::string_view path) {
+			auto it = m_PathToKey.find(path);
+			if (it != m_PathToKey.end()) {
+				return it->second;
+			}
+
+			uint32_t newKey = HashAudioPath(path);
+
+			// Two paths with the same hash: move the newcomer to the next free key, its SoundId then resolves through the path
+			if (newKey == kInvalidKey || m_KeyToPath.find(newKey) != m_KeyToPath.end()) {
+				if (newKey != kInvalidKey) {
+					m_CollidedHashes.insert(newKey);
+					printf("Warning: audio path '%.*s' collides with '%s' (sound id %08x).\n",
+						static_cast<int>(path.size()), path.data(), m_KeyToPath[newKey].c_str(), newKey);
+				}
+				while (newKey == kInvalidKey || m_KeyToPath.find(newKey) != m_KeyToPath.end()) {
+					++newKey;
+				}
+			}
+
+			// Node-based map: the string never moves, so the view stays valid until Erase
+			const std::string& interned = m_KeyToPath.emplace(newKey, std::string(path)).first->second;
+			m_PathToKey.emplace(std::string_view(interned), newKey);
+			return newKey;
+		}
+
+		// Return the key of the path, kInvalidKey if it was never registered
+		uint32_t Find(std::string_view path) const {
+			auto it = m_PathToKey.find(path);
+			return it != m_PathToKey.end() ? it->second : kInvalidKey;
+		}
+
+		// Return the key of a sound id, kInvalidKey if its path was never registered.
+		// One integer probe and a compare of the interned path: only ids whose hash collided in Acquire,
+		// or whose key was taken by a path moved there, go through the path lookup
+		uint32_t Resolve(const SoundId& sound) const {
+			return Resolve(sound.GetHash(), sound.GetPath());
+		}
+
+		// Same with the path's HashAudioPath already known
+		uint32_t Resolve(uint32_t hash, std::string_view path) const {
+			if (!m_CollidedHashes.empty() && m_CollidedHashes.find(hash) != m_CollidedHashes.end()) {
+				return Find(path);
+			}
+
+			auto it = m_KeyToPath.find(hash);
+			if (it == m_KeyToPath.end()) {
+				return kInvalidKey;
+			}
+
+			// The key may belong to another path that collided elsewhere and was moved onto it
+			return std::string_view(it->second) == path ? hash : Find(path);
+		}
+
+		// Return the path of the key, empty if the key is unknown
+		const std::string& GetPath(uint32_t key) const {
+			static const std::string empty;
+			auto it = m_KeyToPath.find(key);
+			return it != m_KeyToPath.end() ? it->second : empty;
+		}
+
+		bool Contains(uint32_t key) const {
+			return m_KeyToPath.find(key) != m_KeyToPath.end();
+		}
+
+		size_t Size() const {
+			return m_KeyToPath.size();
+		}
+
+		// Forget the key
+		void Erase(uint32_t key) {
+			auto it = m_KeyToPath.find(key);
+			if (it == m_KeyToPath.end()) {
+				return;
+			}
+
+			// Drop the view before the string it points to
+			m_PathToKey.erase(std::string_view(it->second));
+			m_KeyToPath.erase(it);
+		}
+
+	private:
+		// Audio path key -> interned filepath
+		std::unordered_map<uint32_t, std::string> m_KeyToPath;
+
+		// Filepath (viewing m_KeyToPath) -> audio path key
+		std::unordered_map<std::string_view, uint32_t> m_PathToKey;
+
+		// Hashes shared by two registered paths, kept after Erase since either path may come back
+		std::unordered_set<uint32_t> m_CollidedHashes;
+	};
+}
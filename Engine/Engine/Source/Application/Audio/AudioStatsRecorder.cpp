@@ -0,0 +1,323 @@
+﻿// © 2025 Yanan Liu <yanan.liu0325@gmail.com>
+
+#include "AudioStatsRecorder.h"
+#include "AL/al.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+
+namespace Engine
+{
+    using EALError = IAudio::AudioStats::EALError;
+
+    static constexpr const char* kFormatNames[IAudio::AudioStats::kFormatCount] =
+    {
+        "command", "wav", "mod", "midi", "ogg", "mp3", "flac", "aiff", "raw", "cooked", "others"
+    };
+
+    static constexpr const char* kCategoryNames[static_cast<size_t>(IAudio::EAudioCategory::kCount)] =
+    {
+        "sound", "music"
+    };
+
+    static constexpr const char* kALErrorNames[static_cast<size_t>(EALError::kCount)] =
+    {
+        "invalidName", "invalidEnum", "invalidValue", "invalidOperation", "outOfMemory", "other"
+    };
+
+    AudioStatsRecorder::AudioStatsRecorder()
+        : m_RealVoices(0)
+        , m_VirtualVoices(0)
+        , m_PausedVoices(0)
+        , m_ProgressiveVoices(0)
+        , m_MusicTracks(0)
+        , m_ResidentBytes(0)
+        , m_CategoryBytes{}
+        , m_CacheHits(0)
+        , m_CacheMisses(0)
+        , m_Evictions(0)
+        , m_DroppedCommands(0)
+        , m_Ticks(0)
+        , m_ALErrors{}
+        , m_FailedSourceGens(0)
+        , m_DumpInterval(0)
+        , m_HasPendingDump(false)
+        , m_DumpThreadExit(false)
+        , m_DumpFailed(false)
+    {
+    }
+
+    AudioStatsRecorder::~AudioStatsRecorder()
+    {
+        if (m_DumpThread.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_DumpMutex);
+                m_DumpThreadExit = true;
+            }
+            m_DumpReady.notify_one();
+            m_DumpThread.join();
+        }
+    }
+
+    void AudioStatsRecorder::RecordDecode(IAudio::EAudioFormat format, std::chrono::steady_clock::duration elapsed, bool success)
+    {
+        DecodeCounters& counters = m_Decode[static_cast<size_t>(format)];
+        if (!success)
+        {
+            counters.failures.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        const uint64_t microseconds = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+        counters.decodes.fetch_add(1, std::memory_order_relaxed);
+        counters.totalMicroseconds.fetch_add(microseconds, std::memory_order_relaxed);
+
+        uint64_t max = counters.maxMicroseconds.load(std::memory_order_relaxed);
+        while (microseconds > max &&
+            !counters.maxMicroseconds.compare_exchange_weak(max, microseconds, std::memory_order_relaxed))
+        {
+        }
+
+        // Bucket n > 0 holds [2^(n-1), 2^n) ms, the last one everything from 512 ms up
+        size_t bucket = 0;
+        for (uint64_t milliseconds = microseconds / 1000; milliseconds > 0 && bucket < AudioStats::kDecodeBuckets - 1;
+            milliseconds >>= 1)
+        {
+            ++bucket;
+        }
+        counters.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void AudioStatsRecorder::SetVoiceCounts(uint32_t realVoices, uint32_t virtualVoices, uint32_t pausedVoices,
+        uint32_t progressiveVoices, uint32_t musicTracks)
+    {
+        m_RealVoices.store(realVoices, std::memory_order_relaxed);
+        m_VirtualVoices.store(virtualVoices, std::memory_order_relaxed);
+        m_PausedVoices.store(pausedVoices, std::memory_order_relaxed);
+        m_ProgressiveVoices.store(progressiveVoices, std::memory_order_relaxed);
+        m_MusicTracks.store(musicTracks, std::memory_order_relaxed);
+    }
+
+    void AudioStatsRecorder::SetBufferCache(const IAudio::BufferCacheStats& cache)
+    {
+        m_ResidentBytes.store(cache.residentBytes, std::memory_order_relaxed);
+        for (size_t i = 0; i < static_cast<size_t>(IAudio::EAudioCategory::kCount); ++i)
+        {
+            m_CategoryBytes[i].store(cache.categoryBytes[i], std::memory_order_relaxed);
+        }
+        m_CacheHits.store(cache.hits, std::memory_order_relaxed);
+        m_CacheMisses.store(cache.misses, std::memory_order_relaxed);
+        m_Evictions.store(cache.evictions, std::memory_order_relaxed);
+    }
+
+    IAudio::AudioStats AudioStatsRecorder::Snapshot() const
+    {
+        AudioStats stats;
+        for (size_t f = 0; f < AudioStats::kFormatCount; ++f)
+        {
+            const DecodeCounters& counters = m_Decode[f];
+            AudioStats::DecodeTimes& times = stats.decode[f];
+            times.decodes = counters.decodes.load(std::memory_order_relaxed);
+            times.failures = counters.failures.load(std::memory_order_relaxed);
+            times.totalMicroseconds = counters.totalMicroseconds.load(std::memory_order_relaxed);
+            times.maxMicroseconds = counters.maxMicroseconds.load(std::memory_order_relaxed);
+            for (size_t b = 0; b < AudioStats::kDecodeBuckets; ++b)
+            {
+                times.buckets[b] = counters.buckets[b].load(std::memory_order_relaxed);
+            }
+        }
+
+        stats.realVoices = m_RealVoices.load(std::memory_order_relaxed);
+        stats.virtualVoices = m_VirtualVoices.load(std::memory_order_relaxed);
+        stats.pausedVoices = m_PausedVoices.load(std::memory_order_relaxed);
+        stats.progressiveVoices = m_ProgressiveVoices.load(std::memory_order_relaxed);
+        stats.musicTracks = m_MusicTracks.load(std::memory_order_relaxed);
+
+        stats.residentBytes = m_ResidentBytes.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < static_cast<size_t>(IAudio::EAudioCategory::kCount); ++i)
+        {
+            stats.categoryBytes[i] = m_CategoryBytes[i].load(std::memory_order_relaxed);
+        }
+        stats.cacheHits = m_CacheHits.load(std::memory_order_relaxed);
+        stats.cacheMisses = m_CacheMisses.load(std::memory_order_relaxed);
+        stats.evictions = m_Evictions.load(std::memory_order_relaxed);
+
+        for (size_t i = 0; i < static_cast<size_t>(EALError::kCount); ++i)
+        {
+            stats.alErrors[i] = m_ALErrors[i].load(std::memory_order_relaxed);
+        }
+        stats.failedSourceGens = m_FailedSourceGens.load(std::memory_order_relaxed);
+
+        stats.droppedCommands = m_DroppedCommands.load(std::memory_order_relaxed);
+        stats.ticks = m_Ticks.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    void AudioStatsRecorder::UpdateDump()
+    {
+        if (m_DumpPath.empty()) return;
+
+        // The dump thread failed to write the file and has already said so
+        if (m_DumpFailed.load(std::memory_order_relaxed))
+        {
+            m_DumpPath.clear();
+            return;
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        if (now < m_NextDump) return;
+
+        // The dump thread only holds the lock to copy a snapshot out, never while it writes
+        std::unique_lock<std::mutex> lock(m_DumpMutex, std::try_to_lock);
+        if (!lock.owns_lock()) return;
+
+        m_NextDump = now + m_DumpInterval;
+        m_PendingDump = Snapshot();
+        m_HasPendingDump = true;
+        lock.unlock();
+        m_DumpReady.notify_one();
+    }
+
+    void AudioStatsRecorder::SetDump(const char* filepath, int intervalMs)
+    {
+        const bool enabled = filepath && intervalMs > 0;
+        m_DumpPath = enabled ? filepath : "";
+        if (enabled)
+        {
+            m_DumpInterval = std::chrono::milliseconds(intervalMs);
+            m_NextDump = std::chrono::steady_clock::now() + m_DumpInterval;
+        }
+
+        // A snapshot not written yet was meant for the previous file
+        {
+            std::lock_guard<std::mutex> lock(m_DumpMutex);
+            m_PendingDumpPath = m_DumpPath;
+            m_HasPendingDump = false;
+        }
+        m_DumpFailed.store(false, std::memory_order_relaxed);
+
+        if (enabled && !m_DumpThread.joinable())
+        {
+            m_DumpThread = std::thread(&AudioStatsRecorder::DumpThreadMain, this);
+        }
+    }
+
+    void AudioStatsRecorder::DumpThreadMain()
+    {
+        std::unique_lock<std::mutex> lock(m_DumpMutex);
+        while (true)
+        {
+            m_DumpReady.wait(lock, [this] { return m_HasPendingDump || m_DumpThreadExit; });
+            if (m_DumpThreadExit) return;
+
+            // Copied out so the next snapshot can be handed over while this one is written
+            const AudioStats stats = m_PendingDump;
+            const std::string filepath = m_PendingDumpPath;
+            m_HasPendingDump = false;
+
+            lock.unlock();
+            const bool written = WriteJson(stats, filepath.c_str());
+            lock.lock();
+
+            // Unless the dump moved to another file meanwhile, that one gets its own chance
+            if (!written && filepath == m_PendingDumpPath)
+            {
+                printf("Warning: Failed to write audio stats to '%s', stopping the dump\n", filepath.c_str());
+                m_DumpFailed.store(true, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool AudioStatsRecorder::WriteJson(const AudioStats& stats, const char* filepath)
+    {
+        // Written under a temporary name and renamed, whatever polls the file never reads half of it
+        const std::string tempPath = std::string(filepath) + ".tmp";
+        {
+            std::ofstream file(tempPath, std::ios::trunc);
+            file << "{\n";
+            file << "  \"ticks\": " << stats.ticks << ",\n";
+            file << "  \"droppedCommands\": " << stats.droppedCommands << ",\n";
+
+            file << "  \"voices\": { \"real\": " << stats.realVoices << ", \"virtual\": " << stats.virtualVoices
+                << ", \"paused\": " << stats.pausedVoices << ", \"progressive\": " << stats.progressiveVoices
+                << ", \"music\": " << stats.musicTracks << " },\n";
+
+            file << "  \"memory\": { \"residentBytes\": " << stats.residentBytes;
+            for (size_t i = 0; i < static_cast<size_t>(IAudio::EAudioCategory::kCount); ++i)
+            {
+                file << ", \"" << kCategoryNames[i] << "\": " << stats.categoryBytes[i];
+            }
+            file << " },\n";
+
+            file << "  \"cache\": { \"hits\": " << stats.cacheHits << ", \"misses\": " << stats.cacheMisses
+                << ", \"evictions\": " << stats.evictions << " },\n";
+
+            file << "  \"alErrors\": {";
+            for (size_t i = 0; i < static_cast<size_t>(EALError::kCount); ++i)
+            {
+                file << (i ? ", \"" : " \"") << kALErrorNames[i] << "\": " << stats.alErrors[i];
+            }
+            file << " },\n";
+            file << "  \"failedSourceGens\": " << stats.failedSourceGens << ",\n";
+
+            // Upper bound of each bucket in milliseconds, the last one has none
+            file << "  \"decodeBucketLimitsMs\": [";
+            for (size_t b = 0; b + 1 < AudioStats::kDecodeBuckets; ++b)
+            {
+                file << (b ? ", " : "") << (1u << b);
+            }
+            file << "],\n";
+
+            // Only the formats that have been decoded
+            file << "  \"decode\": {";
+            bool first = true;
+            for (size_t f = 0; f < AudioStats::kFormatCount; ++f)
+            {
+                const AudioStats::DecodeTimes& times = stats.decode[f];
+                if (times.decodes == 0 && times.failures == 0) continue;
+
+                file << (first ? "\n" : ",\n") << "    \"" << kFormatNames[f] << "\": { \"decodes\": " << times.decodes
+                    << ", \"failures\": " << times.failures << ", \"totalMicroseconds\": " << times.totalMicroseconds
+                    << ", \"maxMicroseconds\": " << times.maxMicroseconds << ", \"buckets\": [";
+                for (size_t b = 0; b < AudioStats::kDecodeBuckets; ++b)
+                {
+                    file << (b ? ", " : "") << times.buckets[b];
+                }
+                file << "] }";
+                first = false;
+            }
+            file << (first ? "}\n" : "\n  }\n");
+            file << "}\n";
+
+            if (!file) return false;
+        }
+
+        std::error_code error;
+        std::filesystem::rename(tempPath, filepath, error);
+        if (error)
+        {
+            std::filesystem::remove(tempPath, error);
+            return false;
+        }
+        return true;
+    }
+
+    int AudioStatsRecorder::TakeALError()
+    {
+        const ALenum error = alGetError();
+        if (error == AL_NO_ERROR) return error;
+
+        EALError kind = EALError::kOther;
+        switch (error)
+        {
+        case AL_INVALID_NAME: kind = EALError::kInvalidName; break;
+        case AL_INVALID_ENUM: kind = EALError::kInvalidEnum; break;
+        case AL_INVALID_VALUE: kind = EALError::kInvalidValue; break;
+        case AL_INVALID_OPERATION: kind = EALError::kInvalidOperation; break;
+        case AL_OUT_OF_MEMORY: kind = EALError::kOutOfMemory; break;
+        }
+        m_ALErrors[static_cast<size_t>(kind)].fetch_add(1, std::memory_order_relaxed);
+        return error;
+    }
+}
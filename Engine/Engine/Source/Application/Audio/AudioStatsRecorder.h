@@ -0,0 +1,111 @@
+﻿// © 2025 Yanan Liu <yanan.liu0325@gmail.com>
+
+#pragma once
+
+#include "IAudio.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace Engine
+{
+    // Live counters behind IAudio::AudioStats. Every update is a relaxed atomic add or store, so decode workers,
+    // game threads calling into the audio system and the audio thread record without taking a lock, and a
+    // snapshot never waits for any of them
+    class AudioStatsRecorder
+    {
+    public:
+        using AudioStats = IAudio::AudioStats;
+
+        // Default constructor
+        AudioStatsRecorder();
+
+        // Default destructor, waits for a dump being written
+        ~AudioStatsRecorder();
+
+        AudioStatsRecorder(const AudioStatsRecorder&) = delete;
+        AudioStatsRecorder& operator=(const AudioStatsRecorder&) = delete;
+
+        // Any thread
+        void RecordDecode(IAudio::EAudioFormat format, std::chrono::steady_clock::duration elapsed, bool success);
+        void RecordDroppedCommand() { m_DroppedCommands.fetch_add(1, std::memory_order_relaxed); }
+
+        // Gauges, set by the audio thread at the end of every tick
+        void SetVoiceCounts(uint32_t realVoices, uint32_t virtualVoices, uint32_t pausedVoices, uint32_t progressiveVoices,
+            uint32_t musicTracks);
+        void SetBufferCache(const IAudio::BufferCacheStats& cache);
+        void RecordTick() { m_Ticks.fetch_add(1, std::memory_order_relaxed); }
+
+        AudioStats Snapshot() const;
+
+        // Take a snapshot for the dump file when its interval has passed, the dump thread writes it. Never blocks on the
+        // file, a snapshot due while the previous one is still being handed over waits for the next tick.
+        // Run with the audio mutex held, like SetDump
+        void UpdateDump();
+        void SetDump(const char* filepath, int intervalMs);
+
+        // Write the stats as a JSON object, false if the file can't be written
+        static bool WriteJson(const AudioStats& stats, const char* filepath);
+
+        // Read and clear OpenAL's error state like alGetError, counting the error if there was one
+        int TakeALError();
+
+        // Count an alGenSources call that failed
+        void RecordFailedSourceGen() { m_FailedSourceGens.fetch_add(1, std::memory_order_relaxed); }
+
+    private:
+        // Dump thread loop, writes each snapshot handed over until told to exit
+        void DumpThreadMain();
+
+    private:
+        struct DecodeCounters
+        {
+            std::atomic<uint64_t> decodes{ 0 };
+            std::atomic<uint64_t> failures{ 0 };
+            std::atomic<uint64_t> totalMicroseconds{ 0 };
+            std::atomic<uint64_t> maxMicroseconds{ 0 };
+            std::atomic<uint64_t> buckets[AudioStats::kDecodeBuckets] = {};
+        };
+
+        DecodeCounters m_Decode[AudioStats::kFormatCount];
+
+        std::atomic<uint32_t> m_RealVoices;
+        std::atomic<uint32_t> m_VirtualVoices;
+        std::atomic<uint32_t> m_PausedVoices;
+        std::atomic<uint32_t> m_ProgressiveVoices;
+        std::atomic<uint32_t> m_MusicTracks;
+
+        std::atomic<uint64_t> m_ResidentBytes;
+        std::atomic<uint64_t> m_CategoryBytes[static_cast<size_t>(IAudio::EAudioCategory::kCount)];
+        std::atomic<uint64_t> m_CacheHits;
+        std::atomic<uint64_t> m_CacheMisses;
+        std::atomic<uint64_t> m_Evictions;
+
+        std::atomic<uint64_t> m_DroppedCommands;
+        std::atomic<uint64_t> m_Ticks;
+
+        // Errors taken by this audio system's OpenAL calls, another audio system counts its own
+        std::atomic<uint64_t> m_ALErrors[static_cast<size_t>(AudioStats::EALError::kCount)];
+        std::atomic<uint64_t> m_FailedSourceGens;
+
+        // Periodic dump, empty path when off
+        std::string m_DumpPath;
+        std::chrono::steady_clock::duration m_DumpInterval;
+        std::chrono::steady_clock::time_point m_NextDump;
+
+        // Thread writing the dump file, started by the first SetDump that turns the dump on.
+        // m_DumpMutex guards the snapshot handed over and the path it is written to
+        std::thread m_DumpThread;
+        std::mutex m_DumpMutex;
+        std::condition_variable m_DumpReady;
+        AudioStats m_PendingDump;
+        std::string m_PendingDumpPath;
+        bool m_HasPendingDump;
+        bool m_DumpThreadExit;
+        std::atomic<bool> m_DumpFailed;
+    };
+}
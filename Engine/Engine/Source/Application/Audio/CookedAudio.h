@@ -0,0 +1,55 @@
+﻿// © 2025 Yanan Liu <yanan.liu0325@gmail.com>
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace Engine
+{
+    // Cooked audio (.cpcm) is baked offline by the AudioBake tool from WAV/MP3/FLAC/OGG sources:
+    // a fixed header followed by interleaved little-endian 16-bit PCM starting on a 64-byte boundary.
+    // Loading one is a file mapping and a buffer upload, nothing is decoded
+    static constexpr char kCookedAudioMagic[4] = { 'C', 'P', 'C', 'M' };
+    static constexpr uint32_t kCookedAudioVersion = 1;
+    static constexpr uint32_t kCookedAudioAlignment = 64;
+
+    struct CookedAudioHeader
+    {
+        char magic[4];              // kCookedAudioMagic
+        uint32_t version;           // kCookedAudioVersion
+        uint32_t sampleRate;
+        uint16_t channels;          // 1 or 2
+        uint16_t bitsPerSample;     // Always 16
+        uint64_t frameCount;
+        uint64_t loopStart;         // Loop region in frames, loopEnd == 0 when the sound has none
+        uint64_t loopEnd;
+        uint64_t dataOffset;        // Offset of the first sample from the start of the file, multiple of kCookedAudioAlignment
+        uint8_t reserved[16];
+    };
+
+    static_assert(sizeof(CookedAudioHeader) == kCookedAudioAlignment, "The header fills exactly one alignment block");
+
+    // Validate a mapped cooked file and return its first sample, nullptr if the file is malformed
+    inline const int16_t* ReadCookedAudio(const uint8_t* data, size_t size, CookedAudioHeader& header)
+    {
+        if (size < sizeof(CookedAudioHeader)) return nullptr;
+
+        std::memcpy(&header, data, sizeof(CookedAudioHeader));
+        if (std::memcmp(header.magic, kCookedAudioMagic, sizeof(kCookedAudioMagic)) != 0 ||
+            header.version != kCookedAudioVersion || header.bitsPerSample != 16 ||
+            (header.channels != 1 && header.channels != 2) || header.sampleRate == 0 ||
+            header.dataOffset % kCookedAudioAlignment != 0 ||
+            header.dataOffset < sizeof(CookedAudioHeader) || header.dataOffset > size)
+        {
+            return nullptr;
+        }
+
+        // Reject a frame count the file can't hold
+        uint64_t frameBytes = header.channels * sizeof(int16_t);
+        if (header.frameCount > (size - header.dataOffset) / frameBytes) return nullptr;
+
+        return reinterpret_cast<const int16_t*>(data + header.dataOffset);
+    }
+}
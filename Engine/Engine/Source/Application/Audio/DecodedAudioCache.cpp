@@ -0,0 +1,306 @@
+﻿// © 2025 Yanan Liu <yanan.liu0325@gmail.com>
+
+#include "DecodedAudioCache.h"
+#include "CookedAudio.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace Engine
+{
+    namespace
+    {
+        constexpr const char* kEntryExtension = ".cpcm";
+        constexpr const char* kTempExtension = ".tmp";
+
+        // An entry's header keeps its key and the size of the file it was decoded from in the reserved bytes,
+        // so a hash collision or a file from elsewhere is never loaded
+        void WriteEntryTag(CookedAudioHeader& header, uint64_t key, uint64_t sourceSize)
+        {
+            static_assert(sizeof(header.reserved) >= 2 * sizeof(uint64_t), "The tag fits in the reserved bytes");
+            std::memcpy(header.reserved, &key, sizeof(key));
+            std::memcpy(header.reserved + sizeof(key), &sourceSize, sizeof(sourceSize));
+        }
+
+        bool MatchesEntryTag(const CookedAudioHeader& header, uint64_t key, uint64_t sourceSize)
+        {
+            CookedAudioHeader expected = {};
+            WriteEntryTag(expected, key, sourceSize);
+            return std::memcmp(header.reserved, expected.reserved, sizeof(header.reserved)) == 0;
+        }
+    }
+
+    DecodedAudioCache::DecodedAudioCache()
+        : m_Open(false)
+        , m_MaxBytes(0)
+        , m_Size(0)
+    {
+    }
+
+    bool DecodedAudioCache::Open(const char* directory, uint64_t maxBytes)
+    {
+        Close();
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        if (error)
+        {
+            printf("Error: Failed to create decoded audio cache directory '%s'\n", directory);
+            return false;
+        }
+
+        // Index what earlier runs left behind, the last write time is when an entry was last used
+        struct Existing
+        {
+            std::filesystem::file_time_type lastUsed;
+            uint64_t key;
+            uint64_t bytes;
+        };
+        std::vector<Existing> existing;
+
+        for (const auto& item : std::filesystem::directory_iterator(directory, error))
+        {
+            if (!item.is_regular_file(error)) continue;
+
+            const std::filesystem::path& path = item.path();
+            if (path.extension() == kTempExtension)
+            {
+                // Left over from a run that stopped while writing
+                std::filesystem::remove(path, error);
+                continue;
+            }
+
+            const std::string stem = path.stem().string();
+            if (path.extension() != kEntryExtension || stem.size() != 16 ||
+                stem.find_first_not_of("0123456789abcdef") != std::string::npos)
+            {
+                continue;
+            }
+
+            Existing entry;
+            entry.lastUsed = item.last_write_time(error);
+            entry.key = std::strtoull(stem.c_str(), nullptr, 16);
+            entry.bytes = item.file_size(error);
+            if (!error) existing.push_back(entry);
+        }
+
+        std::sort(existing.begin(), existing.end(),
+            [](const Existing& a, const Existing& b) { return a.lastUsed > b.lastUsed; });
+
+        m_Directory = directory;
+        m_MaxBytes = maxBytes;
+        for (const Existing& entry : existing)
+        {
+            m_Recency.push_back(entry.key);
+            m_Entries[entry.key] = { entry.bytes, std::prev(m_Recency.end()), true };
+            m_Size += entry.bytes;
+        }
+
+        // The limit may have shrunk since the last run
+        MakeRoom(0);
+
+        m_Open.store(true, std::memory_order_release);
+        return true;
+    }
+
+    void DecodedAudioCache::Close()
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Open.store(false, std::memory_order_release);
+        m_Directory.clear();
+        m_MaxBytes = 0;
+        m_Size = 0;
+        m_Recency.clear();
+        m_Entries.clear();
+    }
+
+    uint64_t DecodedAudioCache::MakeKey(const EncodedAudio& file, IAudio::EAudioFormat format)
+    {
+        // FNV-1a over 8-byte words with an extra fold of the high bits, hashing a file is far cheaper than decoding it
+        uint64_t hash = 14695981039346656037ull;
+        auto mix = [&hash](uint64_t value)
+        {
+            hash = (hash ^ value) * 1099511628211ull;
+            hash ^= hash >> 32;
+        };
+
+        mix(kDecodedAudioCacheVersion);
+        mix(static_cast<uint64_t>(format));
+        mix(file.size);
+
+        size_t offset = 0;
+        for (; offset + sizeof(uint64_t) <= file.size; offset += sizeof(uint64_t))
+        {
+            uint64_t word;
+            std::memcpy(&word, file.data + offset, sizeof(word));
+            mix(word);
+        }
+
+        uint64_t tail = 0;
+        if (offset < file.size) std::memcpy(&tail, file.data + offset, file.size - offset);
+        mix(tail);
+        return hash;
+    }
+
+    bool DecodedAudioCache::Find(uint64_t key, uint64_t sourceSize, EncodedAudio& out)
+    {
+        std::string path;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            if (!IsOpen()) return false;
+
+            auto it = m_Entries.find(key);
+            if (it == m_Entries.end() || !it->second.written) return false;
+
+            m_Recency.splice(m_Recency.begin(), m_Recency, it->second.recency);
+            path = GetEntryPath(key);
+        }
+
+        // Record the use on disk too, so the next run evicts in the same order
+        std::error_code error;
+        std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+
+        CookedAudioHeader header;
+        if (!out.Map(path.c_str()) || !ReadCookedAudio(out.data, out.size, header) ||
+            !MatchesEntryTag(header, key, sourceSize))
+        {
+            // Deleted or damaged behind our back, decode again and rewrite it
+            out = EncodedAudio();
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            auto it = m_Entries.find(key);
+            if (it != m_Entries.end() && it->second.written)
+            {
+                RemoveEntry(key);
+            }
+            return false;
+        }
+        return true;
+    }
+
+    bool DecodedAudioCache::Store(uint64_t key, uint64_t sourceSize, const DecodedAudio& audio)
+    {
+        const uint64_t bytes = sizeof(CookedAudioHeader) + audio.GetSampleCount() * sizeof(int16_t);
+        std::string path;
+        {
+            // Reserve the entry and its room, another worker decoding the same file sees it as taken
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            if (!IsOpen() || audio.channels == 0) return false;
+            if (m_Entries.count(key) != 0) return true;
+            if (bytes > m_MaxBytes) return false;
+
+            // Entries still being written can't be evicted, skip the store rather than go over the budget
+            MakeRoom(bytes);
+            if (m_Size + bytes > m_MaxBytes) return false;
+
+            m_Recency.push_front(key);
+            m_Entries[key] = { bytes, m_Recency.begin(), false };
+            m_Size += bytes;
+            path = GetEntryPath(key);
+        }
+
+        if (!WriteEntry(path, key, sourceSize, audio))
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            auto it = m_Entries.find(key);
+            if (it != m_Entries.end() && !it->second.written)
+            {
+                m_Size -= it->second.bytes;
+                m_Recency.erase(it->second.recency);
+                m_Entries.erase(it);
+            }
+            return false;
+        }
+
+        // The cache may have been closed or reopened meanwhile, the file is still a valid entry for the next run
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        auto it = m_Entries.find(key);
+        if (it != m_Entries.end())
+        {
+            it->second.written = true;
+        }
+        return true;
+    }
+
+    bool DecodedAudioCache::WriteEntry(const std::string& path, uint64_t key, uint64_t sourceSize, const DecodedAudio& audio)
+    {
+        CookedAudioHeader header = {};
+        std::memcpy(header.magic, kCookedAudioMagic, sizeof(kCookedAudioMagic));
+        header.version = kCookedAudioVersion;
+        header.sampleRate = audio.sampleRate;
+        header.channels = static_cast<uint16_t>(audio.channels);
+        header.bitsPerSample = 16;
+        header.frameCount = audio.GetSampleCount() / audio.channels;
+        header.dataOffset = kCookedAudioAlignment;
+        WriteEntryTag(header, key, sourceSize);
+
+        // Write under a temporary name first so a crash never leaves a truncated entry behind
+        const std::string tempPath = path + kTempExtension;
+        std::error_code error;
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(audio.GetSamples()),
+                static_cast<std::streamsize>(audio.GetSampleCount() * sizeof(int16_t)));
+            if (!file)
+            {
+                printf("Warning: Failed to write decoded audio cache entry '%s'\n", path.c_str());
+                file.close();
+                std::filesystem::remove(tempPath, error);
+                return false;
+            }
+        }
+
+        std::filesystem::rename(tempPath, path, error);
+        if (error)
+        {
+            std::filesystem::remove(tempPath, error);
+            return false;
+        }
+        return true;
+    }
+
+    uint64_t DecodedAudioCache::GetSize() const
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        return m_Size;
+    }
+
+    std::string DecodedAudioCache::GetEntryPath(uint64_t key) const
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+        return m_Directory + "/" + name + kEntryExtension;
+    }
+
+    void DecodedAudioCache::MakeRoom(uint64_t incomingBytes)
+    {
+        if (m_Size + incomingBytes <= m_MaxBytes) return;
+
+        // Entries of sounds that are still loaded can't be deleted yet, they are skipped along with the ones being written
+        std::vector<uint64_t> oldestFirst(m_Recency.rbegin(), m_Recency.rend());
+        for (uint64_t key : oldestFirst)
+        {
+            if (m_Size + incomingBytes <= m_MaxBytes) break;
+            if (m_Entries.at(key).written) RemoveEntry(key);
+        }
+    }
+
+    bool DecodedAudioCache::RemoveEntry(uint64_t key)
+    {
+        auto it = m_Entries.find(key);
+        if (it == m_Entries.end()) return true;
+
+        std::error_code error;
+        std::filesystem::remove(GetEntryPath(key), error);
+        if (error) return false;
+
+        m_Size -= it->second.bytes;
+        m_Recency.erase(it->second.recency);
+        m_Entries.erase(it);
+        return true;
+    }
+}
@@ -0,0 +1,85 @@
+﻿// © 2025 Yanan Liu <yanan.liu0325@gmail.com>
+
+#pragma once
+
+#include "IAudio.h"
+#include "AudioDecoder.h"
+#include <cstdint>
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace Engine
+{
+    // Bump when a decoder's output changes (a dr_mp3/dr_flac upgrade), so stale entries are never loaded
+    static constexpr uint32_t kDecodedAudioCacheVersion = 1;
+
+    // On-disk cache of decoded PCM, so compressed sounds are decoded once instead of on every launch.
+    // Entries are cooked audio files named after a hash of the encoded file's contents, the format and
+    // kDecodedAudioCacheVersion. Loading one is a file mapping, like any cooked sound.
+    // Least recently used entries are deleted once the directory grows past its size limit.
+    // Every method locks, the decode pool uses it from several threads. The lock only guards the index,
+    // entries are written and mapped outside it
+    class DecodedAudioCache
+    {
+    public:
+        // Default constructor
+        DecodedAudioCache();
+
+        DecodedAudioCache(const DecodedAudioCache&) = delete;
+        DecodedAudioCache& operator=(const DecodedAudioCache&) = delete;
+
+        // Use the directory, creating it if needed, and index the entries already in it
+        bool Open(const char* directory, uint64_t maxBytes);
+        void Close();
+
+        // Key of an encoded file's decoded PCM
+        static uint64_t MakeKey(const EncodedAudio& file, IAudio::EAudioFormat format);
+
+        // Map the cooked entry for the key, returns false on a miss
+        bool Find(uint64_t key, uint64_t sourceSize, EncodedAudio& out);
+
+        // Write decoded PCM under the key, evicting old entries to make room. False without writing anything when
+        // the budget can't be met. Loop points aren't stored, they come from the asset's sidecar on every load
+        bool Store(uint64_t key, uint64_t sourceSize, const DecodedAudio& audio);
+
+    public:
+        // --------------------------------------------------------------------- //
+        // Accessors
+        // --------------------------------------------------------------------- //
+        bool IsOpen() const { return m_Open.load(std::memory_order_acquire); }
+        uint64_t GetSize() const;
+
+    private:
+        struct Entry
+        {
+            uint64_t bytes;
+            std::list<uint64_t>::iterator recency;
+            bool written;   // False while Store is still writing the file, it can't be loaded or evicted yet
+        };
+
+        std::string GetEntryPath(uint64_t key) const;
+
+        // Write the cooked file for an entry through a temporary name, run without the lock
+        static bool WriteEntry(const std::string& path, uint64_t key, uint64_t sourceSize, const DecodedAudio& audio);
+
+        // Delete least recently used entries until incomingBytes more fit the size limit
+        void MakeRoom(uint64_t incomingBytes);
+
+        // Forget an entry and delete its file. Fails while the file is still mapped by a loaded sound
+        bool RemoveEntry(uint64_t key);
+
+    private:
+        mutable std::mutex m_Mutex;
+        std::atomic<bool> m_Open;
+        std::string m_Directory;
+        uint64_t m_MaxBytes;
+        uint64_t m_Size;
+
+        // Most recently used first
+        std::list<uint64_t> m_Recency;
+        std::unordered_map<uint64_t, Entry> m_Entries;
+    };
+}
@@ -2,10 +2,20 @@
 
 #include "IAudio.h"
 #include "OpenALAudio.h"
+#include "SoftwareAudio.h"
 
 using Engine::IAudio;
 
 std::unique_ptr<IAudio> Engine::IAudio::CreateAudioSystem()
 {
 	return std::make_unique<OpenALAudio>();
+}
+
+std::unique_ptr<IAudio> Engine::IAudio::CreateAudioSystem(const AudioSystemOptions& options)
+{
+	if (options.backend == EAudioBackend::kSoftware)
+	{
+		return std::make_unique<SoftwareAudio>(options);
+	}
+	return std::make_unique<OpenALAudio>(options);
 }
\ No newline at end of file
@@ -4,9 +4,11 @@
 
 #include <memory>
 #include "Common.h"
+#include "AudioKeyIndex.h"
+#include "SoundId.h"
 #include <string>
-#include <unordered_map>
-#include <atomic>
+#include <string_view>
+#include <future>
 
 namespace Engine
 {
@@ -42,53 +44,159 @@ namespace Engine
 			kFlac,      // FLAC format
 			kAiff,      // AIFF format
 			kRaw,       // RAW PCM format
+			kCooked,    // Cooked PCM (.cpcm) baked by the AudioBake tool
 			kOthers     // Other formats
 		};
 
+		// What a resident buffer is used for, each category can have its own memory budget
+		enum class EAudioCategory
+		{
+			kSound,     // Sound effects
+			kMusic,     // Music loaded as a whole buffer, streamed music isn't resident
+			kCount
+		};
+
+		// Where the mix goes
+		enum class EAudioBackend
+		{
+			kDevice,    // The default output device, mixed in real time
+			kLoopback,  // No device, RenderAudio mixes on demand as fast as the CPU allows (ALC_SOFT_loopback)
+			kSoftware,  // The engine's own SIMD mixer, its output goes to the sink chosen in the options
+		};
+
+		// Output of the software mixer
+		enum class EAudioSink
+		{
+			kOpenAL,    // A streaming source on the default device, mixed in real time
+			kWavFile,   // A 32-bit float WAV file, RenderAudio mixes on demand
+			kNull,      // Nowhere, RenderAudio mixes on demand
+		};
+
+		// How the software mixer converts sample rates
+		enum class EAudioResampler
+		{
+			kLinear,    // Two taps, cheapest
+			kCubic,     // Four-tap Catmull-Rom spline, much less aliasing
+		};
+
+		// Options for CreateAudioSystem
+		struct AudioSystemOptions
+		{
+			EAudioBackend backend = EAudioBackend::kDevice;
+			uint32_t sampleRate = 48000;    // Output format of the loopback backend and the software mixer
+			uint32_t channels = 2;          // 1 or 2
+
+			// Software mixer only
+			EAudioSink sink = EAudioSink::kOpenAL;
+			const char* wavPath = nullptr;  // File written by EAudioSink::kWavFile
+			EAudioResampler resampler = EAudioResampler::kCubic;
+		};
+
+		// Handle to an asset decoding in the background, becomes true once it is ready to play
+		using AudioLoadHandle = std::shared_future<bool>;
+
+		// Occupancy of the preallocated voice pool
+		struct SourcePoolStats
+		{
+			uint32_t capacity = 0;     // Voices created at Init
+			uint32_t inUse = 0;        // Voices currently playing or paused
+			uint32_t peakInUse = 0;    // Highest inUse so far
+			uint64_t leases = 0;       // Voices handed out
+			uint64_t exhausted = 0;    // Plays dropped because every voice was busy
+		};
+
+		// Resident PCM buffers and how often plays found them loaded
+		struct BufferCacheStats
+		{
+			uint64_t residentBytes = 0;      // PCM bytes currently loaded
+			uint32_t residentBuffers = 0;    // Buffers currently loaded
+			uint64_t hits = 0;               // Plays that found their buffer loaded
+			uint64_t misses = 0;             // Plays that had to load their buffer
+			uint64_t evictions = 0;          // Buffers dropped to stay within budget
+
+			// residentBytes split by EAudioCategory
+			uint64_t categoryBytes[static_cast<size_t>(EAudioCategory::kCount)] = {};
+		};
+
+		// Health counters of the audio system, kept with relaxed atomics as it runs. See GetAudioStats
+		struct AudioStats
+		{
+			// Decode times are bucketed by powers of two: under 1 ms, under 2 ms ... under 512 ms, then the rest
+			static constexpr size_t kDecodeBuckets = 11;
+			static constexpr size_t kFormatCount = static_cast<size_t>(EAudioFormat::kOthers) + 1;
+
+			// OpenAL error codes, anything unexpected counts as kOther
+			enum class EALError
+			{
+				kInvalidName,
+				kInvalidEnum,
+				kInvalidValue,
+				kInvalidOperation,
+				kOutOfMemory,
+				kOther,
+				kCount
+			};
+
+			struct DecodeTimes
+			{
+				uint64_t decodes = 0;              // Full and progressive decodes that succeeded
+				uint64_t failures = 0;
+				uint64_t totalMicroseconds = 0;    // Of the successful decodes
+				uint64_t maxMicroseconds = 0;
+				uint64_t buckets[kDecodeBuckets] = {};
+			};
+
+			// By EAudioFormat, decoded cache hits count as decodes of the original format
+			DecodeTimes decode[kFormatCount];
+
+			// Voices by state, sampled every tick
+			uint32_t realVoices = 0;           // Mixed: holding an OpenAL source, or within the software mixer's cap
+			uint32_t virtualVoices = 0;        // Advancing silently
+			uint32_t pausedVoices = 0;         // Of the real and virtual voices, those paused or rewound
+			uint32_t progressiveVoices = 0;    // Started on a sound that was still decoding
+			uint32_t musicTracks = 0;          // The current music, and a track fading out under a crossfade
+
+			// Resident PCM and the cache counters, sampled every tick
+			uint64_t residentBytes = 0;
+			uint64_t categoryBytes[static_cast<size_t>(EAudioCategory::kCount)] = {};
+			uint64_t cacheHits = 0;
+			uint64_t cacheMisses = 0;
+			uint64_t evictions = 0;
+
+			// By EALError, taken by this audio system's own OpenAL calls
+			uint64_t alErrors[static_cast<size_t>(EALError::kCount)] = {};
+			uint64_t failedSourceGens = 0;     // alGenSources calls that failed, the device was out of voices or the context lost
+
+			uint64_t droppedCommands = 0;      // Queued calls lost to a full command queue
+			uint64_t ticks = 0;                // Audio thread ticks, or blocks mixed
+		};
+
 	protected:
-		// Audio path key management
-		std::atomic<uint32_t> m_NextAudioKey{1};  // Start from 1, 0 reserved for invalid
-
-		// Audio path key -> filepath mapping
-		std::unordered_map<uint32_t, std::string> m_AudioKeyToPath;
-		
-		// Cache for last key generation
-		mutable struct KeyGenCache {
-			std::string path;
-			uint32_t key{0};
-		} m_LastKeyGeneration;
+		// Audio path key <-> filepath mapping
+		AudioKeyIndex m_AudioKeys;
 
 		// Helper methods for key management
-		uint32_t GenerateAudioKey(const char* filepath) {
-			std::string path(filepath);
-			
-			// Check cache first
-			if (m_LastKeyGeneration.path == path) {
-				return m_LastKeyGeneration.key;
-			}
-			
-			// Look for existing key
-			for (const auto& pair : m_AudioKeyToPath) {
-				if (pair.second == path) {
-					// Cache and return found key
-					m_LastKeyGeneration = {path, pair.first};
-					return pair.first;
-				}
-			}
-			
-			// Generate new key
-			uint32_t newKey = m_NextAudioKey++;
-			m_AudioKeyToPath[newKey] = path;
-			
-			// Cache the new key-path pair
-			m_LastKeyGeneration = {path, newKey};
-			return newKey;
+		uint32_t GenerateAudioKey(std::string_view filepath) {
+			return m_AudioKeys.Acquire(filepath);
+		}
+
+		// Key of an already registered filepath, 0 if it was never played or loaded
+		uint32_t FindAudioKey(std::string_view filepath) const {
+			return m_AudioKeys.Find(filepath);
+		}
+
+		// Key of a compile-time sound id, 0 if its path was never played or loaded
+		uint32_t ResolveSoundId(const SoundId& sound) const {
+			return m_AudioKeys.Resolve(sound);
+		}
+
+		// Key of a filepath whose HashAudioPath is already known, 0 if it was never played or loaded
+		uint32_t ResolveAudioKey(uint32_t hash, std::string_view filepath) const {
+			return m_AudioKeys.Resolve(hash, filepath);
 		}
 
 		const std::string& GetFilePath(uint32_t key) const {
-			static const std::string empty;
-			auto it = m_AudioKeyToPath.find(key);
-			return it != m_AudioKeyToPath.end() ? it->second : empty;
+			return m_AudioKeys.GetPath(key);
 		}
 
 	public:
@@ -103,18 +211,45 @@ namespace Engine
 		virtual bool Init() = 0;
 
 		// create a new audio system and return it
-		static std::unique_ptr<IAudio> CreateAudioSystem();
+		DLLEXP static std::unique_ptr<IAudio> CreateAudioSystem();
+		DLLEXP static std::unique_ptr<IAudio> CreateAudioSystem(const AudioSystemOptions& options);
 
 		// play music under the filepath, if the file hasn't been loaded, load it
 		DLLEXP virtual bool PlayMusic(const char* filepath) = 0;
+		DLLEXP virtual bool PlayMusic(SoundId music) = 0;
+
+		// queue music to play once the current track ends by itself, starts right away if no music is playing.
+		// Streamed tracks are opened ahead of time and follow on the same source without a gap. Returns false if the track
+		// is already known to be unplayable, other bad tracks are skipped when their turn comes
+		DLLEXP virtual bool QueueMusic(const char* filepath) = 0;
+
+		// drop the tracks waiting in the music queue, the current one keeps playing
+		virtual void ClearMusicQueue() = 0;
 
-		// play sound under the filepath, if the file hasn't been loaded, load it
+		// play sound under the filepath, if the file hasn't been loaded, load it in the background first.
+		// Safe from any thread and never blocks, the play is queued for the audio thread
 		DLLEXP virtual bool PlaySoundEffect(const char* filepath) = 0;
+		DLLEXP virtual bool PlaySoundEffect(SoundId sound) = 0;
+
+		// play sound under the filepath once it has been decoded in the background, never blocks on a load
+		DLLEXP virtual bool PlaySoundEffectWhenReady(const char* filepath) = 0;
+
+		// decode the file on a worker thread, the handle completes once the sound can be played
+		DLLEXP virtual AudioLoadHandle LoadAudioAsync(const char* filepath) = 0;
+
+		// deprecated, does nothing. The audio system services loads, voices, fades and music on its own thread,
+		// so there is nothing left to call every frame. Kept so existing callers still link
+		[[deprecated("The audio system updates itself on its own thread")]] DLLEXP virtual void Update() = 0;
 
-		// operation one action on the current music
+		// render the next frameCount frames of the mix into out as interleaved floats. Only for the loopback backend and
+		// the software mixer's WAV and null sinks, which have no audio thread: time advances by the frames rendered, so
+		// tests can run faster than real time. The software mixer also writes the frames to its sink, out may be null
+		virtual bool RenderAudio(float* out, uint32_t frameCount) = 0;
+
+		// operation one action on the current music. Applied right away, like every music call
 		DLLEXP virtual void OperateCurrentMusic(EAudioAction action) = 0;
 
-		// operation one action on the current sound
+		// operation one action on the current sound, queued like PlaySoundEffect
 		DLLEXP virtual void OperateCurrentSounds(EAudioAction action) = 0;
 
 		// fade in music
@@ -123,6 +258,10 @@ namespace Engine
 		// fade out music
 		virtual void FadeOutMusic(int ms) = 0;
 
+		// crossfade from the current music to the file with equal-power gains. The new track is streamed and
+		// prebuffered on the audio thread before the fade starts, both tracks play during the overlap
+		DLLEXP virtual bool CrossfadeMusic(const char* filepath, int loops, int ms) = 0;
+
 		// free music by key
 		virtual void FreeMusicByKey(uint32_t audioKey) = 0;
 
@@ -133,11 +272,12 @@ namespace Engine
 		// --------------------------------------------------------------------- //
 		// Accessors & Mutators
 		// --------------------------------------------------------------------- //
-		/** set the current music's volume */
+		/** set the current music's volume, applied right away like every music call */
 		virtual void SetMusicVolume(int volume) = 0;
 
-		/** set a sound's volume */
+		/** set a sound's volume, queued like PlaySoundEffect */
 		virtual void SetSoundVolume(const char* filepath, int volume) = 0;
+		virtual void SetSoundVolume(SoundId sound, int volume) = 0;
 
 		/** get the current music's volume */
 		virtual int GetMusicVolume() = 0;
@@ -151,7 +291,40 @@ namespace Engine
 		/** set music to the target position  */
 		virtual void SetMusicPosition(double position_x, double position_y) = 0;
 
-		/** set up a function to be called when music playback is halted */
+		/** set the priority of a sound, when every voice is busy higher priority sounds steal from lower ones */
+		virtual void SetSoundPriority(const char* filepath, int priority) = 0;
+
+		/** play a long sound (dialogue, stingers) as soon as its first ~100 ms are decoded instead of waiting for the
+		    whole file. It is kept as a normal loaded sound once decoding finishes */
+		virtual void SetSoundProgressive(const char* filepath, bool progressive) = 0;
+
+		/** cap the number of voices actually mixed, the others continue silently as virtual voices */
+		virtual void SetMaxRealVoices(int count) = 0;
+
+		/** stream music from disk through a small buffer ring instead of decoding the whole file up front */
+		virtual void SetMusicStreaming(bool streaming) = 0;
+
+		/** how often the audio thread runs fades, stream refills and voice bookkeeping, 5 ms by default */
+		virtual void SetAudioTickInterval(int ms) = 0;
+
+		/** cap the PCM kept loaded, least recently used buffers without a playing source are evicted and reloaded
+		    on their next play. 0 removes the cap */
+		virtual void SetAudioMemoryBudget(uint64_t bytes) = 0;
+		virtual void SetAudioMemoryBudget(EAudioCategory category, uint64_t bytes) = 0;
+
+		/** mount a sound bank built by AudioBake --bank, its sounds are loaded by path ahead of the filesystem */
+		virtual bool MountSoundBank(const char* filepath) = 0;
+
+		/** keep a file in memory still encoded and decode it as it plays, the smallest footprint for long Vorbis
+		    music and ambience. Streamed music and every load of the file then read it from memory, not the disk */
+		virtual bool LoadCompressedAudio(const char* filepath) = 0;
+		virtual void FreeCompressedAudio(const char* filepath) = 0;
+
+		/** keep decoded MP3, FLAC and Vorbis as PCM in the directory so later launches skip decoding them. Least recently
+		    used entries are deleted once the directory holds more than maxBytes. A null directory turns it off */
+		virtual bool EnableDecodedAudioCache(const char* directory, uint64_t maxBytes) = 0;
+
+		/** set up a function to be called when music playback is halted, it is called on the audio thread */
 		virtual void SetFinishMusicCallback(void(*music_finished)()) = 0;
 
 		// get the format of the current music
@@ -165,5 +338,19 @@ namespace Engine
 
 		// tell you if the current music is fading or not
 		virtual bool IsMusicFading() = 0;
+
+		// get the occupancy of the voice pool
+		virtual SourcePoolStats GetSourcePoolStats() = 0;
+
+		// get the resident buffer counters
+		virtual BufferCacheStats GetBufferCacheStats() = 0;
+
+		// get the health counters. Never waits for the audio thread, each counter is current but they may be a tick apart
+		virtual AudioStats GetAudioStats() = 0;
+
+		/** write GetAudioStats as JSON to the file every intervalMs. The audio thread takes the snapshot and a thread of
+		    its own writes it, so a slow disk never holds up the mix. The file is overwritten each time.
+		    A null filepath or an interval of 0 stops it */
+		virtual void SetAudioStatsDump(const char* filepath, int intervalMs) = 0;
 	};
 }
\ No newline at end of file
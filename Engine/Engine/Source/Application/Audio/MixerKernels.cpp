@@ -0,0 +1,488 @@
+﻿// © 2025 Yanan Liu <yanan.liu0325@gmail.com>
+
+#include "MixerKernels.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define MIXER_HAS_X64 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define MIXER_AVX_FUNCTION
+#else
+// GCC and Clang only emit AVX inside functions that ask for it, MSVC emits any intrinsic anywhere
+#define MIXER_AVX_FUNCTION __attribute__((target("avx")))
+#endif
+#endif
+
+namespace Engine
+{
+    namespace
+    {
+        constexpr float kInt16ToFloat = 1.0f / 32768.0f;
+        constexpr float kFloatToInt16 = 32767.0f;
+
+        // --------------------------------------------------------------------- //
+        // Scalar kernels, also the tails of the SIMD ones
+        // --------------------------------------------------------------------- //
+        void DeinterleaveScalar(const int16_t* in, uint32_t channels, float* const* out, uint32_t frameCount, uint32_t first = 0)
+        {
+            for (uint32_t i = first; i < frameCount; ++i)
+            {
+                for (uint32_t c = 0; c < channels; ++c)
+                {
+                    out[c][i] = static_cast<float>(in[i * channels + c]) * kInt16ToFloat;
+                }
+            }
+        }
+
+        void ResampleLinearScalar(const float* in, float position, float step, float* out, uint32_t count, uint32_t first = 0)
+        {
+            for (uint32_t i = first; i < count; ++i)
+            {
+                const float p = position + static_cast<float>(i) * step;
+                const int32_t index = static_cast<int32_t>(p);
+                const float t = p - static_cast<float>(index);
+                out[i] = in[index] + t * (in[index + 1] - in[index]);
+            }
+        }
+
+        void ResampleCubicScalar(const float* in, float position, float step, float* out, uint32_t count, uint32_t first = 0)
+        {
+            for (uint32_t i = first; i < count; ++i)
+            {
+                const float p = position + static_cast<float>(i) * step;
+                const int32_t index = static_cast<int32_t>(p);
+                const float t = p - static_cast<float>(index);
+                const float y0 = in[index - 1], y1 = in[index], y2 = in[index + 1], y3 = in[index + 2];
+
+                const float c1 = 0.5f * (y2 - y0);
+                const float c2 = y0 - 2.5f * y1 + 2.0f * y2 - 0.5f * y3;
+                const float c3 = 0.5f * (y3 - y0) + 1.5f * (y1 - y2);
+                out[i] = ((c3 * t + c2) * t + c1) * t + y1;
+            }
+        }
+
+        void MixRampScalar(float* bus, const float* in, uint32_t count, float gain, float gainStep, uint32_t first = 0)
+        {
+            for (uint32_t i = first; i < count; ++i)
+            {
+                bus[i] += in[i] * (gain + static_cast<float>(i) * gainStep);
+            }
+        }
+
+        void MixRampStereoScalar(float* left, float* right, const float* in, uint32_t count,
+            float leftGain, float leftStep, float rightGain, float rightStep, uint32_t first = 0)
+        {
+            for (uint32_t i = first; i < count; ++i)
+            {
+                const float index = static_cast<float>(i);
+                left[i] += in[i] * (leftGain + index * leftStep);
+                right[i] += in[i] * (rightGain + index * rightStep);
+            }
+        }
+
+        void InterleaveScalar(const float* const* bus, uint32_t channels, float* out, uint32_t frameCount, uint32_t first = 0)
+        {
+            for (uint32_t i = first; i < frameCount; ++i)
+            {
+                for (uint32_t c = 0; c < channels; ++c)
+                {
+                    out[i * channels + c] = std::min(std::max(bus[c][i], -1.0f), 1.0f);
+                }
+            }
+        }
+
+        void ToInt16Scalar(const float* in, int16_t* out, uint32_t count, uint32_t first = 0)
+        {
+            for (uint32_t i = first; i < count; ++i)
+            {
+                const float sample = std::min(std::max(in[i], -1.0f), 1.0f);
+                out[i] = static_cast<int16_t>(std::lrint(sample * kFloatToInt16));
+            }
+        }
+
+        const MixerKernels kScalarKernels =
+        {
+            EMixerInstructionSet::kScalar, "scalar",
+            [](const int16_t* in, uint32_t channels, float* const* out, uint32_t frameCount) { DeinterleaveScalar(in, channels, out, frameCount); },
+            [](const float* in, float position, float step, float* out, uint32_t count) { ResampleLinearScalar(in, position, step, out, count); },
+            [](const float* in, float position, float step, float* out, uint32_t count) { ResampleCubicScalar(in, position, step, out, count); },
+            [](float* bus, const float* in, uint32_t count, float gain, float gainStep) { MixRampScalar(bus, in, count, gain, gainStep); },
+            [](float* left, float* right, const float* in, uint32_t count, float leftGain, float leftStep, float rightGain, float rightStep)
+                { MixRampStereoScalar(left, right, in, count, leftGain, leftStep, rightGain, rightStep); },
+            [](const float* const* bus, uint32_t channels, float* out, uint32_t frameCount) { InterleaveScalar(bus, channels, out, frameCount); },
+            [](const float* in, int16_t* out, uint32_t count) { ToInt16Scalar(in, out, count); }
+        };
+
+#if MIXER_HAS_X64
+        // --------------------------------------------------------------------- //
+        // SSE2 kernels, 4 floats at a time
+        // --------------------------------------------------------------------- //
+        void DeinterleaveSse(const int16_t* in, uint32_t channels, float* const* out, uint32_t frameCount)
+        {
+            const __m128 scale = _mm_set1_ps(kInt16ToFloat);
+            uint32_t i = 0;
+            if (channels == 1)
+            {
+                for (; i + 8 <= frameCount; i += 8)
+                {
+                    // Sign-extend by placing each sample in the high half of a 32-bit lane and shifting down
+                    const __m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+                    const __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16);
+                    const __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16);
+                    _mm_storeu_ps(out[0] + i, _mm_mul_ps(_mm_cvtepi32_ps(low), scale));
+                    _mm_storeu_ps(out[0] + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(high), scale));
+                }
+            }
+            else if (channels == 2)
+            {
+                for (; i + 4 <= frameCount; i += 4)
+                {
+                    // L0 R0 L1 R1 and L2 R2 L3 R3, then the even and odd lanes of both
+                    const __m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 2));
+                    const __m128 low = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16));
+                    const __m128 high = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16));
+                    _mm_storeu_ps(out[0] + i, _mm_mul_ps(_mm_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0)), scale));
+                    _mm_storeu_ps(out[1] + i, _mm_mul_ps(_mm_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1)), scale));
+                }
+            }
+            DeinterleaveScalar(in, channels, out, frameCount, i);
+        }
+
+        void ResampleLinearSse(const float* in, float position, float step, float* out, uint32_t count)
+        {
+            const __m128 lanes = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+            const __m128 start = _mm_set1_ps(position);
+            const __m128 stride = _mm_set1_ps(step);
+            alignas(16) int32_t index[4];
+
+            uint32_t i = 0;
+            for (; i + 4 <= count; i += 4)
+            {
+                const __m128 p = _mm_add_ps(start, _mm_mul_ps(_mm_add_ps(_mm_set1_ps(static_cast<float>(i)), lanes), stride));
+                const __m128i whole = _mm_cvttps_epi32(p);
+                const __m128 t = _mm_sub_ps(p, _mm_cvtepi32_ps(whole));
+                _mm_store_si128(reinterpret_cast<__m128i*>(index), whole);
+
+                // No gather before AVX2, the taps are loaded one by one and blended in registers
+                const __m128 a = _mm_setr_ps(in[index[0]], in[index[1]], in[index[2]], in[index[3]]);
+                const __m128 b = _mm_setr_ps(in[index[0] + 1], in[index[1] + 1], in[index[2] + 1], in[index[3] + 1]);
+                _mm_storeu_ps(out + i, _mm_add_ps(a, _mm_mul_ps(t, _mm_sub_ps(b, a))));
+            }
+            ResampleLinearScalar(in, position, step, out, count, i);
+        }
+
+        void ResampleCubicSse(const float* in, float position, float step, float* out, uint32_t count)
+        {
+            const __m128 lanes = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+            const __m128 start = _mm_set1_ps(position);
+            const __m128 stride = _mm_set1_ps(step);
+            const __m128 half = _mm_set1_ps(0.5f);
+            const __m128 oneAndHalf = _mm_set1_ps(1.5f);
+            const __m128 two = _mm_set1_ps(2.0f);
+            const __m128 twoAndHalf = _mm_set1_ps(2.5f);
+            alignas(16) int32_t index[4];
+
+            uint32_t i = 0;
+            for (; i + 4 <= count; i += 4)
+            {
+                const __m128 p = _mm_add_ps(start, _mm_mul_ps(_mm_add_ps(_mm_set1_ps(static_cast<float>(i)), lanes), stride));
+                const __m128i whole = _mm_cvttps_epi32(p);
+                const __m128 t = _mm_sub_ps(p, _mm_cvtepi32_ps(whole));
+                _mm_store_si128(reinterpret_cast<__m128i*>(index), whole);
+
+                const __m128 y0 = _mm_setr_ps(in[index[0] - 1], in[index[1] - 1], in[index[2] - 1], in[index[3] - 1]);
+                const __m128 y1 = _mm_setr_ps(in[index[0]], in[index[1]], in[index[2]], in[index[3]]);
+                const __m128 y2 = _mm_setr_ps(in[index[0] + 1], in[index[1] + 1], in[index[2] + 1], in[index[3] + 1]);
+                const __m128 y3 = _mm_setr_ps(in[index[0] + 2], in[index[1] + 2], in[index[2] + 2], in[index[3] + 2]);
+
+                const __m128 c1 = _mm_mul_ps(half, _mm_sub_ps(y2, y0));
+                const __m128 c2 = _mm_sub_ps(_mm_add_ps(_mm_sub_ps(y0, _mm_mul_ps(twoAndHalf, y1)), _mm_mul_ps(two, y2)), _mm_mul_ps(half, y3));
+                const __m128 c3 = _mm_add_ps(_mm_mul_ps(half, _mm_sub_ps(y3, y0)), _mm_mul_ps(oneAndHalf, _mm_sub_ps(y1, y2)));
+                const __m128 result = _mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_add_ps(_mm_mul_ps(c3, t), c2), t), c1), t), y1);
+                _mm_storeu_ps(out + i, result);
+            }
+            ResampleCubicScalar(in, position, step, out, count, i);
+        }
+
+        void MixRampSse(float* bus, const float* in, uint32_t count, float gain, float gainStep)
+        {
+            const __m128 lanes = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+            const __m128 start = _mm_set1_ps(gain);
+            const __m128 stride = _mm_set1_ps(gainStep);
+
+            uint32_t i = 0;
+            for (; i + 4 <= count; i += 4)
+            {
+                const __m128 g = _mm_add_ps(start, _mm_mul_ps(_mm_add_ps(_mm_set1_ps(static_cast<float>(i)), lanes), stride));
+                _mm_storeu_ps(bus + i, _mm_add_ps(_mm_loadu_ps(bus + i), _mm_mul_ps(_mm_loadu_ps(in + i), g)));
+            }
+            MixRampScalar(bus, in, count, gain, gainStep, i);
+        }
+
+        void MixRampStereoSse(float* left, float* right, const float* in, uint32_t count,
+            float leftGain, float leftStep, float rightGain, float rightStep)
+        {
+            const __m128 lanes = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+            const __m128 leftStart = _mm_set1_ps(leftGain);
+            const __m128 leftStride = _mm_set1_ps(leftStep);
+            const __m128 rightStart = _mm_set1_ps(rightGain);
+            const __m128 rightStride = _mm_set1_ps(rightStep);
+
+            uint32_t i = 0;
+            for (; i + 4 <= count; i += 4)
+            {
+                const __m128 index = _mm_add_ps(_mm_set1_ps(static_cast<float>(i)), lanes);
+                const __m128 sample = _mm_loadu_ps(in + i);
+                const __m128 l = _mm_add_ps(leftStart, _mm_mul_ps(index, leftStride));
+                const __m128 r = _mm_add_ps(rightStart, _mm_mul_ps(index, rightStride));
+                _mm_storeu_ps(left + i, _mm_add_ps(_mm_loadu_ps(left + i), _mm_mul_ps(sample, l)));
+                _mm_storeu_ps(right + i, _mm_add_ps(_mm_loadu_ps(right + i), _mm_mul_ps(sample, r)));
+            }
+            MixRampStereoScalar(left, right, in, count, leftGain, leftStep, rightGain, rightStep, i);
+        }
+
+        void InterleaveSse(const float* const* bus, uint32_t channels, float* out, uint32_t frameCount)
+        {
+            const __m128 low = _mm_set1_ps(-1.0f);
+            const __m128 high = _mm_set1_ps(1.0f);
+            uint32_t i = 0;
+            if (channels == 1)
+            {
+                for (; i + 4 <= frameCount; i += 4)
+                {
+                    _mm_storeu_ps(out + i, _mm_min_ps(_mm_max_ps(_mm_loadu_ps(bus[0] + i), low), high));
+                }
+            }
+            else if (channels == 2)
+            {
+                for (; i + 4 <= frameCount; i += 4)
+                {
+                    const __m128 l = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(bus[0] + i), low), high);
+                    const __m128 r = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(bus[1] + i), low), high);
+                    _mm_storeu_ps(out + i * 2, _mm_unpacklo_ps(l, r));
+                    _mm_storeu_ps(out + i * 2 + 4, _mm_unpackhi_ps(l, r));
+                }
+            }
+            InterleaveScalar(bus, channels, out, frameCount, i);
+        }
+
+        void ToInt16Sse(const float* in, int16_t* out, uint32_t count)
+        {
+            const __m128 low = _mm_set1_ps(-1.0f);
+            const __m128 high = _mm_set1_ps(1.0f);
+            const __m128 scale = _mm_set1_ps(kFloatToInt16);
+
+            uint32_t i = 0;
+            for (; i + 8 <= count; i += 8)
+            {
+                // Rounds to nearest like lrint, the pack saturates
+                const __m128 a = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i), low), high), scale);
+                const __m128 b = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i + 4), low), high), scale);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b)));
+            }
+            ToInt16Scalar(in, out, count, i);
+        }
+
+        const MixerKernels kSseKernels =
+        {
+            EMixerInstructionSet::kSse, "sse2",
+            DeinterleaveSse, ResampleLinearSse, ResampleCubicSse, MixRampSse, MixRampStereoSse, InterleaveSse, ToInt16Sse
+        };
+
+        // --------------------------------------------------------------------- //
+        // AVX kernels, 8 floats at a time
+        // --------------------------------------------------------------------- //
+        MIXER_AVX_FUNCTION __m256 AvxLanes()
+        {
+            return _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+        }
+
+        MIXER_AVX_FUNCTION __m256 GatherAvx(const float* in, const int32_t* index, int32_t offset)
+        {
+            return _mm256_setr_ps(in[index[0] + offset], in[index[1] + offset], in[index[2] + offset], in[index[3] + offset],
+                in[index[4] + offset], in[index[5] + offset], in[index[6] + offset], in[index[7] + offset]);
+        }
+
+        MIXER_AVX_FUNCTION void ResampleLinearAvx(const float* in, float position, float step, float* out, uint32_t count)
+        {
+            const __m256 lanes = AvxLanes();
+            const __m256 start = _mm256_set1_ps(position);
+            const __m256 stride = _mm256_set1_ps(step);
+            alignas(32) int32_t index[8];
+
+            uint32_t i = 0;
+            for (; i + 8 <= count; i += 8)
+            {
+                const __m256 p = _mm256_add_ps(start, _mm256_mul_ps(_mm256_add_ps(_mm256_set1_ps(static_cast<float>(i)), lanes), stride));
+                const __m256i whole = _mm256_cvttps_epi32(p);
+                const __m256 t = _mm256_sub_ps(p, _mm256_cvtepi32_ps(whole));
+                _mm256_store_si256(reinterpret_cast<__m256i*>(index), whole);
+
+                const __m256 a = GatherAvx(in, index, 0);
+                const __m256 b = GatherAvx(in, index, 1);
+                _mm256_storeu_ps(out + i, _mm256_add_ps(a, _mm256_mul_ps(t, _mm256_sub_ps(b, a))));
+            }
+            ResampleLinearScalar(in, position, step, out, count, i);
+        }
+
+        MIXER_AVX_FUNCTION void ResampleCubicAvx(const float* in, float position, float step, float* out, uint32_t count)
+        {
+            const __m256 lanes = AvxLanes();
+            const __m256 start = _mm256_set1_ps(position);
+            const __m256 stride = _mm256_set1_ps(step);
+            const __m256 half = _mm256_set1_ps(0.5f);
+            const __m256 oneAndHalf = _mm256_set1_ps(1.5f);
+            const __m256 two = _mm256_set1_ps(2.0f);
+            const __m256 twoAndHalf = _mm256_set1_ps(2.5f);
+            alignas(32) int32_t index[8];
+
+            uint32_t i = 0;
+            for (; i + 8 <= count; i += 8)
+            {
+                const __m256 p = _mm256_add_ps(start, _mm256_mul_ps(_mm256_add_ps(_mm256_set1_ps(static_cast<float>(i)), lanes), stride));
+                const __m256i whole = _mm256_cvttps_epi32(p);
+                const __m256 t = _mm256_sub_ps(p, _mm256_cvtepi32_ps(whole));
+                _mm256_store_si256(reinterpret_cast<__m256i*>(index), whole);
+
+                const __m256 y0 = GatherAvx(in, index, -1);
+                const __m256 y1 = GatherAvx(in, index, 0);
+                const __m256 y2 = GatherAvx(in, index, 1);
+                const __m256 y3 = GatherAvx(in, index, 2);
+
+                const __m256 c1 = _mm256_mul_ps(half, _mm256_sub_ps(y2, y0));
+                const __m256 c2 = _mm256_sub_ps(_mm256_add_ps(_mm256_sub_ps(y0, _mm256_mul_ps(twoAndHalf, y1)), _mm256_mul_ps(two, y2)),
+                    _mm256_mul_ps(half, y3));
+                const __m256 c3 = _mm256_add_ps(_mm256_mul_ps(half, _mm256_sub_ps(y3, y0)), _mm256_mul_ps(oneAndHalf, _mm256_sub_ps(y1, y2)));
+                const __m256 result = _mm256_add_ps(
+                    _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(c3, t), c2), t), c1), t), y1);
+                _mm256_storeu_ps(out + i, result);
+            }
+            ResampleCubicScalar(in, position, step, out, count, i);
+        }
+
+        MIXER_AVX_FUNCTION void MixRampAvx(float* bus, const float* in, uint32_t count, float gain, float gainStep)
+        {
+            const __m256 lanes = AvxLanes();
+            const __m256 start = _mm256_set1_ps(gain);
+            const __m256 stride = _mm256_set1_ps(gainStep);
+
+            uint32_t i = 0;
+            for (; i + 8 <= count; i += 8)
+            {
+                const __m256 g = _mm256_add_ps(start, _mm256_mul_ps(_mm256_add_ps(_mm256_set1_ps(static_cast<float>(i)), lanes), stride));
+                _mm256_storeu_ps(bus + i, _mm256_add_ps(_mm256_loadu_ps(bus + i), _mm256_mul_ps(_mm256_loadu_ps(in + i), g)));
+            }
+            MixRampScalar(bus, in, count, gain, gainStep, i);
+        }
+
+        MIXER_AVX_FUNCTION void MixRampStereoAvx(float* left, float* right, const float* in, uint32_t count,
+            float leftGain, float leftStep, float rightGain, float rightStep)
+        {
+            const __m256 lanes = AvxLanes();
+            const __m256 leftStart = _mm256_set1_ps(leftGain);
+            const __m256 leftStride = _mm256_set1_ps(leftStep);
+            const __m256 rightStart = _mm256_set1_ps(rightGain);
+            const __m256 rightStride = _mm256_set1_ps(rightStep);
+
+            uint32_t i = 0;
+            for (; i + 8 <= count; i += 8)
+            {
+                const __m256 index = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(i)), lanes);
+                const __m256 sample = _mm256_loadu_ps(in + i);
+                const __m256 l = _mm256_add_ps(leftStart, _mm256_mul_ps(index, leftStride));
+                const __m256 r = _mm256_add_ps(rightStart, _mm256_mul_ps(index, rightStride));
+                _mm256_storeu_ps(left + i, _mm256_add_ps(_mm256_loadu_ps(left + i), _mm256_mul_ps(sample, l)));
+                _mm256_storeu_ps(right + i, _mm256_add_ps(_mm256_loadu_ps(right + i), _mm256_mul_ps(sample, r)));
+            }
+            MixRampStereoScalar(left, right, in, count, leftGain, leftStep, rightGain, rightStep, i);
+        }
+
+        MIXER_AVX_FUNCTION void InterleaveAvx(const float* const* bus, uint32_t channels, float* out, uint32_t frameCount)
+        {
+            const __m256 low = _mm256_set1_ps(-1.0f);
+            const __m256 high = _mm256_set1_ps(1.0f);
+            uint32_t i = 0;
+            if (channels == 1)
+            {
+                for (; i + 8 <= frameCount; i += 8)
+                {
+                    _mm256_storeu_ps(out + i, _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(bus[0] + i), low), high));
+                }
+            }
+            else if (channels == 2)
+            {
+                for (; i + 8 <= frameCount; i += 8)
+                {
+                    // The unpacks work within 128-bit halves, the permutes put the halves back in frame order
+                    const __m256 l = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(bus[0] + i), low), high);
+                    const __m256 r = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(bus[1] + i), low), high);
+                    const __m256 first = _mm256_unpacklo_ps(l, r);
+                    const __m256 second = _mm256_unpackhi_ps(l, r);
+                    _mm256_storeu_ps(out + i * 2, _mm256_permute2f128_ps(first, second, 0x20));
+                    _mm256_storeu_ps(out + i * 2 + 8, _mm256_permute2f128_ps(first, second, 0x31));
+                }
+            }
+            InterleaveScalar(bus, channels, out, frameCount, i);
+        }
+
+        const MixerKernels kAvxKernels =
+        {
+            EMixerInstructionSet::kAvx, "avx",
+            DeinterleaveSse, ResampleLinearAvx, ResampleCubicAvx, MixRampAvx, MixRampStereoAvx, InterleaveAvx, ToInt16Sse
+        };
+
+        bool CpuSupportsAvx()
+        {
+#if defined(_MSC_VER)
+            // The CPU has to support AVX and the OS has to save the YMM registers on a context switch
+            int info[4];
+            __cpuid(info, 1);
+            const bool osxsave = (info[2] & (1 << 27)) != 0;
+            const bool avx = (info[2] & (1 << 28)) != 0;
+            return osxsave && avx && (_xgetbv(0) & 0x6) == 0x6;
+#else
+            return __builtin_cpu_supports("avx");
+#endif
+        }
+#endif
+    }
+
+    EMixerInstructionSet GetMixerInstructionSet()
+    {
+#if MIXER_HAS_X64
+        static const EMixerInstructionSet supported = CpuSupportsAvx() ? EMixerInstructionSet::kAvx : EMixerInstructionSet::kSse;
+        return supported;
+#else
+        return EMixerInstructionSet::kScalar;
+#endif
+    }
+
+    const MixerKernels& GetMixerKernels(EMixerInstructionSet instructionSet)
+    {
+        const EMixerInstructionSet supported = GetMixerInstructionSet();
+        if (static_cast<int>(instructionSet) > static_cast<int>(supported))
+        {
+            instructionSet = supported;
+        }
+
+        switch (instructionSet)
+        {
+#if MIXER_HAS_X64
+        case EMixerInstructionSet::kAvx:
+            return kAvxKernels;
+        case EMixerInstructionSet::kSse:
+            return kSseKernels;
+#endif
+        default:
+            return kScalarKernels;
+        }
+    }
+
+    const MixerKernels& GetMixerKernels()
+    {
+        return GetMixerKernels(GetMixerInstructionSet());
+    }
+}
@@ -0,0 +1,52 @@
+﻿// © 2025 Yanan Liu <yanan.liu0325@gmail.com>
+
+#pragma once
+
+#include <cstdint>
+
+namespace Engine
+{
+    // Instruction sets the software mixer has kernels for
+    enum class EMixerInstructionSet
+    {
+        kScalar,    // Plain C++, any CPU
+        kSse,       // SSE2, every x64 CPU
+        kAvx        // 8-wide float kernels, the integer conversions stay on SSE since AVX has no 256-bit integer ops
+    };
+
+    // Inner loops of the software mixer. Every array is float in [-1, 1] unless noted, nothing needs to be aligned.
+    // All three sets give the same results up to float rounding
+    struct MixerKernels
+    {
+        EMixerInstructionSet instructionSet;
+        const char* name;
+
+        // Split interleaved 16-bit frames into one float array per channel
+        void (*deinterleave)(const int16_t* in, uint32_t channels, float* const* out, uint32_t frameCount);
+
+        // out[i] = in sampled at position + i * step. in must hold one frame before and two after every
+        // position read, the cubic kernel is a Catmull-Rom spline through those four frames
+        void (*resampleLinear)(const float* in, float position, float step, float* out, uint32_t count);
+        void (*resampleCubic)(const float* in, float position, float step, float* out, uint32_t count);
+
+        // bus[i] += in[i] * (gain + i * gainStep), a gain ramp summed into the bus
+        void (*mixRamp)(float* bus, const float* in, uint32_t count, float gain, float gainStep);
+
+        // Pan one channel into two bus channels in a single pass, each side with its own ramp
+        void (*mixRampStereo)(float* left, float* right, const float* in, uint32_t count,
+            float leftGain, float leftStep, float rightGain, float rightStep);
+
+        // Interleave the bus channels into out, clamped to [-1, 1]
+        void (*interleave)(const float* const* bus, uint32_t channels, float* out, uint32_t frameCount);
+
+        // Convert interleaved floats to 16-bit, for outputs without a float format
+        void (*toInt16)(const float* in, int16_t* out, uint32_t count);
+    };
+
+    // Widest instruction set the CPU and OS support, checked once
+    EMixerInstructionSet GetMixerInstructionSet();
+
+    // Kernels for the instruction set, or for the widest supported one if the CPU lacks it
+    const MixerKernels& GetMixerKernels(EMixerInstructionSet instructionSet);
+    const MixerKernels& GetMixerKernels();
+}
@@ -0,0 +1,264 @@
+﻿// © 2025 Yanan Liu <yanan.liu0325@gmail.com>
+
+#include "MixerSink.h"
+#include "MixerKernels.h"
+#include "AudioStatsRecorder.h"
+#include "AL/al.h"
+#include "AL/alc.h"
+#include "AL/alext.h"
+#include "AL/dr_wav.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace Engine
+{
+    namespace
+    {
+        // Drops every block, for servers and tests that only need the mix to advance
+        class NullMixerSink : public MixerSink
+        {
+        public:
+            virtual bool Open(uint32_t, uint32_t) override { return true; }
+            virtual void Close() override {}
+            virtual bool IsRealTime() const override { return false; }
+            virtual uint32_t GetFreeBlocks() override { return 1; }
+            virtual bool Write(const float*, uint32_t) override { return true; }
+        };
+
+        // Records the mix to a 32-bit float WAV, bit for bit what the mixer produced
+        class WavFileMixerSink : public MixerSink
+        {
+        public:
+            explicit WavFileMixerSink(const char* path)
+                : m_Path(path ? path : "")
+                , m_Open(false)
+            {
+            }
+
+            virtual ~WavFileMixerSink()
+            {
+                Close();
+            }
+
+            virtual bool Open(uint32_t sampleRate, uint32_t channels) override
+            {
+                drwav_data_format format;
+                format.container = drwav_container_riff;
+                format.format = DR_WAVE_FORMAT_IEEE_FLOAT;
+                format.channels = channels;
+                format.sampleRate = sampleRate;
+                format.bitsPerSample = 32;
+                if (m_Path.empty() || !drwav_init_file_write(&m_Wav, m_Path.c_str(), &format, nullptr))
+                {
+                    printf("Error: Failed to open '%s' for the mixer output\n", m_Path.c_str());
+                    return false;
+                }
+                m_Open = true;
+                return true;
+            }
+
+            virtual void Close() override
+            {
+                // Finishing the file writes the chunk sizes into its header
+                if (m_Open)
+                {
+                    drwav_uninit(&m_Wav);
+                    m_Open = false;
+                }
+            }
+
+            virtual bool IsRealTime() const override { return false; }
+            virtual uint32_t GetFreeBlocks() override { return 1; }
+
+            virtual bool Write(const float* frames, uint32_t frameCount) override
+            {
+                return m_Open && drwav_write_pcm_frames(&m_Wav, frameCount, frames) == frameCount;
+            }
+
+        private:
+            std::string m_Path;
+            drwav m_Wav;
+            bool m_Open;
+        };
+
+        // Plays the mix on the default device through one streaming source. OpenAL only resamples and
+        // outputs it, every voice has already been mixed
+        class OpenALMixerSink : public MixerSink
+        {
+        public:
+            // Blocks queued on the source, the output latency is this many mixer ticks
+            static constexpr int kBufferCount = 6;
+
+            explicit OpenALMixerSink(AudioStatsRecorder& stats)
+                : m_Stats(stats)
+                , m_Device(nullptr)
+                , m_Context(nullptr)
+                , m_Source(0)
+                , m_Buffers{}
+                , m_Format(AL_FORMAT_STEREO16)
+                , m_SampleRate(0)
+                , m_Channels(0)
+                , m_Float(false)
+            {
+            }
+
+            virtual ~OpenALMixerSink()
+            {
+                Close();
+            }
+
+            virtual bool Open(uint32_t sampleRate, uint32_t channels) override
+            {
+                m_Device = alcOpenDevice(nullptr);
+                if (!m_Device)
+                {
+                    printf("Error: Failed to open the audio device for the mixer output\n");
+                    return false;
+                }
+
+                m_Context = alcCreateContext(m_Device, nullptr);
+                if (!m_Context || !alcMakeContextCurrent(m_Context))
+                {
+                    Close();
+                    return false;
+                }
+
+                alGenSources(1, &m_Source);
+                if (m_Stats.TakeALError() != AL_NO_ERROR)
+                {
+                    m_Stats.RecordFailedSourceGen();
+                    Close();
+                    return false;
+                }
+
+                alGenBuffers(kBufferCount, m_Buffers);
+                if (m_Stats.TakeALError() != AL_NO_ERROR)
+                {
+                    Close();
+                    return false;
+                }
+
+                // Float buffers pass the mix through untouched, otherwise it is converted to 16-bit
+                m_Float = alIsExtensionPresent("AL_EXT_float32") == AL_TRUE;
+                if (m_Float)
+                {
+                    m_Format = channels == 1 ? AL_FORMAT_MONO_FLOAT32 : AL_FORMAT_STEREO_FLOAT32;
+                }
+                else
+                {
+                    m_Format = channels == 1 ? AL_FORMAT_MONO16 : AL_FORMAT_STEREO16;
+                }
+
+                m_SampleRate = sampleRate;
+                m_Channels = channels;
+                m_IdleBuffers.assign(m_Buffers, m_Buffers + kBufferCount);
+                return true;
+            }
+
+            virtual void Close() override
+            {
+                if (m_Source)
+                {
+                    // Stopping marks every buffer processed, unqueueing them all
+                    alSourceStop(m_Source);
+                    alSourcei(m_Source, AL_BUFFER, 0);
+                    alDeleteSources(1, &m_Source);
+                    m_Source = 0;
+                }
+                if (m_Buffers[0])
+                {
+                    alDeleteBuffers(kBufferCount, m_Buffers);
+                    m_Buffers[0] = 0;
+                }
+                m_IdleBuffers.clear();
+
+                if (m_Context)
+                {
+                    alcMakeContextCurrent(nullptr);
+                    alcDestroyContext(m_Context);
+                    m_Context = nullptr;
+                }
+                if (m_Device)
+                {
+                    alcCloseDevice(m_Device);
+                    m_Device = nullptr;
+                }
+            }
+
+            virtual bool IsRealTime() const override { return true; }
+
+            virtual uint32_t GetFreeBlocks() override
+            {
+                ALint processed = 0;
+                alGetSourcei(m_Source, AL_BUFFERS_PROCESSED, &processed);
+                while (processed-- > 0)
+                {
+                    ALuint buffer = 0;
+                    alSourceUnqueueBuffers(m_Source, 1, &buffer);
+                    m_IdleBuffers.push_back(buffer);
+                }
+                return static_cast<uint32_t>(m_IdleBuffers.size());
+            }
+
+            virtual bool Write(const float* frames, uint32_t frameCount) override
+            {
+                if (m_IdleBuffers.empty()) return false;
+
+                const ALuint buffer = m_IdleBuffers.back();
+                const uint32_t sampleCount = frameCount * m_Channels;
+                if (m_Float)
+                {
+                    alBufferData(buffer, m_Format, frames, static_cast<ALsizei>(sampleCount * sizeof(float)),
+                        static_cast<ALsizei>(m_SampleRate));
+                }
+                else
+                {
+                    m_Pcm.resize(sampleCount);
+                    GetMixerKernels().toInt16(frames, m_Pcm.data(), sampleCount);
+                    alBufferData(buffer, m_Format, m_Pcm.data(), static_cast<ALsizei>(sampleCount * sizeof(int16_t)),
+                        static_cast<ALsizei>(m_SampleRate));
+                }
+                if (m_Stats.TakeALError() != AL_NO_ERROR) return false;
+
+                alSourceQueueBuffers(m_Source, 1, &buffer);
+                m_IdleBuffers.pop_back();
+
+                // Start once every buffer is queued, and again after running dry
+                ALint state = AL_STOPPED;
+                alGetSourcei(m_Source, AL_SOURCE_STATE, &state);
+                if (state != AL_PLAYING && m_IdleBuffers.empty())
+                {
+                    alSourcePlay(m_Source);
+                }
+                return true;
+            }
+
+        private:
+            AudioStatsRecorder& m_Stats;
+            ALCdevice* m_Device;
+            ALCcontext* m_Context;
+            ALuint m_Source;
+            ALuint m_Buffers[kBufferCount];
+            std::vector<ALuint> m_IdleBuffers;
+            std::vector<int16_t> m_Pcm;
+            ALenum m_Format;
+            uint32_t m_SampleRate;
+            uint32_t m_Channels;
+            bool m_Float;
+        };
+    }
+
+    std::unique_ptr<MixerSink> MixerSink::Create(IAudio::EAudioSink sink, const char* wavPath, AudioStatsRecorder& stats)
+    {
+        switch (sink)
+        {
+        case IAudio::EAudioSink::kWavFile:
+            return std::make_unique<WavFileMixerSink>(wavPath);
+        case IAudio::EAudioSink::kNull:
+            return std::make_unique<NullMixerSink>();
+        default:
+            return std::make_unique<OpenALMixerSink>(stats);
+        }
+    }
+}
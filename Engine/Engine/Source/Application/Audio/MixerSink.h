@@ -0,0 +1,38 @@
+﻿// © 2025 Yanan Liu <yanan.liu0325@gmail.com>
+
+#pragma once
+
+#include "IAudio.h"
+#include <cstdint>
+#include <memory>
+
+namespace Engine
+{
+    class AudioStatsRecorder;
+
+    // Where the software mixer delivers its output, one block of interleaved float frames at a time
+    class MixerSink
+    {
+    public:
+        // Default destructor
+        virtual ~MixerSink() {}
+
+        // Get ready for frames in the format, false if the output can't be opened
+        virtual bool Open(uint32_t sampleRate, uint32_t channels) = 0;
+        virtual void Close() = 0;
+
+        // Paced by a device clock, the mixer thread writes whenever it has room. A sink that isn't (a file, nothing)
+        // takes any amount at once, the mix then only advances through RenderAudio
+        virtual bool IsRealTime() const = 0;
+
+        // Blocks that can be written without waiting
+        virtual uint32_t GetFreeBlocks() = 0;
+
+        // Take one block
+        virtual bool Write(const float* frames, uint32_t frameCount) = 0;
+
+        // Create the sink chosen in the options, wavPath is only used by EAudioSink::kWavFile.
+        // The OpenAL sink counts its AL errors on stats
+        static std::unique_ptr<MixerSink> Create(IAudio::EAudioSink sink, const char* wavPath, AudioStatsRecorder& stats);
+    };
+}
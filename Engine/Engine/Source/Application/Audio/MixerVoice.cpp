@@ -0,0 +1,418 @@
+﻿// © 2025 Yanan Liu <yanan.liu0325@gmail.com>
+
+#include "MixerVoice.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace Engine
+{
+    // Frames converted per decoder read
+    static constexpr uint32_t kPcmBlockFrames = 1024;
+
+    MixerVoice::MixerVoice(uint32_t audioKey, std::shared_ptr<const DecodedAudio> audio)
+        : MixerVoice(audioKey, std::unique_ptr<AudioDecoder>())
+    {
+        m_Source = ESource::kResident;
+        m_Audio = std::move(audio);
+    }
+
+    MixerVoice::MixerVoice(uint32_t audioKey, std::shared_ptr<ProgressiveAudio> audio)
+        : MixerVoice(audioKey, std::unique_ptr<AudioDecoder>())
+    {
+        m_Source = ESource::kProgressive;
+        m_Progressive = std::move(audio);
+    }
+
+    MixerVoice::MixerVoice(uint32_t audioKey, std::unique_ptr<AudioDecoder> decoder)
+        : m_AudioKey(audioKey)
+        , m_Source(ESource::kStream)
+        , m_Decoder(std::move(decoder))
+        , m_Channels(0)
+        , m_SampleRate(0)
+        , m_Cursor(0)
+        , m_LoopStart(0)
+        , m_LoopEnd(0)
+        , m_WindowFrames(0)
+        , m_Position(0.0)
+        , m_SourceEnded(false)
+        , m_EndFrame(0)
+        , m_Finished(false)
+        , m_CurrentGains{}
+        , m_Started(false)
+        , m_Priority(0)
+        , m_Gain(1.0f)
+        , m_Pan(0.0f)
+        , m_Looping(false)
+        , m_Paused(false)
+        , m_Muted(false)
+    {
+        Rewind();
+    }
+
+    bool MixerVoice::Mix(const MixerKernels& kernels, float* const* bus, uint32_t busChannels, uint32_t outputRate,
+        uint32_t frameCount, IAudio::EAudioResampler resampler, bool audible)
+    {
+        if (m_Finished) return false;
+        if (m_Source == ESource::kProgressive && m_Progressive->HasFailed())
+        {
+            m_Finished = true;
+            return false;
+        }
+
+        if (!m_Channels && !Prepare())
+        {
+            // Waiting for a progressive decode to start, anything else can't be played
+            m_Finished = m_Source != ESource::kProgressive || m_Progressive->GetSampleRate() != 0;
+            return !m_Finished;
+        }
+
+        float targetGains[kMaxChannels][kMaxChannels];
+        GetChannelGains(busChannels, targetGains);
+        if (!m_Started)
+        {
+            // The first block starts at the target, ramping up from silence would soften the attack
+            std::memcpy(m_CurrentGains, targetGains, sizeof(m_CurrentGains));
+            m_Started = true;
+        }
+
+        // Nothing is read for a voice nobody hears, unless the source can't tell where it ends
+        const double step = static_cast<double>(m_SampleRate) / outputRate;
+        if (!audible && (m_Source != ESource::kStream || m_Decoder->GetTotalFrames() != 0))
+        {
+            std::memcpy(m_CurrentGains, targetGains, sizeof(m_CurrentGains));
+            return Skip(frameCount * step);
+        }
+
+        // Make sure the window covers every frame the interpolators touch in this block
+        const uint32_t needed = static_cast<uint32_t>(m_Position + (frameCount - 1) * step) + 3;
+        if (m_Window[0].size() < needed)
+        {
+            for (uint32_t c = 0; c < m_Channels; ++c)
+            {
+                m_Window[c].resize(needed);
+            }
+        }
+
+        if (m_WindowFrames < needed)
+        {
+            const uint32_t wanted = needed - m_WindowFrames;
+            const uint32_t read = m_SourceEnded ? 0 : ReadSource(kernels, m_WindowFrames, wanted);
+            if (!m_SourceEnded && read < wanted && !IsStarving())
+            {
+                m_SourceEnded = true;
+                m_EndFrame = m_WindowFrames + read;
+            }
+
+            // Past the end, or a progressive decode that fell behind, plays silence
+            for (uint32_t c = 0; c < m_Channels; ++c)
+            {
+                std::fill(m_Window[c].begin() + m_WindowFrames + read, m_Window[c].begin() + needed, 0.0f);
+            }
+            m_WindowFrames = needed;
+        }
+
+        if (audible)
+        {
+            const uint32_t whole = static_cast<uint32_t>(m_Position);
+            const float position = static_cast<float>(m_Position - whole);
+            const float stride = static_cast<float>(step);
+            const float* resampled[kMaxChannels] = {};
+            for (uint32_t c = 0; c < m_Channels; ++c)
+            {
+                if (m_SampleRate == outputRate && position == 0.0f)
+                {
+                    // Same rate and on a frame boundary, the window is the output
+                    resampled[c] = m_Window[c].data() + whole;
+                    continue;
+                }
+
+                m_Resampled[c].resize(frameCount);
+                if (resampler == IAudio::EAudioResampler::kLinear)
+                {
+                    kernels.resampleLinear(m_Window[c].data() + whole, position, stride, m_Resampled[c].data(), frameCount);
+                }
+                else
+                {
+                    // whole is at least 1, so the frame before the first position is in the window
+                    kernels.resampleCubic(m_Window[c].data() + whole, position, stride, m_Resampled[c].data(), frameCount);
+                }
+                resampled[c] = m_Resampled[c].data();
+            }
+
+            const float rampScale = 1.0f / static_cast<float>(frameCount);
+            auto rampStep = [&](uint32_t source, uint32_t target)
+            {
+                return (targetGains[source][target] - m_CurrentGains[source][target]) * rampScale;
+            };
+
+            if (busChannels == 2 && m_Channels == 1)
+            {
+                kernels.mixRampStereo(bus[0], bus[1], resampled[0], frameCount,
+                    m_CurrentGains[0][0], rampStep(0, 0), m_CurrentGains[0][1], rampStep(0, 1));
+            }
+            else
+            {
+                for (uint32_t c = 0; c < m_Channels; ++c)
+                {
+                    for (uint32_t b = 0; b < busChannels; ++b)
+                    {
+                        if (m_CurrentGains[c][b] == 0.0f && targetGains[c][b] == 0.0f) continue;
+                        kernels.mixRamp(bus[b], resampled[c], frameCount, m_CurrentGains[c][b], rampStep(c, b));
+                    }
+                }
+            }
+        }
+        std::memcpy(m_CurrentGains, targetGains, sizeof(m_CurrentGains));
+
+        return Advance(frameCount * step);
+    }
+
+    bool MixerVoice::Skip(double frames)
+    {
+        const double target = m_Position + frames;
+        if (m_SourceEnded || target < m_WindowFrames)
+        {
+            return Advance(frames);
+        }
+
+        // Past the window: skip the source frames in between and start over from an empty window on the frame reached
+        const uint64_t whole = static_cast<uint64_t>(target);
+        // The frame reached has to exist too, landing right after the last one is the end
+        const uint64_t wanted = whole - m_WindowFrames;
+        const bool ended = SkipSource(wanted) < wanted || (!m_Looping && m_Cursor >= GetSourceFrames());
+        if (ended && !IsStarving())
+        {
+            m_Finished = true;
+            return false;
+        }
+
+        // A silent frame of history, the voice is inaudible anyway
+        for (uint32_t c = 0; c < m_Channels; ++c)
+        {
+            m_Window[c][0] = 0.0f;
+        }
+        m_WindowFrames = 1;
+        m_Position = 1.0 + (target - static_cast<double>(whole));
+        return true;
+    }
+
+    bool MixerVoice::Advance(double frames)
+    {
+        m_Position += frames;
+        if (m_SourceEnded && m_Position >= m_EndFrame)
+        {
+            m_Finished = true;
+            return false;
+        }
+
+        // Drop what has been played, keeping one frame of history
+        const uint32_t consumed = static_cast<uint32_t>(m_Position) - 1;
+        if (consumed > 0)
+        {
+            for (uint32_t c = 0; c < m_Channels; ++c)
+            {
+                std::memmove(m_Window[c].data(), m_Window[c].data() + consumed, (m_WindowFrames - consumed) * sizeof(float));
+            }
+            m_WindowFrames -= consumed;
+            m_Position -= consumed;
+            m_EndFrame = m_EndFrame > consumed ? m_EndFrame - consumed : 0;
+        }
+        return true;
+    }
+
+    void MixerVoice::Rewind()
+    {
+        if (m_Channels)
+        {
+            SeekSource(0);
+        }
+
+        // One silent frame of history before the first one
+        m_WindowFrames = 1;
+        for (uint32_t c = 0; c < m_Channels; ++c)
+        {
+            m_Window[c].assign(std::max<size_t>(m_Window[c].size(), 1), 0.0f);
+        }
+        m_Position = 1.0;
+        m_SourceEnded = false;
+        m_EndFrame = 0;
+        m_Finished = false;
+    }
+
+    bool MixerVoice::Prepare()
+    {
+        switch (m_Source)
+        {
+        case ESource::kResident:
+            m_Channels = m_Audio->channels;
+            m_SampleRate = m_Audio->sampleRate;
+            m_LoopStart = m_Audio->loopStart;
+            m_LoopEnd = m_Audio->loopEnd;
+            break;
+        case ESource::kProgressive:
+            if (m_Progressive->GetSampleRate() == 0) return false;
+            m_Channels = m_Progressive->GetChannels();
+            m_SampleRate = m_Progressive->GetSampleRate();
+            break;
+        case ESource::kStream:
+            m_Channels = m_Decoder->GetChannels();
+            m_SampleRate = m_Decoder->GetSampleRate();
+            m_LoopStart = m_Decoder->GetLoopStart();
+            m_LoopEnd = m_Decoder->GetLoopEnd();
+            break;
+        }
+
+        if (m_Channels == 0 || m_Channels > kMaxChannels || m_SampleRate == 0)
+        {
+            m_Channels = 0;
+            return false;
+        }
+
+        if (m_Source != ESource::kResident)
+        {
+            m_Pcm.resize(static_cast<size_t>(kPcmBlockFrames) * m_Channels);
+        }
+        for (uint32_t c = 0; c < m_Channels; ++c)
+        {
+            m_Window[c].assign(1, 0.0f);
+        }
+        return true;
+    }
+
+    uint32_t MixerVoice::ReadSource(const MixerKernels& kernels, uint32_t offset, uint32_t frameCount)
+    {
+        uint32_t total = 0;
+        bool wrapped = false;
+        while (total < frameCount)
+        {
+            // While looping, reads stop at the loop end. kLoopToEnd runs until the decoder has no more
+            const bool loopRegion = m_Looping && m_LoopEnd != 0 && m_LoopEnd != kLoopToEnd;
+            uint32_t wanted = frameCount - total;
+            if (loopRegion)
+            {
+                wanted = m_Cursor < m_LoopEnd ? static_cast<uint32_t>(std::min<uint64_t>(wanted, m_LoopEnd - m_Cursor)) : 0;
+            }
+
+            float* out[kMaxChannels] = {};
+            for (uint32_t c = 0; c < m_Channels; ++c)
+            {
+                out[c] = m_Window[c].data() + offset + total;
+            }
+
+            const uint32_t read = wanted > 0 ? ReadFrames(kernels, out, wanted) : 0;
+            if (read > 0)
+            {
+                m_Cursor += read;
+                total += read;
+                wrapped = false;
+                continue;
+            }
+
+            // At the end of the source or of its loop. Wrapping twice in a row means the loop is empty
+            if (!m_Looping || wrapped || IsStarving() || !SeekSource(m_LoopEnd != 0 ? m_LoopStart : 0))
+            {
+                break;
+            }
+            wrapped = true;
+        }
+        return total;
+    }
+
+    uint32_t MixerVoice::ReadFrames(const MixerKernels& kernels, float* const* out, uint32_t frameCount)
+    {
+        switch (m_Source)
+        {
+        case ESource::kResident:
+        {
+            const uint64_t frames = m_Audio->GetSampleCount() / m_Audio->channels;
+            if (m_Cursor >= frames) return 0;
+
+            // Converted straight out of the sound's memory
+            const uint32_t count = static_cast<uint32_t>(std::min<uint64_t>(frameCount, frames - m_Cursor));
+            kernels.deinterleave(m_Audio->GetSamples() + m_Cursor * m_Audio->channels, m_Channels, out, count);
+            return count;
+        }
+        case ESource::kProgressive:
+        {
+            const uint64_t count = m_Progressive->Read(m_Cursor, m_Pcm.data(), std::min(frameCount, kPcmBlockFrames));
+            kernels.deinterleave(m_Pcm.data(), m_Channels, out, static_cast<uint32_t>(count));
+            return static_cast<uint32_t>(count);
+        }
+        case ESource::kStream:
+        {
+            const uint64_t count = m_Decoder->ReadFrames(m_Pcm.data(), std::min(frameCount, kPcmBlockFrames));
+            kernels.deinterleave(m_Pcm.data(), m_Channels, out, static_cast<uint32_t>(count));
+            return static_cast<uint32_t>(count);
+        }
+        }
+        return 0;
+    }
+
+    uint64_t MixerVoice::SkipSource(uint64_t frameCount)
+    {
+        const uint64_t length = GetSourceFrames();
+        const bool loopRegion = m_Looping && m_LoopEnd != 0 && m_LoopEnd != kLoopToEnd;
+        const uint64_t end = loopRegion ? std::min(length, m_LoopEnd) : length;
+        uint64_t skipped = end > m_Cursor ? std::min(frameCount, end - m_Cursor) : 0;
+        uint64_t cursor = m_Cursor + skipped;
+
+        // Whole trips around the loop change nothing, only the rest moves the cursor
+        const uint64_t loopStart = m_LoopEnd != 0 ? m_LoopStart : 0;
+        if (skipped < frameCount && m_Looping && !IsStarving() && end > loopStart)
+        {
+            cursor = loopStart + (frameCount - skipped) % (end - loopStart);
+            skipped = frameCount;
+        }
+        return SeekSource(cursor) ? skipped : 0;
+    }
+
+    uint64_t MixerVoice::GetSourceFrames() const
+    {
+        switch (m_Source)
+        {
+        case ESource::kResident: return m_Audio->GetSampleCount() / m_Channels;
+        case ESource::kProgressive: return m_Progressive->GetDecodedFrames();
+        case ESource::kStream: return m_Decoder->GetTotalFrames();
+        }
+        return 0;
+    }
+
+    bool MixerVoice::SeekSource(uint64_t frame)
+    {
+        if (m_Source == ESource::kStream && !m_Decoder->SeekToFrame(frame))
+        {
+            return false;
+        }
+        m_Cursor = frame;
+        return true;
+    }
+
+    void MixerVoice::GetChannelGains(uint32_t busChannels, float gains[kMaxChannels][kMaxChannels]) const
+    {
+        std::memset(gains, 0, sizeof(float) * kMaxChannels * kMaxChannels);
+        const float gain = GetEffectiveGain();
+
+        if (busChannels == 1)
+        {
+            // Stereo folds down to mono at half gain per channel
+            for (uint32_t c = 0; c < m_Channels; ++c)
+            {
+                gains[c][0] = m_Channels == 1 ? gain : gain * 0.5f;
+            }
+        }
+        else if (m_Channels == 1)
+        {
+            // Equal power: -3 dB per side in the center, the loudness stays the same across the field
+            const float angle = (m_Pan + 1.0f) * 0.785398163397f;
+            gains[0][0] = gain * std::cos(angle);
+            gains[0][1] = gain * std::sin(angle);
+        }
+        else
+        {
+            // Balance: panning turns the far side down and leaves the near side alone
+            gains[0][0] = gain * std::min(1.0f, 1.0f - m_Pan);
+            gains[1][1] = gain * std::min(1.0f, 1.0f + m_Pan);
+        }
+    }
+}
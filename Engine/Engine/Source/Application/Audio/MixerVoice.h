@@ -0,0 +1,150 @@
+﻿// © 2025 Yanan Liu <yanan.liu0325@gmail.com>
+
+#pragma once
+
+#include "IAudio.h"
+#include "AudioDecoder.h"
+#include "MixerKernels.h"
+#include "ProgressiveSound.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Engine
+{
+    // A sound or music track playing through the software mixer. It reads PCM from a resident sound, a progressive
+    // decode or a streaming decoder into a small float window, resamples the window to the output rate and sums it
+    // into the bus. Gain and pan changes ramp across one block, so volume steps and fades never click
+    class MixerVoice
+    {
+    public:
+        // Voices play mono or stereo sources
+        static constexpr uint32_t kMaxChannels = 2;
+
+        // Default constructor, for a sound that is fully decoded
+        MixerVoice(uint32_t audioKey, std::shared_ptr<const DecodedAudio> audio);
+
+        // For a sound still decoding, plays what is there and waits for the rest
+        MixerVoice(uint32_t audioKey, std::shared_ptr<ProgressiveAudio> audio);
+
+        // For music streamed from an open decoder
+        MixerVoice(uint32_t audioKey, std::unique_ptr<AudioDecoder> decoder);
+
+        MixerVoice(const MixerVoice&) = delete;
+        MixerVoice& operator=(const MixerVoice&) = delete;
+
+        // Add the next frameCount output frames to the bus. A voice that isn't audible only moves its cursor, nothing
+        // is read, resampled or summed (an MP3 stream still decodes, it can't tell where it ends). Returns false once
+        // the source has run out
+        bool Mix(const MixerKernels& kernels, float* const* bus, uint32_t busChannels, uint32_t outputRate, uint32_t frameCount,
+            IAudio::EAudioResampler resampler, bool audible);
+
+        // Start over from the first frame, a finished voice can play again
+        void Rewind();
+
+    public:
+        // --------------------------------------------------------------------- //
+        // Accessors & Mutators
+        // --------------------------------------------------------------------- //
+        uint32_t GetAudioKey() const { return m_AudioKey; }
+
+        // Mix returned false, the source has played out
+        bool IsFinished() const { return m_Finished; }
+
+        // Playing a sound while it decodes
+        bool IsProgressive() const { return m_Source == ESource::kProgressive; }
+
+        int GetPriority() const { return m_Priority; }
+        void SetPriority(int priority) { m_Priority = priority; }
+
+        // Target gain, reached over the next block
+        float GetGain() const { return m_Gain; }
+        void SetGain(float gain) { m_Gain = gain; }
+        float GetEffectiveGain() const { return m_Muted ? 0.0f : m_Gain; }
+
+        // -1 is full left, 1 full right. Mono sources pan with equal power, stereo ones are balanced
+        void SetPan(float pan) { m_Pan = pan < -1.0f ? -1.0f : (pan > 1.0f ? 1.0f : pan); }
+
+        bool IsLooping() const { return m_Looping; }
+        void SetLooping(bool looping) { m_Looping = looping; }
+
+        bool IsPaused() const { return m_Paused; }
+        void SetPaused(bool paused) { m_Paused = paused; }
+
+        bool IsMuted() const { return m_Muted; }
+        void SetMuted(bool muted) { m_Muted = muted; }
+
+    private:
+        enum class ESource
+        {
+            kResident,      // m_Audio
+            kProgressive,   // m_Progressive
+            kStream         // m_Decoder
+        };
+
+        // Pick up the source's format. False until a progressive decode has started, or if it isn't mono or stereo
+        bool Prepare();
+
+        // Convert up to frameCount source frames into the window from offset, wrapping at the loop end while
+        // looping. Returns the number of frames read
+        uint32_t ReadSource(const MixerKernels& kernels, uint32_t offset, uint32_t frameCount);
+
+        // Read without wrapping, 0 at the end of the source or of what has been decoded so far
+        uint32_t ReadFrames(const MixerKernels& kernels, float* const* out, uint32_t frameCount);
+        bool SeekSource(uint64_t frame);
+
+        // Move the cursor frameCount source frames on without reading them, wrapping like ReadSource.
+        // Returns the number of frames skipped
+        uint64_t SkipSource(uint64_t frameCount);
+
+        // Frames the source can give, a progressive decode only has what it has decoded so far
+        uint64_t GetSourceFrames() const;
+
+        // Move the play position without filling the window, for a voice nobody hears
+        bool Skip(double frames);
+
+        // Move the play position over frames already in the window and drop what has been played
+        bool Advance(double frames);
+
+        // The source has no more frames yet but is still decoding
+        bool IsStarving() const { return m_Source == ESource::kProgressive && !m_Progressive->IsComplete(); }
+
+        // Gain from each source channel to each bus channel
+        void GetChannelGains(uint32_t busChannels, float gains[kMaxChannels][kMaxChannels]) const;
+
+    private:
+        uint32_t m_AudioKey;
+        ESource m_Source;
+        std::shared_ptr<const DecodedAudio> m_Audio;
+        std::shared_ptr<ProgressiveAudio> m_Progressive;
+        std::unique_ptr<AudioDecoder> m_Decoder;
+        std::vector<int16_t> m_Pcm;             // Decoder output before conversion
+
+        uint32_t m_Channels;                    // 0 until Prepare
+        uint32_t m_SampleRate;
+        uint64_t m_Cursor;                      // Next source frame to read
+        uint64_t m_LoopStart;
+        uint64_t m_LoopEnd;                     // 0 loops the whole source
+
+        // Source frames converted to float, one array per channel. Frame 0 is history for the interpolators,
+        // m_Position is where the next output frame is sampled
+        std::vector<float> m_Window[kMaxChannels];
+        std::vector<float> m_Resampled[kMaxChannels];
+        uint32_t m_WindowFrames;
+        double m_Position;
+        bool m_SourceEnded;
+        uint32_t m_EndFrame;                    // Window frame after the last real one, once the source ended
+        bool m_Finished;
+
+        // Gains the last block ended on, the next block ramps from them
+        float m_CurrentGains[kMaxChannels][kMaxChannels];
+        bool m_Started;
+
+        int m_Priority;
+        float m_Gain;
+        float m_Pan;
+        bool m_Looping;
+        bool m_Paused;
+        bool m_Muted;
+    };
+}
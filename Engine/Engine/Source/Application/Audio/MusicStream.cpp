@@ -0,0 +1,453 @@
+﻿// © 2025 Yanan Liu <yanan.liu0325@gmail.com>
+
+#include "MusicStream.h"
+#include "AudioStatsRecorder.h"
+#include <algorithm>
+#include <cstring>
+
+namespace Engine
+{
+    MusicStream::MusicStream(AudioStatsRecorder& stats)
+        : m_Stats(stats)
+        , m_Current(0)
+        , m_Source(0)
+        , m_Buffers{}
+        , m_Format(AL_FORMAT_STEREO16)
+        , m_Looping(false)
+        , m_EndOfStream(false)
+        , m_Playing(false)
+        , m_BoundaryBuffer(0)
+        , m_TrackChanged(false)
+        , m_SwitchPending(false)
+    {
+        m_Tracks[0] = std::make_unique<Track>();
+        m_Tracks[1] = std::make_unique<Track>();
+        m_IdleBuffers.reserve(kBufferCount);
+    }
+
+    MusicStream::~MusicStream()
+    {
+        if (m_Source)
+        {
+            alSourceStop(m_Source);
+            DetachBuffers();
+            alDeleteSources(1, &m_Source);
+        }
+
+        if (m_Buffers[0])
+        {
+            alDeleteBuffers(kBufferCount, m_Buffers);
+        }
+    }
+
+    bool MusicStream::Open(const EncodedAudio& file, IAudio::EAudioFormat format, const char* name)
+    {
+        if (!OpenTrack(CurrentTrack(), file, format, name))
+        {
+            return false;
+        }
+        return CreateSource();
+    }
+
+    bool MusicStream::Open(std::unique_ptr<Track> track)
+    {
+        if (!track) return false;
+
+        m_Tracks[m_Current] = std::move(track);
+        return CreateSource();
+    }
+
+    bool MusicStream::CreateSource()
+    {
+        ConfigureFormat();
+
+        alGenSources(1, &m_Source);
+        if (m_Stats.TakeALError() != AL_NO_ERROR)
+        {
+            m_Stats.RecordFailedSourceGen();
+            return false;
+        }
+
+        alGenBuffers(kBufferCount, m_Buffers);
+        if (m_Stats.TakeALError() != AL_NO_ERROR)
+        {
+            return false;
+        }
+
+        // Streaming sources loop by rewinding the decoder, never through AL_LOOPING
+        alSourcef(m_Source, AL_PITCH, 1.0f);
+        alSourcef(m_Source, AL_GAIN, 1.0f);
+        alSourcei(m_Source, AL_LOOPING, AL_FALSE);
+        return true;
+    }
+
+    bool MusicStream::Play()
+    {
+        if (!m_Source) return false;
+
+        ALint queued = 0;
+        alGetSourcei(m_Source, AL_BUFFERS_QUEUED, &queued);
+
+        // Prime the ring before the first play (or after a stop)
+        if (queued == 0)
+        {
+            m_IdleBuffers.clear();
+            for (ALuint buffer : m_Buffers)
+            {
+                if (!FillBuffer(buffer))
+                {
+                    break;
+                }
+                alSourceQueueBuffers(m_Source, 1, &buffer);
+                ++queued;
+            }
+
+            if (queued == 0)
+            {
+                return false;
+            }
+        }
+
+        alSourcePlay(m_Source);
+        m_Playing = true;
+        return true;
+    }
+
+    bool MusicStream::Prebuffer()
+    {
+        if (!m_Source) return true;
+
+        ALint queued = 0;
+        alGetSourcei(m_Source, AL_BUFFERS_QUEUED, &queued);
+        if (queued >= kBufferCount || m_EndOfStream) return true;
+
+        // Nothing has played yet, so the ring is filled in order
+        ALuint buffer = m_Buffers[queued];
+        if (!FillBuffer(buffer)) return true;
+
+        alSourceQueueBuffers(m_Source, 1, &buffer);
+        return queued + 1 >= kBufferCount;
+    }
+
+    void MusicStream::Pause()
+    {
+        if (m_Source)
+        {
+            alSourcePause(m_Source);
+        }
+    }
+
+    void MusicStream::Stop()
+    {
+        if (!m_Source) return;
+
+        alSourceStop(m_Source);
+        DetachBuffers();
+
+        SeekTrack(CurrentTrack(), 0);
+        m_EndOfStream = false;
+        m_Playing = false;
+        m_SwitchPending = false;
+
+        // Stopped after the next track was reached in the ring, it is the current one now
+        if (m_BoundaryBuffer)
+        {
+            m_BoundaryBuffer = 0;
+            m_TrackChanged = true;
+        }
+    }
+
+    void MusicStream::Replay()
+    {
+        Stop();
+        Play();
+    }
+
+    bool MusicStream::Update()
+    {
+        if (!m_Playing) return false;
+
+        // Recycle every buffer the source is done with
+        ALint processed = 0;
+        alGetSourcei(m_Source, AL_BUFFERS_PROCESSED, &processed);
+        while (processed-- > 0)
+        {
+            ALuint buffer;
+            alSourceUnqueueBuffers(m_Source, 1, &buffer);
+
+            if (buffer == m_BoundaryBuffer)
+            {
+                m_BoundaryBuffer = 0;
+                m_TrackChanged = true;
+            }
+
+            m_IdleBuffers.push_back(buffer);
+        }
+        RefillIdleBuffers();
+
+        ALint queued = 0;
+        alGetSourcei(m_Source, AL_BUFFERS_QUEUED, &queued);
+        if (queued == 0)
+        {
+            // The next track needs a different buffer format, start it now that the ring is empty
+            if (m_SwitchPending)
+            {
+                m_SwitchPending = false;
+                AdvanceTrack();
+                ConfigureFormat();
+                m_TrackChanged = true;
+                return Play();
+            }
+
+            // Everything has been played
+            m_Playing = false;
+            return false;
+        }
+
+        // The source stops by itself when it runs dry, restart it once new data is queued
+        ALint state;
+        alGetSourcei(m_Source, AL_SOURCE_STATE, &state);
+        if (state == AL_STOPPED)
+        {
+            alSourcePlay(m_Source);
+        }
+
+        return true;
+    }
+
+    std::unique_ptr<MusicStream::Track> MusicStream::PrepareTrack(const EncodedAudio& file, IAudio::EAudioFormat format,
+        const char* name)
+    {
+        auto track = std::make_unique<Track>();
+        if (!OpenTrack(*track, file, format, name))
+        {
+            return nullptr;
+        }
+
+        // Decode the first block now so crossing into the track costs no more than any other refill
+        const uint32_t channels = track->decoder.GetChannels();
+        track->head.resize(static_cast<size_t>(kFramesPerBuffer) * channels);
+        uint64_t framesRead = track->decoder.ReadFrames(track->head.data(), kFramesPerBuffer);
+        track->head.resize(static_cast<size_t>(framesRead) * channels);
+        return track;
+    }
+
+    void MusicStream::QueueNext(std::unique_ptr<Track> track)
+    {
+        if (!track) return;
+
+        m_Tracks[m_Current ^ 1] = std::move(track);
+        m_SwitchPending = false;
+
+        // The current track may already have been decoded to its end, the ring continues into this one
+        // with the buffers that were left idle
+        m_EndOfStream = false;
+        if (m_Playing)
+        {
+            RefillIdleBuffers();
+        }
+    }
+
+    void MusicStream::ClearNext()
+    {
+        Track& next = NextTrack();
+        next.decoder.Close();
+        next.head.clear();
+        next.headOffset = 0;
+        next.position = 0;
+        m_SwitchPending = false;
+    }
+
+    std::unique_ptr<MusicStream::Track> MusicStream::TakeNext()
+    {
+        // Playback may have crossed into it already, then it is the current track
+        if (!NextTrack().decoder.IsOpen()) return nullptr;
+
+        std::unique_ptr<Track> next = std::move(m_Tracks[m_Current ^ 1]);
+        m_Tracks[m_Current ^ 1] = std::make_unique<Track>();
+        m_SwitchPending = false;
+        return next;
+    }
+
+    bool MusicStream::TakeTrackChange()
+    {
+        bool changed = m_TrackChanged;
+        m_TrackChanged = false;
+        return changed;
+    }
+
+    bool MusicStream::OpenTrack(Track& track, const EncodedAudio& file, IAudio::EAudioFormat format, const char* name)
+    {
+        track.head.clear();
+        track.headOffset = 0;
+        track.position = 0;
+        if (!track.decoder.Open(file, format, name))
+        {
+            return false;
+        }
+
+        // Only mono and stereo 16-bit are guaranteed by core OpenAL
+        if (track.decoder.GetChannels() != 1 && track.decoder.GetChannels() != 2)
+        {
+            printf("Error: Music file '%s' has %u channels, only mono and stereo can be streamed.\n",
+                name, track.decoder.GetChannels());
+            track.decoder.Close();
+            return false;
+        }
+        return true;
+    }
+
+    void MusicStream::AdvanceTrack()
+    {
+        CurrentTrack().decoder.Close();
+        CurrentTrack().head.clear();
+        CurrentTrack().headOffset = 0;
+        CurrentTrack().position = 0;
+        m_Current ^= 1;
+    }
+
+    void MusicStream::ConfigureFormat()
+    {
+        const AudioDecoder& decoder = CurrentTrack().decoder;
+        m_Format = (decoder.GetChannels() == 1) ? AL_FORMAT_MONO16 : AL_FORMAT_STEREO16;
+        m_Pcm.resize(static_cast<size_t>(kFramesPerBuffer) * decoder.GetChannels());
+    }
+
+    uint64_t MusicStream::ReadTrack(Track& track, int16_t* out, uint64_t frameCount)
+    {
+        const uint32_t channels = track.decoder.GetChannels();
+        uint64_t fromHead = std::min<uint64_t>(frameCount, (track.head.size() - track.headOffset) / channels);
+        if (fromHead > 0)
+        {
+            std::memcpy(out, track.head.data() + track.headOffset, static_cast<size_t>(fromHead) * channels * sizeof(int16_t));
+            track.headOffset += static_cast<size_t>(fromHead) * channels;
+            if (track.headOffset == track.head.size())
+            {
+                track.head.clear();
+                track.headOffset = 0;
+            }
+        }
+
+        uint64_t framesRead = fromHead;
+        if (fromHead < frameCount)
+        {
+            framesRead += track.decoder.ReadFrames(out + fromHead * channels, frameCount - fromHead);
+        }
+        track.position += framesRead;
+        return framesRead;
+    }
+
+    bool MusicStream::SeekTrack(Track& track, uint64_t frame)
+    {
+        // The decoder is past the head, drop it and read everything again from the decoder
+        track.head.clear();
+        track.headOffset = 0;
+        if (!track.decoder.SeekToFrame(frame))
+        {
+            return false;
+        }
+        track.position = frame;
+        return true;
+    }
+
+    bool MusicStream::FillBuffer(ALuint buffer)
+    {
+        const uint32_t channels = CurrentTrack().decoder.GetChannels();
+        uint64_t framesRead = 0;
+        bool rewound = false;
+
+        while (framesRead < kFramesPerBuffer)
+        {
+            Track& track = CurrentTrack();
+            const uint64_t loopStart = track.decoder.GetLoopStart();
+            const uint64_t loopEnd = track.decoder.GetLoopEnd();
+            const bool loopRegion = m_Looping && loopEnd > loopStart;
+
+            // Looping music with loop points plays the intro once, then repeats only up to the loop end
+            uint64_t wanted = kFramesPerBuffer - framesRead;
+            if (loopRegion && track.position < loopEnd)
+            {
+                wanted = std::min(wanted, loopEnd - track.position);
+            }
+
+            uint64_t read = ReadTrack(track, m_Pcm.data() + framesRead * channels, wanted);
+            framesRead += read;
+
+            if (read > 0)
+            {
+                rewound = false;
+                if (loopRegion && track.position >= loopEnd && !SeekTrack(track, loopStart))
+                {
+                    m_EndOfStream = true;
+                    break;
+                }
+                continue;
+            }
+
+            // Wrap around for looping music, to the loop start if there is one.
+            // Rewinding twice in a row means the track is empty
+            if (m_Looping)
+            {
+                if (rewound || !SeekTrack(track, loopRegion ? loopStart : 0))
+                {
+                    m_EndOfStream = true;
+                    break;
+                }
+                rewound = true;
+                continue;
+            }
+
+            // Carry on into the queued track in the same buffer when the formats match
+            const AudioDecoder& next = NextTrack().decoder;
+            if (next.IsOpen())
+            {
+                if (next.GetChannels() == channels && next.GetSampleRate() == CurrentTrack().decoder.GetSampleRate())
+                {
+                    AdvanceTrack();
+                    m_BoundaryBuffer = buffer;
+                    continue;
+                }
+
+                m_SwitchPending = true;
+                break;
+            }
+
+            // The track is over
+            m_EndOfStream = true;
+            break;
+        }
+
+        if (framesRead == 0)
+        {
+            return false;
+        }
+
+        alBufferData(buffer, m_Format, m_Pcm.data(),
+            static_cast<ALsizei>(framesRead * channels * sizeof(int16_t)),
+            static_cast<ALsizei>(CurrentTrack().decoder.GetSampleRate()));
+
+        return m_Stats.TakeALError() == AL_NO_ERROR;
+    }
+
+    void MusicStream::RefillIdleBuffers()
+    {
+        while (!m_IdleBuffers.empty() && !m_EndOfStream && !m_SwitchPending)
+        {
+            ALuint buffer = m_IdleBuffers.back();
+            if (!FillBuffer(buffer))
+            {
+                break;
+            }
+            m_IdleBuffers.pop_back();
+            alSourceQueueBuffers(m_Source, 1, &buffer);
+        }
+    }
+
+    void MusicStream::DetachBuffers()
+    {
+        m_IdleBuffers.clear();
+
+        // A stopped source has processed all its buffers, so detaching them is safe
+        alSourcei(m_Source, AL_BUFFER, 0);
+    }
+}
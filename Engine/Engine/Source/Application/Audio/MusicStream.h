@@ -0,0 +1,158 @@
+﻿// © 2025 Yanan Liu <yanan.liu0325@gmail.com>
+
+#pragma once
+
+#include "AudioDecoder.h"
+#include "AL/al.h"
+#include <memory>
+#include <vector>
+
+namespace Engine
+{
+    class AudioStatsRecorder;
+
+    // Music played from a small ring of OpenAL buffers that is refilled while the source plays,
+    // so memory stays constant no matter how long the track is.
+    // A next track can be queued behind the current one: its first block is decoded up front and the
+    // ring carries on into it on the same source, so the change is sample-gapless
+    class MusicStream
+    {
+    public:
+        // Number of buffers in the ring
+        static constexpr int kBufferCount = 4;
+
+        // Frames decoded into each buffer
+        static constexpr uint64_t kFramesPerBuffer = 8192;
+
+        // A decoder and the block decoded ahead of time from the start of its track
+        struct Track
+        {
+            AudioDecoder decoder;
+            std::vector<int16_t> head;
+            size_t headOffset = 0;    // Samples of head already played
+            uint64_t position = 0;    // Frames of the track read so far
+        };
+
+        // Open a track and decode its first block. Touches no stream, so it can run on any thread
+        // before the track is handed to Open or QueueNext. Null if the file can't be streamed
+        static std::unique_ptr<Track> PrepareTrack(const EncodedAudio& file, IAudio::EAudioFormat format, const char* name);
+
+        // Failed source generations and AL errors are counted on stats
+        explicit MusicStream(AudioStatsRecorder& stats);
+
+        // Default destructor
+        ~MusicStream();
+
+        MusicStream(const MusicStream&) = delete;
+        MusicStream& operator=(const MusicStream&) = delete;
+
+        // Open the encoded file and create the source and buffer ring, name is used in messages
+        bool Open(const EncodedAudio& file, IAudio::EAudioFormat format, const char* name);
+
+        // Same with a track prepared by PrepareTrack
+        bool Open(std::unique_ptr<Track> track);
+
+        // Fill the ring if it's empty and start (or resume) playback
+        bool Play();
+
+        // Queue one more block before playback starts, so a later Play() has nothing to decode.
+        // Returns true once the ring is full or the track has nothing more to give
+        bool Prebuffer();
+
+        // Pause playback, queued buffers are kept
+        void Pause();
+
+        // Stop playback, drop queued buffers and move back to the beginning of the track
+        void Stop();
+
+        // Stop and play again from the beginning
+        void Replay();
+
+        // Refill the buffers the source has finished with. Returns false once the track, and the next one
+        // if any, has ended
+        bool Update();
+
+        // Play a track prepared by PrepareTrack after the current one. Tracks with the same channels and
+        // sample rate are joined without a gap, others start once the current one has drained
+        void QueueNext(std::unique_ptr<Track> track);
+
+        // Forget the queued next track
+        void ClearNext();
+
+        // Hand back the queued next track if playback hasn't reached it, null otherwise
+        std::unique_ptr<Track> TakeNext();
+
+        // True once if playback moved on to the queued track since the last call
+        bool TakeTrackChange();
+
+    public:
+        // --------------------------------------------------------------------- //
+        // Accessors & Mutators
+        // --------------------------------------------------------------------- //
+        ALuint GetSource() const { return m_Source; }
+        bool IsLooping() const { return m_Looping; }
+        void SetLooping(bool looping) { m_Looping = looping; }
+        bool HasNext() const { return NextTrack().decoder.IsOpen(); }
+
+    private:
+        Track& CurrentTrack() { return *m_Tracks[m_Current]; }
+        Track& NextTrack() { return *m_Tracks[m_Current ^ 1]; }
+        const Track& NextTrack() const { return *m_Tracks[m_Current ^ 1]; }
+
+        // Open a track's decoder, only mono and stereo can be streamed
+        static bool OpenTrack(Track& track, const EncodedAudio& file, IAudio::EAudioFormat format, const char* name);
+
+        // Create the source and buffer ring for the current track
+        bool CreateSource();
+
+        // Make the next track the current one and close the finished one
+        void AdvanceTrack();
+
+        // Pick the AL format and scratch size for the current track
+        void ConfigureFormat();
+
+        // Read frames from the track's head first, then from its decoder
+        static uint64_t ReadTrack(Track& track, int16_t* out, uint64_t frameCount);
+        static bool SeekTrack(Track& track, uint64_t frame);
+
+        // Decode the next block into the buffer, returns false if there's nothing left to decode
+        bool FillBuffer(ALuint buffer);
+
+        // Decode into the idle buffers and queue them while there is something left to play
+        void RefillIdleBuffers();
+
+        // Unqueue every buffer from the source
+        void DetachBuffers();
+
+    private:
+        AudioStatsRecorder& m_Stats;
+
+        // Current track and the one queued behind it, swapped by index. Both are always allocated,
+        // a closed decoder means there is no track
+        std::unique_ptr<Track> m_Tracks[2];
+        int m_Current;
+
+        ALuint m_Source;
+        ALuint m_Buffers[kBufferCount];
+        ALenum m_Format;
+
+        // Buffers unqueued with nothing left to decode into them, refilled once a next track is queued
+        std::vector<ALuint> m_IdleBuffers;
+
+        // Scratch memory reused for every block
+        std::vector<int16_t> m_Pcm;
+
+        bool m_Looping;
+        bool m_EndOfStream;
+
+        // True between Play() and Stop() or the end of the track, used to recover from buffer underruns
+        bool m_Playing;
+
+        // Buffer holding the first frames of the next track, the change is reported once it has played
+        ALuint m_BoundaryBuffer;
+        bool m_TrackChanged;
+
+        // The next track can't share buffers with the current one, switch once the ring has drained
+        bool m_SwitchPending;
+    };
+}
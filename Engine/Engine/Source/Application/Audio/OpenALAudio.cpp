@@ -2,6 +2,7 @@
 
 #include "OpenALAudio.h"
 #include <algorithm>
+#include <cmath>
 #include <chrono>
 #include <thread>
 #define DR_WAV_IMPLEMENTATION // Include dr_wav implementation only once in the project
@@ -13,34 +14,107 @@
 
 namespace Engine
 {
-    OpenALAudio::OpenALAudio()
+    // Default period of the audio thread, short enough for smooth fades and quick voice reuse
+    static constexpr auto kDefaultTickInterval = std::chrono::milliseconds(5);
+
+    // Sources generated up front, OpenAL Soft mixes up to 256 by default
+    static constexpr uint32_t kSourcePoolSize = 128;
+
+    // Commands that can wait for the audio thread, one tick rarely has more than a few dozen
+    static constexpr size_t kCommandQueueSize = 1024;
+
+    // Voices checked per tick when OpenAL can't report stopped sources
+    static constexpr uint32_t kMaxFinishedPollsPerUpdate = 32;
+
+    // Resident PCM allowed before unused buffers start being evicted, about 25 minutes of 44.1 kHz stereo
+    static constexpr uint64_t kDefaultAudioMemoryBudget = 256ull * 1024 * 1024;
+
+    OpenALAudio::OpenALAudio(const AudioSystemOptions& options)
         : m_Device(nullptr)
         , m_Context(nullptr)
+        , m_SourcePool(m_Stats)
+        , m_Voices(m_SourcePool)
+        , m_Commands(kCommandQueueSize)
+        , m_StoppedSources(kSourcePoolSize * 2)
+        , m_StoppedSourcesOverflow(false)
+        , m_alEventControlSOFT(nullptr)
+        , m_alEventCallbackSOFT(nullptr)
+        , m_alBufferDataStatic(nullptr)
+        , m_HasLoopPoints(false)
+        , m_alDeferUpdatesSOFT(nullptr)
+        , m_alProcessUpdatesSOFT(nullptr)
+        , m_Options(options)
+        , m_alcRenderSamplesSOFT(nullptr)
+        , m_CurrentMusicPathKey(0)
+        , m_CurrentMusicSource(0)
+        , m_StreamMusic(true)
+        , m_AudioThreadExit(false)
+        , m_TickInterval(kDefaultTickInterval)
+        , m_Assets(&m_Stats)
+        , m_DecodePool([this](const char* filepath, EAudioFormat format, EAudioCategory category,
+            const std::shared_ptr<ProgressiveAudio>& progressive, DecodedAudio& out)
+            {
+                return progressive ? m_Assets.DecodeProgressive(filepath, format, progressive, out) : m_Assets.Decode(filepath, format, category, out);
+            })
         , m_Initialized(false)
         , m_MusicVolume(1.0f)
-        , m_CurrentMusicSource(0)
         , m_MusicPaused(false)
         , m_MusicFading(false)
+        , m_MusicPlayingStatus(false)
+        , m_MusicPausedStatus(false)
+        , m_MusicFadingStatus(false)
+        , m_MusicVolumeStatus(100)
+        , m_MusicActive(false)
+        , m_MusicStopped(false)
+        , m_NextMusicPrepared(false)
+        , m_NextMusicPathKey(0)
         , m_MusicFinishedCallback(nullptr)
         , m_FadeStartVolume(0.0f)
         , m_FadeTargetVolume(0.0f)
         , m_FadeTimeRemaining(0.0f)
         , m_FadeDuration(0.0f)
-		, m_CurrentMusicPathKey(0)
     {
+        m_BufferCache.SetBudget(kDefaultAudioMemoryBudget);
     }
 
     OpenALAudio::~OpenALAudio()
     {
-        // Delete all sources and buffers
-        for (auto& pair : m_AudioBuffers)
+        // Stop the audio thread before tearing down the state it works on
+        if (m_AudioThread.joinable())
         {
-            for (ALuint source : pair.second.sources)
             {
-                alDeleteSources(1, &source);
+                std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+                m_AudioThreadExit = true;
             }
-            alDeleteBuffers(1, &pair.second.buffer);
+            m_AudioWakeup.notify_one();
+            m_AudioThread.join();
+        }
+
+        // Nobody is left to upload outstanding background loads
+        m_DecodePool.Shutdown();
+        for (auto& pair : m_PendingLoads)
+        {
+            pair.second.promise.set_value(false);
         }
+        m_PendingLoads.clear();
+
+        m_MusicStream.reset();
+        CancelCrossfade();
+
+        // No more reports once the sources are gone
+        DisableSourceEvents();
+
+        // Delete all sources, then drop every buffer handle and delete the buffers they were playing
+        for (size_t i = 0; i < m_ProgressiveVoices.size(); ++i)
+        {
+            m_Voices.ReleaseExternal();
+        }
+        m_ProgressiveVoices.clear();
+        m_Voices.Clear();
+        m_SourcePool.Shutdown();
+        m_CurrentMusicBuffer.reset();
+        m_AudioBuffers.clear();
+        ReclaimBuffers();
 
         if (m_Context)
         {
@@ -56,13 +130,22 @@ namespace Engine
 
     bool OpenALAudio::Init()
     {
-        m_Device = alcOpenDevice(nullptr);
+        const bool loopback = m_Options.backend == EAudioBackend::kLoopback;
+        m_Device = loopback ? OpenLoopbackDevice() : alcOpenDevice(nullptr);
         if (!m_Device)
         {
             return false;
         }
 
-        m_Context = alcCreateContext(m_Device, nullptr);
+        // A loopback device has no format of its own, the context sets the one RenderAudio produces
+        const ALCint loopbackAttributes[] =
+        {
+            ALC_FORMAT_CHANNELS_SOFT, m_Options.channels == 1 ? ALC_MONO_SOFT : ALC_STEREO_SOFT,
+            ALC_FORMAT_TYPE_SOFT, ALC_FLOAT_SOFT,
+            ALC_FREQUENCY, static_cast<ALCint>(m_Options.sampleRate),
+            0
+        };
+        m_Context = alcCreateContext(m_Device, loopback ? loopbackAttributes : nullptr);
         if (!m_Context)
         {
             alcCloseDevice(m_Device);
@@ -76,179 +159,968 @@ namespace Engine
             return false;
         }
 
+        // Every sound effect and buffered music voice is leased from this pool
+        m_SourcePool.Init(kSourcePoolSize);
+        SetMaxRealVoices(static_cast<int>(kSourcePoolSize));
+        if (!EnableSourceEvents())
+        {
+            printf("Warning: AL_SOFT_events is not supported, polling for finished sounds\n");
+        }
+
+        // Lets buffers play mapped WAV data in place instead of copying it
+        if (alIsExtensionPresent("AL_EXT_STATIC_BUFFER"))
+        {
+            m_alBufferDataStatic = reinterpret_cast<PFNALBUFFERDATASTATICPROC>(alGetProcAddress("alBufferDataStatic"));
+        }
+
+        m_HasLoopPoints = alIsExtensionPresent("AL_SOFT_loop_points") == AL_TRUE;
+
+        // Lets a whole tick of source changes reach the mixer as one update
+        if (alIsExtensionPresent("AL_SOFT_deferred_updates"))
+        {
+            m_alDeferUpdatesSOFT = reinterpret_cast<LPALDEFERUPDATESSOFT>(alGetProcAddress("alDeferUpdatesSOFT"));
+            m_alProcessUpdatesSOFT = reinterpret_cast<LPALPROCESSUPDATESSOFT>(alGetProcAddress("alProcessUpdatesSOFT"));
+            if (!m_alDeferUpdatesSOFT || !m_alProcessUpdatesSOFT)
+            {
+                m_alDeferUpdatesSOFT = nullptr;
+                m_alProcessUpdatesSOFT = nullptr;
+            }
+        }
+        m_LastUpdateTime = std::chrono::steady_clock::now();
+
         m_Initialized = true;
+        if (!loopback)
+        {
+            // The loopback backend is serviced by RenderAudio instead
+            m_AudioThread = std::thread(&OpenALAudio::AudioThreadMain, this);
+        }
+        m_DecodePool.Start();
         return true;
     }
 
-    void OpenALAudio::CleanupBuffer(const std::string& filepath)
+    ALCdevice* OpenALAudio::OpenLoopbackDevice()
     {
-        uint32_t audioKey = GenerateAudioKey(filepath.c_str());
-        auto it = m_AudioBuffers.find(audioKey);
-        if (it != m_AudioBuffers.end())
+        if (alcIsExtensionPresent(nullptr, "ALC_SOFT_loopback") != ALC_TRUE)
+        {
+            printf("Error: ALC_SOFT_loopback is not supported, the loopback backend can't be used\n");
+            return nullptr;
+        }
+
+        auto alcLoopbackOpenDevice = reinterpret_cast<LPALCLOOPBACKOPENDEVICESOFT>(
+            alcGetProcAddress(nullptr, "alcLoopbackOpenDeviceSOFT"));
+        auto alcIsRenderFormatSupported = reinterpret_cast<LPALCISRENDERFORMATSUPPORTEDSOFT>(
+            alcGetProcAddress(nullptr, "alcIsRenderFormatSupportedSOFT"));
+        m_alcRenderSamplesSOFT = reinterpret_cast<LPALCRENDERSAMPLESSOFT>(alcGetProcAddress(nullptr, "alcRenderSamplesSOFT"));
+        if (!alcLoopbackOpenDevice || !alcIsRenderFormatSupported || !m_alcRenderSamplesSOFT)
+        {
+            m_alcRenderSamplesSOFT = nullptr;
+            return nullptr;
+        }
+
+        if (m_Options.channels != 1 && m_Options.channels != 2)
+        {
+            printf("Error: The loopback backend renders mono or stereo, not %u channels\n", m_Options.channels);
+            return nullptr;
+        }
+
+        ALCdevice* device = alcLoopbackOpenDevice(nullptr);
+        if (!device)
+        {
+            return nullptr;
+        }
+
+        ALCenum channels = m_Options.channels == 1 ? ALC_MONO_SOFT : ALC_STEREO_SOFT;
+        if (!alcIsRenderFormatSupported(device, static_cast<ALCsizei>(m_Options.sampleRate), channels, ALC_FLOAT_SOFT))
+        {
+            printf("Error: The loopback device can't render %u Hz float audio\n", m_Options.sampleRate);
+            alcCloseDevice(device);
+            return nullptr;
+        }
+        return device;
+    }
+
+    bool OpenALAudio::EnableSourceEvents()
+    {
+        if (!alIsExtensionPresent("AL_SOFT_events"))
+        {
+            return false;
+        }
+
+        m_alEventControlSOFT = reinterpret_cast<LPALEVENTCONTROLSOFT>(alGetProcAddress("alEventControlSOFT"));
+        m_alEventCallbackSOFT = reinterpret_cast<LPALEVENTCALLBACKSOFT>(alGetProcAddress("alEventCallbackSOFT"));
+        if (!m_alEventControlSOFT || !m_alEventCallbackSOFT)
+        {
+            m_alEventControlSOFT = nullptr;
+            m_alEventCallbackSOFT = nullptr;
+            return false;
+        }
+
+        const ALenum types[] = { AL_EVENT_TYPE_SOURCE_STATE_CHANGED_SOFT };
+        m_alEventCallbackSOFT(&OpenALAudio::OnSourceEvent, this);
+        m_alEventControlSOFT(1, types, AL_TRUE);
+        return true;
+    }
+
+    void OpenALAudio::DisableSourceEvents()
+    {
+        if (!m_alEventControlSOFT) return;
+
+        const ALenum types[] = { AL_EVENT_TYPE_SOURCE_STATE_CHANGED_SOFT };
+        m_alEventControlSOFT(1, types, AL_FALSE);
+        m_alEventCallbackSOFT(nullptr, nullptr);
+        m_alEventControlSOFT = nullptr;
+        m_alEventCallbackSOFT = nullptr;
+    }
+
+    void AL_APIENTRY OpenALAudio::OnSourceEvent(ALenum eventType, ALuint object, ALuint param,
+        ALsizei /*length*/, const ALchar* /*message*/, void* userParam) noexcept
+    {
+        if (eventType != AL_EVENT_TYPE_SOURCE_STATE_CHANGED_SOFT || param != AL_STOPPED) return;
+
+        OpenALAudio* audio = static_cast<OpenALAudio*>(userParam);
+        if (!audio->m_StoppedSources.TryPush(object))
         {
-            // Stop and delete all sources using this buffer
-            for (ALuint source : it->second.sources)
+            audio->m_StoppedSourcesOverflow.store(true, std::memory_order_release);
+        }
+    }
+
+    void OpenALAudio::AudioThreadMain()
+    {
+        std::unique_lock<std::recursive_mutex> lock(m_AudioMutex);
+        auto nextTick = std::chrono::steady_clock::now();
+        while (!m_AudioThreadExit)
+        {
+            auto now = std::chrono::steady_clock::now();
+            float deltaSeconds = std::chrono::duration<float>(now - m_LastUpdateTime).count();
+            m_LastUpdateTime = now;
+
+            // Run the callback unlocked so it can call back into the audio system or take game locks
+            void(*musicFinished)() = ServiceAudio(deltaSeconds) ? m_MusicFinishedCallback : nullptr;
+            if (musicFinished)
             {
-                alSourceStop(source);
-                alDeleteSources(1, &source);
+                lock.unlock();
+                musicFinished();
+                lock.lock();
             }
 
-            // Delete the buffer
-            alDeleteBuffers(1, &it->second.buffer);
-            m_AudioBuffers.erase(it);
-            m_AudioKeyToPath.erase(audioKey);
+            // Ticks are scheduled from the previous deadline so they don't drift,
+            // after a stall the schedule restarts from now instead of catching up in a burst
+            nextTick += m_TickInterval;
+            now = std::chrono::steady_clock::now();
+            if (nextTick < now)
+            {
+                nextTick = now;
+            }
+            m_AudioWakeup.wait_until(lock, nextTick, [this] { return m_AudioThreadExit; });
+        }
+    }
+
+    bool OpenALAudio::ServiceAudio(float deltaSeconds)
+    {
+        // Hold every change made this tick and hand it to the mixer at once, so pausing
+        // a hundred sounds or rebalancing voices is a single update instead of one per call
+        if (m_alDeferUpdatesSOFT)
+        {
+            m_alDeferUpdatesSOFT();
+        }
+
+        ProcessCommands();
+        ProcessCompletedLoads();
+        CleanupFinishedSources();
+        m_Voices.Update(deltaSeconds);
+        UpdateProgressiveVoices();
+        UpdateFading(deltaSeconds);
+        UpdateCrossfade(deltaSeconds);
+        bool musicFinished = UpdateMusicState();
+        EnforceMemoryBudget();
+
+        if (m_alProcessUpdatesSOFT)
+        {
+            m_alProcessUpdatesSOFT();
+        }
+
+        // Sources have let go of their buffers by now
+        ReclaimBuffers();
+        PublishMusicStatus();
+        UpdateStats();
+        return musicFinished;
+    }
+
+    bool OpenALAudio::UpdateMusicState()
+    {
+        // Keep the stream's buffer ring topped up whether or not anyone waits for the end
+        bool streamPlaying = m_MusicStream && m_MusicStream->Update();
+        if (m_MusicStream)
+        {
+            UpdateMusicQueue();
+        }
+        if (!m_MusicActive) return false;
+
+        // A track still loading hasn't started yet, let alone finished
+        if (m_PendingMusic.audioKey != 0) return false;
+
+        bool playing = streamPlaying;
+        if (!m_MusicStream && m_CurrentMusicSource)
+        {
+            ALint state;
+            alGetSourcei(m_CurrentMusicSource, AL_SOURCE_STATE, &state);
+            playing = state != AL_STOPPED;
+        }
+
+        if (playing) return false;
+
+        // A track that ends by itself moves on to the queue, a stopped one doesn't
+        if (!m_MusicStopped && PlayQueuedMusic()) return false;
+
+        m_MusicActive = false;
+        return true;
+    }
+
+    void OpenALAudio::PublishMusicStatus()
+    {
+        ALint state = AL_INITIAL;
+        if (m_CurrentMusicSource)
+        {
+            alGetSourcei(m_CurrentMusicSource, AL_SOURCE_STATE, &state);
+        }
+        const float gain = m_CurrentMusicSource ? m_SourcePool.GetGain(m_CurrentMusicSource) : m_MusicVolume;
+
+        // A track still loading counts as playing, it starts as soon as it lands
+        const bool pending = m_PendingMusic.audioKey != 0;
+        const bool pendingPlaying = pending && !m_PendingMusic.held && !m_MusicPaused && !m_MusicStopped;
+        m_MusicPlayingStatus.store(state == AL_PLAYING || pendingPlaying, std::memory_order_relaxed);
+        m_MusicPausedStatus.store(state == AL_PAUSED || (pending && m_MusicPaused), std::memory_order_relaxed);
+        m_MusicFadingStatus.store(m_MusicFading || m_Crossfade.active || m_Crossfade.incoming, std::memory_order_relaxed);
+        m_MusicVolumeStatus.store(static_cast<int>(gain * 100.0f), std::memory_order_relaxed);
+    }
 
-            // Clear current music if this was the current music
-            if (audioKey == m_CurrentMusicPathKey)
+    void OpenALAudio::UpdateStats()
+    {
+        const uint32_t musicTracks = (m_CurrentMusicSource ? 1 : 0) + (m_Crossfade.outgoingSource ? 1 : 0);
+        m_Stats.SetVoiceCounts(m_Voices.GetRealVoiceCount(), m_Voices.GetVirtualVoiceCount(), m_Voices.GetPausedVoiceCount(),
+            static_cast<uint32_t>(m_ProgressiveVoices.size()), musicTracks);
+        m_Stats.SetBufferCache(m_BufferCache.GetStats());
+
+        // Counts an error left by a call nothing checked
+        m_Stats.TakeALError();
+
+        m_Stats.RecordTick();
+        m_Stats.UpdateDump();
+    }
+
+    void OpenALAudio::UpdateMusicQueue()
+    {
+        // The stream has played into the queued track, it is the current music now
+        if (m_MusicStream->TakeTrackChange())
+        {
+            m_CurrentMusicPathKey = m_NextMusicPathKey;
+            if (m_NextMusicPrepared)
             {
-                m_CurrentMusicPathKey = 0;
-                m_CurrentMusicSource = 0;
+                m_MusicQueue.pop_front();
+                m_NextMusicPrepared = false;
             }
         }
+
+        // Hand the stream the next track, already opened by QueueMusic, so the change costs nothing.
+        // Tracks queued without streaming are opened when they start
+        if (!m_NextMusicPrepared && !m_MusicQueue.empty() && m_MusicQueue.front().track && !m_MusicStream->IsLooping())
+        {
+            QueuedMusic& next = m_MusicQueue.front();
+            m_MusicStream->QueueNext(std::move(next.track));
+            m_NextMusicPathKey = GenerateAudioKey(next.filepath.c_str());
+            m_NextMusicPrepared = true;
+        }
     }
 
-    ALuint OpenALAudio::CreateSource()
+    bool OpenALAudio::PlayQueuedMusic()
     {
-        ALuint source;
-        alGenSources(1, &source);
+        while (!m_MusicQueue.empty())
+        {
+            // Gets a track handed to the current stream back to the front of the queue first
+            StopCurrentMusic();
 
-        // Set default source properties
-        alSource3f(source, AL_POSITION, 0.0f, 0.0f, 0.0f);
-        alSource3f(source, AL_VELOCITY, 0.0f, 0.0f, 0.0f);
-        alSource3f(source, AL_DIRECTION, 0.0f, 0.0f, 0.0f);
-        alSourcef(source, AL_PITCH, 1.0f);
-        alSourcef(source, AL_GAIN, 1.0f);
-        alSourcei(source, AL_LOOPING, AL_FALSE);
+            QueuedMusic next = std::move(m_MusicQueue.front());
+            m_MusicQueue.pop_front();
+            if (next.buffer)
+            {
+                if (StartMusicBuffer(next.buffer, GenerateAudioKey(next.filepath.c_str()))) return true;
+                continue;
+            }
+            if (!next.track)
+            {
+                // Its load is still in flight, PlayMusic picks it up as the pending track
+                if (PlayMusic(next.filepath.c_str())) return true;
+                continue;
+            }
 
-        return source;
+            auto stream = std::make_unique<MusicStream>(m_Stats);
+            if (stream->Open(std::move(next.track)) &&
+                StartMusicStream(std::move(stream), GenerateAudioKey(next.filepath.c_str())))
+            {
+                return true;
+            }
+        }
+        return false;
     }
 
-    bool OpenALAudio::PlayMusic(const char* filepath)
+    bool OpenALAudio::StartMusicStream(std::unique_ptr<MusicStream> stream, uint32_t audioKey)
     {
+        m_SourcePool.SetGain(stream->GetSource(), m_MusicVolume);
+        if (!stream->Play())
+        {
+            return false;
+        }
+
+        m_CurrentMusicSource = stream->GetSource();
+        m_CurrentMusicPathKey = audioKey;
+        m_MusicStream = std::move(stream);
+        m_MusicPaused = false;
+        m_MusicFading = false;
+        m_MusicActive = true;
+        m_MusicStopped = false;
+        return true;
+    }
+
+    void OpenALAudio::ReclaimNextMusic(MusicStream& stream)
+    {
+        if (m_NextMusicPrepared && !m_MusicQueue.empty())
+        {
+            m_MusicQueue.front().track = stream.TakeNext();
+        }
+        stream.ClearNext();
+        m_NextMusicPrepared = false;
+    }
+
+    bool OpenALAudio::QueueMusic(const char* filepath)
+    {
+        // Open the track and decode its first block before taking the lock, the tick never waits on the file
+        QueuedMusic queued;
+        queued.filepath = filepath;
+        if (m_StreamMusic)
+        {
+            EncodedAudio file;
+            if (!m_Assets.Open(filepath, EAudioCategory::kMusic, file) ||
+                !(queued.track = MusicStream::PrepareTrack(file, GetMusicType(filepath), filepath)))
+            {
+                return false;
+            }
+        }
+
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        MusicStatusScope publish{ *this };
         if (!m_Initialized) return false;
 
-        uint32_t audioKey = GenerateAudioKey(filepath);
+        // Decode the whole track on a worker now, it is handed over ready when the current one ends
+        if (!queued.track)
+        {
+            uint32_t audioKey = GenerateAudioKey(filepath);
+            auto it = m_AudioBuffers.find(audioKey);
+            if (it != m_AudioBuffers.end())
+            {
+                queued.buffer = it->second;
+            }
+            else
+            {
+                SubmitLoad(filepath, audioKey, EAudioCategory::kMusic);
+            }
+        }
+
+        m_MusicQueue.push_back(std::move(queued));
+
+        // Nothing to follow, start right away
+        if (!m_MusicActive)
+        {
+            return PlayQueuedMusic();
+        }
+        return true;
+    }
+
+    void OpenALAudio::ClearMusicQueue()
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        m_MusicQueue.clear();
+
+        if (m_MusicStream && m_NextMusicPrepared)
+        {
+            m_MusicStream->ClearNext();
+        }
+        m_NextMusicPrepared = false;
+    }
+
+    void OpenALAudio::CleanupBuffer(const std::string& filepath)
+    {
+        uint32_t audioKey = FindAudioKey(filepath);
+        if (audioKey != 0)
+        {
+            ReleaseBuffer(audioKey);
+            m_AudioKeys.Erase(audioKey);
+        }
+    }
+
+    void OpenALAudio::ReleaseBuffer(uint32_t audioKey)
+    {
+        auto it = m_AudioBuffers.find(audioKey);
+        if (it == m_AudioBuffers.end()) return;
+
+        // Voices and music still playing it hold their own handles and finish normally
+        m_AudioBuffers.erase(it);
+        m_BufferCache.Remove(audioKey);
+    }
+
+    ALuint OpenALAudio::CreateSource()
+    {
+        // Lease a source with default properties, 0 when every voice is busy
+        return m_SourcePool.Acquire();
+    }
+
+    void OpenALAudio::StopCurrentMusic()
+    {
+        // Replacing or freeing the track isn't the music finishing
+        m_MusicActive = false;
+
+        // A next track handed to the stream goes back to the front of the queue
+        if (m_MusicStream)
+        {
+            ReclaimNextMusic(*m_MusicStream);
+        }
+        m_NextMusicPrepared = false;
+
+        // Nothing of a crossfade survives a hard stop
+        CancelCrossfade();
+
+        if (m_MusicStream)
+        {
+            // The stream owns its source
+            m_MusicStream.reset();
+            m_CurrentMusicSource = 0;
+        }
 
-        // Stop current music if playing
         if (m_CurrentMusicSource)
         {
-            alSourceStop(m_CurrentMusicSource);
-            alDeleteSources(1, &m_CurrentMusicSource);
+            m_SourcePool.Release(m_CurrentMusicSource);
             m_CurrentMusicSource = 0;
         }
 
-        // Load or get existing buffer
-        auto it = m_AudioBuffers.find(audioKey);
-        if (it == m_AudioBuffers.end())
+        // The buffer is deleted at the end of the tick if it was freed while playing.
+        // A track still loading is cached when it lands but not started
+        m_CurrentMusicBuffer.reset();
+        m_PendingMusic = PendingMusic();
+
+        m_CurrentMusicPathKey = 0;
+    }
+
+    bool OpenALAudio::PlayMusic(const char* filepath)
+    {
+        // Open the track and decode its first block before taking the lock, the tick never waits on the file.
+        // The audio thread decodes the rest while it plays
+        std::unique_ptr<MusicStream::Track> track;
+        if (m_StreamMusic)
         {
-            AudioBuffer newBuffer;
-            alGenBuffers(1, &newBuffer.buffer);
+            EncodedAudio file;
+            if (!m_Assets.Open(filepath, EAudioCategory::kMusic, file) ||
+                !(track = MusicStream::PrepareTrack(file, GetMusicType(filepath), filepath)))
+            {
+                return false;
+            }
+        }
+
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        MusicStatusScope publish{ *this };
+        if (!m_Initialized) return false;
 
-            if (!LoadWAVFile(filepath, newBuffer.buffer))
+        uint32_t audioKey = GenerateAudioKey(filepath);
+
+        // Stop current music if playing
+        StopCurrentMusic();
+
+        if (track)
+        {
+            auto stream = std::make_unique<MusicStream>(m_Stats);
+            if (!stream->Open(std::move(track)))
             {
-                alDeleteBuffers(1, &newBuffer.buffer);
                 return false;
             }
+            return StartMusicStream(std::move(stream), audioKey);
+        }
 
-            it = m_AudioBuffers.insert({ audioKey, newBuffer }).first;
+        if (AudioBufferHandle buffer = FindBufferForPlay(audioKey))
+        {
+            return StartMusicBuffer(buffer, audioKey);
         }
 
-        // Create and setup source
+        // Decoded on a worker so the tick doesn't wait on it, the track starts in the tick its load lands
+        SubmitLoad(filepath, audioKey, EAudioCategory::kMusic);
+        m_PendingMusic.audioKey = audioKey;
+        m_CurrentMusicPathKey = audioKey;
+        m_MusicPaused = false;
+        m_MusicFading = false;
+        m_MusicActive = true;
+        m_MusicStopped = false;
+        return true;
+    }
+
+    bool OpenALAudio::StartMusicBuffer(const AudioBufferHandle& buffer, uint32_t audioKey, bool held)
+    {
         ALuint source = CreateSource();
         if (source == 0) return false;
 
-        alSourcei(source, AL_BUFFER, it->second.buffer);
-        alSourcef(source, AL_GAIN, m_MusicVolume);
+        alSourcei(source, AL_BUFFER, buffer->buffer);
+        m_SourcePool.SetGain(source, m_MusicVolume);
 
         m_CurrentMusicSource = source;
         m_CurrentMusicPathKey = audioKey;
-        it->second.sources.push_back(source);
+        m_CurrentMusicBuffer = buffer;
 
-        alSourcePlay(source);
+        if (!held)
+        {
+            alSourcePlay(source);
+        }
         m_MusicPaused = false;
         m_MusicFading = false;
-
+        m_MusicActive = true;
+        m_MusicStopped = false;
         return true;
     }
 
+    void OpenALAudio::StartPendingMusic(const AudioBufferHandle& buffer)
+    {
+        const PendingMusic pending = m_PendingMusic;
+        m_PendingMusic = PendingMusic();
+
+        // Restored after StartMusicBuffer, the calls made during the load still apply
+        const bool paused = m_MusicPaused;
+        const bool stopped = m_MusicStopped;
+        const bool fading = m_MusicFading;
+
+        // A failed load ends the track like it played out, the queue moves on in UpdateMusicState
+        if (!buffer || !StartMusicBuffer(buffer, pending.audioKey, true)) return;
+
+        m_MusicFading = fading;
+        m_SourcePool.SetGain(m_CurrentMusicSource, pending.muted ? 0.0f : (fading ? m_FadeStartVolume : m_MusicVolume));
+        m_SourcePool.SetLooping(m_CurrentMusicSource, pending.looping);
+
+        // Stopping an initial source marks it stopped, pausing one does nothing until it has played
+        if (stopped)
+        {
+            alSourceStop(m_CurrentMusicSource);
+            m_MusicStopped = true;
+        }
+        else if (paused)
+        {
+            alSourcePlay(m_CurrentMusicSource);
+            alSourcePause(m_CurrentMusicSource);
+            m_MusicPaused = true;
+        }
+        else if (!pending.held)
+        {
+            alSourcePlay(m_CurrentMusicSource);
+        }
+    }
+
+    bool OpenALAudio::PlayMusic(SoundId music)
+    {
+        // Music start is rare and the stream needs the path anyway
+        return PlayMusic(std::string(music.GetPath()).c_str());
+    }
+
     bool OpenALAudio::PlaySoundEffect(const char* filepath)
     {
         if (!m_Initialized) return false;
 
-        uint32_t audioKey = GenerateAudioKey(filepath);
-        
-        // Load or get existing buffer
-        auto it = m_AudioBuffers.find(audioKey);
-        if (it == m_AudioBuffers.end())
+        return EnqueueSoundCommand(AudioCommand::EType::kPlaySound, filepath, HashAudioPath(filepath), 0);
+    }
+
+    bool OpenALAudio::PlaySoundEffect(SoundId sound)
+    {
+        if (!m_Initialized) return false;
+
+        return EnqueueSoundCommand(AudioCommand::EType::kPlaySound, sound.GetPath(), sound.GetHash(), 0);
+    }
+
+    bool OpenALAudio::PlaySoundEffectWhenReady(const char* filepath)
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        if (!m_Initialized) return false;
+        ProcessCommands();
+
+        return PlayWhenReady(filepath, GenerateAudioKey(filepath));
+    }
+
+    bool OpenALAudio::PlayWhenReady(const char* filepath, uint32_t audioKey)
+    {
+        if (AudioBufferHandle buffer = FindBufferForPlay(audioKey))
         {
-            AudioBuffer newBuffer;
-            alGenBuffers(1, &newBuffer.buffer);
+            return PlayBuffer(audioKey, buffer);
+        }
 
-            if (!LoadWAVFile(filepath, newBuffer.buffer))
+        if (m_ProgressiveSounds.count(audioKey) != 0 && PlayProgressive(filepath, audioKey))
+        {
+            return true;
+        }
+
+        LoadAudioAsync(filepath);
+
+        auto pending = m_PendingLoads.find(audioKey);
+        if (pending == m_PendingLoads.end())
+        {
+            return false;
+        }
+
+        ++pending->second.playRequests;
+        return true;
+    }
+
+    bool OpenALAudio::PlayProgressive(const char* filepath, uint32_t audioKey)
+    {
+        // A plain load already in flight finishes first, the sound plays once it's done
+        auto pending = m_PendingLoads.find(audioKey);
+        if (pending != m_PendingLoads.end() && !pending->second.progressive)
+        {
+            return false;
+        }
+
+        // Progressive voices aren't virtualized but still count against the voice cap. Without a slot,
+        // or a weaker voice to take one from, the sound waits for its full load
+        auto priority = m_SoundPriorities.find(audioKey);
+        if (!m_Voices.ReserveExternal(priority != m_SoundPriorities.end() ? priority->second : 0))
+        {
+            return false;
+        }
+
+        ALuint source = m_SourcePool.Acquire();
+        if (!source)
+        {
+            m_Voices.ReleaseExternal();
+            return false;
+        }
+
+        std::shared_ptr<ProgressiveAudio> audio;
+        if (pending != m_PendingLoads.end())
+        {
+            audio = pending->second.progressive;
+        }
+        else
+        {
+            audio = std::make_shared<ProgressiveAudio>();
+            SubmitLoad(filepath, audioKey, EAudioCategory::kSound, audio);
+        }
+
+        m_ProgressiveVoices.push_back(std::make_unique<ProgressiveVoice>(audioKey, std::move(audio), source, m_SourcePool, m_Stats));
+        return true;
+    }
+
+    void OpenALAudio::UpdateProgressiveVoices()
+    {
+        for (size_t i = 0; i < m_ProgressiveVoices.size();)
+        {
+            if (m_ProgressiveVoices[i]->Update())
             {
-                alDeleteBuffers(1, &newBuffer.buffer);
-                return false;
+                ++i;
+                continue;
             }
 
-            it = m_AudioBuffers.insert({ audioKey, newBuffer }).first;
+            m_ProgressiveVoices[i] = std::move(m_ProgressiveVoices.back());
+            m_ProgressiveVoices.pop_back();
+            m_Voices.ReleaseExternal();
         }
+    }
 
-        // Create and play source
-        ALuint source = CreateSource();
-        if (source == 0) return false;
+    IAudio::AudioLoadHandle OpenALAudio::LoadAudioAsync(const char* filepath)
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        uint32_t audioKey = GenerateAudioKey(filepath);
 
-        alSourcei(source, AL_BUFFER, it->second.buffer);
-        alSourcePlay(source);
-        
-        it->second.sources.push_back(source);
-        CleanupFinishedSources();
-        
+        // Already resident or already decoding
+        auto pending = m_PendingLoads.find(audioKey);
+        if (pending != m_PendingLoads.end())
+        {
+            return pending->second.future;
+        }
+
+        if (!m_Initialized || m_AudioBuffers.find(audioKey) != m_AudioBuffers.end())
+        {
+            std::promise<bool> done;
+            done.set_value(m_Initialized);
+            return done.get_future().share();
+        }
+
+        SubmitLoad(filepath, audioKey, EAudioCategory::kSound);
+        return m_PendingLoads[audioKey].future;
+    }
+
+    void OpenALAudio::SubmitLoad(const char* filepath, uint32_t audioKey, EAudioCategory category,
+        std::shared_ptr<ProgressiveAudio> progressive)
+    {
+        // A load already in flight serves this request too
+        if (m_PendingLoads.count(audioKey) != 0) return;
+
+        PendingLoad& load = m_PendingLoads[audioKey];
+        load.future = load.promise.get_future().share();
+        load.progressive = progressive;
+        load.category = category;
+        m_DecodePool.Submit(audioKey, filepath, GetMusicType(filepath), category, std::move(progressive));
+    }
+
+    void OpenALAudio::Update()
+    {
+        // Nothing to do, the audio thread services loads, voices, fades and music on its own tick
+    }
+
+    bool OpenALAudio::RenderAudio(float* out, uint32_t frameCount)
+    {
+        std::unique_lock<std::recursive_mutex> lock(m_AudioMutex);
+        if (!m_Initialized || !m_alcRenderSamplesSOFT) return false;
+
+        // Mix in tick-sized steps, servicing before each one, so fades, stream refills and voices
+        // advance with rendered time however fast it is rendered
+        const uint32_t tickFrames = std::max<uint32_t>(
+            static_cast<uint32_t>(m_Options.sampleRate * m_TickInterval.count() / 1000000), 1);
+        while (frameCount > 0)
+        {
+            const uint32_t frames = std::min(frameCount, tickFrames);
+
+            void(*musicFinished)() = ServiceAudio(static_cast<float>(frames) / m_Options.sampleRate) ? m_MusicFinishedCallback : nullptr;
+            if (musicFinished)
+            {
+                lock.unlock();
+                musicFinished();
+                lock.lock();
+            }
+
+            m_alcRenderSamplesSOFT(m_Device, out, static_cast<ALCsizei>(frames));
+            out += static_cast<size_t>(frames) * m_Options.channels;
+            frameCount -= frames;
+        }
         return true;
     }
 
+    void OpenALAudio::SetAudioTickInterval(int ms)
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        m_TickInterval = std::chrono::milliseconds(std::max(ms, 1));
+    }
+
+    void OpenALAudio::SetAudioMemoryBudget(uint64_t bytes)
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        m_BufferCache.SetBudget(bytes);
+    }
+
+    void OpenALAudio::SetAudioMemoryBudget(EAudioCategory category, uint64_t bytes)
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        m_BufferCache.SetBudget(category, bytes);
+    }
+
+    bool OpenALAudio::MountSoundBank(const char* filepath)
+    {
+        return m_Assets.MountSoundBank(filepath);
+    }
+
+    bool OpenALAudio::LoadCompressedAudio(const char* filepath)
+    {
+        return m_Assets.LoadCompressedAudio(filepath);
+    }
+
+    void OpenALAudio::FreeCompressedAudio(const char* filepath)
+    {
+        m_Assets.FreeCompressedAudio(filepath);
+    }
+
+    bool OpenALAudio::EnableDecodedAudioCache(const char* directory, uint64_t maxBytes)
+    {
+        return m_Assets.EnableDecodedAudioCache(directory, maxBytes);
+    }
+
+    bool OpenALAudio::PlayBuffer(uint32_t audioKey, const AudioBufferHandle& audioBuffer)
+    {
+        auto priority = m_SoundPriorities.find(audioKey);
+        return m_Voices.Play(audioKey, audioBuffer, priority != m_SoundPriorities.end() ? priority->second : 0);
+    }
+
+    void OpenALAudio::SetSoundPriority(const char* filepath, int priority)
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        ProcessCommands();
+        m_SoundPriorities[GenerateAudioKey(filepath)] = priority;
+    }
+
+    void OpenALAudio::SetSoundProgressive(const char* filepath, bool progressive)
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        ProcessCommands();
+        if (progressive)
+        {
+            m_ProgressiveSounds.insert(GenerateAudioKey(filepath));
+        }
+        else
+        {
+            m_ProgressiveSounds.erase(GenerateAudioKey(filepath));
+        }
+    }
+
+    void OpenALAudio::SetMaxRealVoices(int count)
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        ProcessCommands();
+
+        // Keep one source back for buffered music
+        uint32_t available = m_SourcePool.GetStats().capacity > 0 ? m_SourcePool.GetStats().capacity - 1 : 0;
+        m_Voices.SetMaxRealVoices(std::min(static_cast<uint32_t>(std::max(count, 0)), available));
+    }
+
     void OpenALAudio::OperateCurrentMusic(EAudioAction action)
     {
-        if (!m_CurrentMusicSource) return;
+        // Applied right away like the other music calls, so it stays in order with them
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        if (!m_Initialized) return;
+        MusicStatusScope publish{ *this };
+
+        ApplyMusicAction(action);
+    }
+
+    void OpenALAudio::ApplyMusicAction(EAudioAction action)
+    {
+        if (!m_CurrentMusicSource)
+        {
+            ApplyPendingMusicAction(action);
+            return;
+        }
+
+        // A track fading out under a crossfade has nothing to come back to, stopping or pausing ends it
+        if (action == EAudioAction::kStop || action == EAudioAction::kPause)
+        {
+            ReleaseOutgoingMusic();
+        }
+
+        // Transport and looping on a streamed track go through the stream, which owns the buffer queue
+        if (m_MusicStream)
+        {
+            switch (action)
+            {
+            case EAudioAction::kStop:
+                m_MusicStream->Stop();
+                m_MusicStopped = true;
+                return;
+            case EAudioAction::kRewind:
+                m_MusicStream->Stop();
+                return;
+            case EAudioAction::kPause:
+                m_MusicStream->Pause();
+                m_MusicPaused = true;
+                return;
+            case EAudioAction::kResume:
+                m_MusicStream->Play();
+                m_MusicPaused = false;
+                m_MusicActive = true;
+                m_MusicStopped = false;
+                return;
+            case EAudioAction::kReplay:
+                m_MusicStream->Replay();
+                m_MusicPaused = false;
+                m_MusicActive = true;
+                m_MusicStopped = false;
+                return;
+            case EAudioAction::kLoop:
+                m_MusicStream->SetLooping(true);
+                return;
+            case EAudioAction::kStopLoop:
+                m_MusicStream->SetLooping(false);
+                return;
+            default:
+                break;
+            }
+        }
 
         switch (action)
         {
         case EAudioAction::kStop:
             alSourceStop(m_CurrentMusicSource);
+            m_MusicStopped = true;
             break;
         case EAudioAction::kPause:
             alSourcePause(m_CurrentMusicSource);
             m_MusicPaused = true;
             break;
         case EAudioAction::kResume:
-            alSourcePlay(m_CurrentMusicSource);
-            m_MusicPaused = false;
-            break;
+            alSourcePlay(m_CurrentMusicSource);
+            m_MusicPaused = false;
+            m_MusicActive = true;
+            m_MusicStopped = false;
+            break;
+        case EAudioAction::kReplay:
+            alSourceRewind(m_CurrentMusicSource);
+            alSourcePlay(m_CurrentMusicSource);
+            m_MusicActive = true;
+            m_MusicStopped = false;
+            break;
+        case EAudioAction::kLoop:
+            m_SourcePool.SetLooping(m_CurrentMusicSource, true);
+            break;
+        case EAudioAction::kStopLoop:
+            m_SourcePool.SetLooping(m_CurrentMusicSource, false);
+            break;
+        case EAudioAction::kMute:
+            m_SourcePool.SetGain(m_CurrentMusicSource, 0.0f);
+            break;
+        case EAudioAction::kUnmute:
+            m_SourcePool.SetGain(m_CurrentMusicSource, m_MusicVolume);
+            break;
+        case EAudioAction::kVolumeUp:
+            m_MusicVolume = std::min(m_MusicVolume + 0.1f, 1.0f);
+            m_SourcePool.SetGain(m_CurrentMusicSource, m_MusicVolume);
+            break;
+        case EAudioAction::kVolumeDown:
+            m_MusicVolume = std::max(m_MusicVolume - 0.1f, 0.0f);
+            m_SourcePool.SetGain(m_CurrentMusicSource, m_MusicVolume);
+            break;
+        case EAudioAction::kRewind:
+            alSourceRewind(m_CurrentMusicSource);
+            break;
+        default:
+            printf("Invalid audio action\n");
+            break;
+        }
+    }
+
+    void OpenALAudio::ApplyPendingMusicAction(EAudioAction action)
+    {
+        if (m_PendingMusic.audioKey == 0) return;
+
+        // Same outcome as on a source that had just started, once the load lands
+        switch (action)
+        {
+        case EAudioAction::kStop:
+            m_MusicStopped = true;
+            break;
+        case EAudioAction::kPause:
+            m_MusicPaused = true;
+            break;
+        case EAudioAction::kResume:
         case EAudioAction::kReplay:
-            alSourceRewind(m_CurrentMusicSource);
-            alSourcePlay(m_CurrentMusicSource);
+            m_PendingMusic.held = false;
+            m_MusicPaused = false;
+            m_MusicActive = true;
+            m_MusicStopped = false;
             break;
         case EAudioAction::kLoop:
-            alSourcei(m_CurrentMusicSource, AL_LOOPING, AL_TRUE);
-            break;
         case EAudioAction::kStopLoop:
-            alSourcei(m_CurrentMusicSource, AL_LOOPING, AL_FALSE);
+            m_PendingMusic.looping = action == EAudioAction::kLoop;
             break;
         case EAudioAction::kMute:
-            alSourcef(m_CurrentMusicSource, AL_GAIN, 0.0f);
-            break;
         case EAudioAction::kUnmute:
-            alSourcef(m_CurrentMusicSource, AL_GAIN, m_MusicVolume);
+            m_PendingMusic.muted = action == EAudioAction::kMute;
             break;
         case EAudioAction::kVolumeUp:
             m_MusicVolume = std::min(m_MusicVolume + 0.1f, 1.0f);
-            alSourcef(m_CurrentMusicSource, AL_GAIN, m_MusicVolume);
+            m_PendingMusic.muted = false;
             break;
         case EAudioAction::kVolumeDown:
             m_MusicVolume = std::max(m_MusicVolume - 0.1f, 0.0f);
-            alSourcef(m_CurrentMusicSource, AL_GAIN, m_MusicVolume);
+            m_PendingMusic.muted = false;
             break;
         case EAudioAction::kRewind:
-            alSourceRewind(m_CurrentMusicSource);
+            m_PendingMusic.held = true;
             break;
         default:
             printf("Invalid audio action\n");
@@ -260,71 +1132,69 @@ namespace Engine
     {
         if (!m_Initialized) return;
 
-        // Clean up finished sources first
-        CleanupFinishedSources();
+        AudioCommand command;
+        command.type = AudioCommand::EType::kOperateSounds;
+        command.action = action;
+        command.hash = 0;
+        command.pathLength = 0;
+        EnqueueCommand(command);
+    }
 
-        // Operate on all sound effect sources
-        for (const auto& pair : m_AudioBuffers)
+    void OpenALAudio::ApplySoundsAction(EAudioAction action)
+    {
+        // Operate on all sound effect voices, real or virtual
+        switch (action)
         {
-            for (ALuint source : pair.second.sources)
-            {
-                if (source != m_CurrentMusicSource)  // Skip music source
-                {
-                    switch (action)
-                    {
-                    case EAudioAction::kStop:
-                        alSourceStop(source);
-                        break;
-                    case EAudioAction::kPause:
-                        alSourcePause(source);
-                        break;
-                    case EAudioAction::kResume:
-                        alSourcePlay(source);
-                        break;
-                    case EAudioAction::kReplay:
-                        alSourceRewind(source);
-                        alSourcePlay(source);
-                        break;
-                    case EAudioAction::kRewind:
-                        alSourceRewind(source);
-                        break;
-                    case EAudioAction::kMute:
-                        alSourcef(source, AL_GAIN, 0.0f);
-                        break;
-                    case EAudioAction::kUnmute:
-                        alSourcef(source, AL_GAIN, 1.0f);  // Or stored original volume
-                        break;
-                    case EAudioAction::kLoop:
-                        alSourcei(source, AL_LOOPING, AL_TRUE);
-                        break;
-                    case EAudioAction::kStopLoop:
-                        alSourcei(source, AL_LOOPING, AL_FALSE);
-                        break;
-                    case EAudioAction::kVolumeUp:
-                        {
-                            float currentVolume;
-                            alGetSourcef(source, AL_GAIN, &currentVolume);
-                            alSourcef(source, AL_GAIN, std::min(currentVolume + 0.1f, 1.0f));
-                        }
-                        break;
-                    case EAudioAction::kVolumeDown:
-                        {
-                            float currentVolume;
-                            alGetSourcef(source, AL_GAIN, &currentVolume);
-                            alSourcef(source, AL_GAIN, std::max(currentVolume - 0.1f, 0.0f));
-                        }
-                        break;
-                    }
-                }
-            }
+        case EAudioAction::kStop:
+            m_Voices.StopAll();
+            break;
+        case EAudioAction::kPause:
+            m_Voices.PauseAll();
+            break;
+        case EAudioAction::kResume:
+            m_Voices.ResumeAll();
+            break;
+        case EAudioAction::kReplay:
+            m_Voices.ReplayAll();
+            break;
+        case EAudioAction::kRewind:
+            m_Voices.RewindAll();
+            break;
+        case EAudioAction::kMute:
+            m_Voices.SetMutedAll(true);
+            break;
+        case EAudioAction::kUnmute:
+            m_Voices.SetMutedAll(false);
+            break;
+        case EAudioAction::kLoop:
+            m_Voices.SetLoopingAll(true);
+            break;
+        case EAudioAction::kStopLoop:
+            m_Voices.SetLoopingAll(false);
+            break;
+        case EAudioAction::kVolumeUp:
+            m_Voices.AdjustGainAll(0.1f);
+            break;
+        case EAudioAction::kVolumeDown:
+            m_Voices.AdjustGainAll(-0.1f);
+            break;
+        }
+
+        // Progressive voices only follow stop, pause and resume, they are short-lived
+        for (const auto& voice : m_ProgressiveVoices)
+        {
+            if (action == EAudioAction::kStop) voice->Stop();
+            else if (action == EAudioAction::kPause) voice->Pause();
+            else if (action == EAudioAction::kResume) voice->Resume();
         }
     }
 
     void OpenALAudio::SetMusicPosition(double position_x, double position_y)
     {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
         if (m_CurrentMusicSource)
         {
-            alSource3f(m_CurrentMusicSource, AL_POSITION,
+            m_SourcePool.SetPosition(m_CurrentMusicSource,
                 static_cast<float>(position_x),
                 static_cast<float>(position_y),
                 0.0f);
@@ -333,6 +1203,8 @@ namespace Engine
 
     void OpenALAudio::FadeInMusic(const char* filepath, int loops, int ms)
     {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        MusicStatusScope publish{ *this };
         if (PlayMusic(filepath))
         {
             m_FadeStartVolume = 0.0f;
@@ -341,15 +1213,24 @@ namespace Engine
             m_FadeDuration = m_FadeTimeRemaining;
             m_MusicFading = true;
 
-            alSourcef(m_CurrentMusicSource, AL_GAIN, 0.0f);
-            alSourcei(m_CurrentMusicSource, AL_LOOPING, loops == -1 ? AL_TRUE : AL_FALSE);
+            // A track still loading starts at the fade's first gain
+            if (m_CurrentMusicSource)
+            {
+                m_SourcePool.SetGain(m_CurrentMusicSource, 0.0f);
+            }
+            ApplyMusicAction(loops == -1 ? EAudioAction::kLoop : EAudioAction::kStopLoop);
         }
     }
 
     void OpenALAudio::FadeOutMusic(int ms)
     {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        MusicStatusScope publish{ *this };
         if (m_CurrentMusicSource)
         {
+            // The fade out takes over the current track's gain, the outgoing one goes now
+            CancelCrossfade();
+
             m_FadeStartVolume = m_MusicVolume;
             m_FadeTargetVolume = 0.0f;
             m_FadeTimeRemaining = static_cast<float>(ms) / 1000.0f;
@@ -358,126 +1239,309 @@ namespace Engine
         }
     }
 
-    void OpenALAudio::UpdateFading()
+    void OpenALAudio::UpdateFading(float deltaSeconds)
     {
         if (!m_MusicFading || !m_CurrentMusicSource) return;
 
-        m_FadeTimeRemaining -= 0.016f; // Assuming 60 FPS
+        m_FadeTimeRemaining -= deltaSeconds;
         if (m_FadeTimeRemaining <= 0.0f)
         {
             m_MusicFading = false;
-            alSourcef(m_CurrentMusicSource, AL_GAIN, m_FadeTargetVolume);
+            m_SourcePool.SetGain(m_CurrentMusicSource, m_FadeTargetVolume);
 
+            // The stopped music is reported to the finished callback by UpdateMusicState
             if (m_FadeTargetVolume == 0.0f)
             {
-                alSourceStop(m_CurrentMusicSource);
-                if (m_MusicFinishedCallback)
-                {
-                    m_MusicFinishedCallback();
-                }
+                ApplyMusicAction(EAudioAction::kStop);
             }
         }
         else
         {
             float t = 1.0f - (m_FadeTimeRemaining / m_FadeDuration);
             float currentVolume = m_FadeStartVolume + (m_FadeTargetVolume - m_FadeStartVolume) * t;
-            alSourcef(m_CurrentMusicSource, AL_GAIN, currentVolume);
+            m_SourcePool.SetGain(m_CurrentMusicSource, currentVolume);
         }
     }
 
-    void OpenALAudio::FreeMusicByKey(uint32_t audioKey)
+    bool OpenALAudio::CrossfadeMusic(const char* filepath, int loops, int ms)
     {
-        auto it = m_AudioBuffers.find(audioKey);
-        if (it != m_AudioBuffers.end())
+        // Open the track and decode its first block before taking the lock, the audio thread decodes
+        // the next blocks before the fade starts
+        EncodedAudio file;
+        std::unique_ptr<MusicStream::Track> track;
+        if (!m_Assets.Open(filepath, EAudioCategory::kMusic, file) ||
+            !(track = MusicStream::PrepareTrack(file, GetMusicType(filepath), filepath)))
+        {
+            return false;
+        }
+
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        MusicStatusScope publish{ *this };
+        if (!m_Initialized) return false;
+
+        auto stream = std::make_unique<MusicStream>(m_Stats);
+        if (!stream->Open(std::move(track)))
+        {
+            return false;
+        }
+
+        stream->SetLooping(loops == -1);
+        m_SourcePool.SetGain(stream->GetSource(), 0.0f);
+
+        // A newer request replaces one that is still prebuffering
+        m_Crossfade.incoming = std::move(stream);
+        m_Crossfade.incomingKey = GenerateAudioKey(filepath);
+        m_Crossfade.duration = static_cast<float>(std::max(ms, 0)) / 1000.0f;
+        return true;
+    }
+
+    void OpenALAudio::UpdateCrossfade(float deltaSeconds)
+    {
+        // One block per tick keeps the prebuffer from ever stalling the tick
+        if (m_Crossfade.incoming && m_Crossfade.incoming->Prebuffer())
+        {
+            BeginCrossfade();
+        }
+
+        if (!m_Crossfade.active) return;
+
+        // The outgoing track still needs refills while it fades, it may also just run out
+        if (m_Crossfade.outgoingSource)
         {
-            // Stop and delete all sources using this buffer
-            for (ALuint source : it->second.sources)
+            bool outgoingPlaying;
+            if (m_Crossfade.outgoingStream)
             {
-                alSourceStop(source);
-                alDeleteSources(1, &source);
+                outgoingPlaying = m_Crossfade.outgoingStream->Update();
+            }
+            else
+            {
+                ALint state;
+                alGetSourcei(m_Crossfade.outgoingSource, AL_SOURCE_STATE, &state);
+                outgoingPlaying = state != AL_STOPPED;
             }
 
-            // Delete the buffer
-            alDeleteBuffers(1, &it->second.buffer);
-            m_AudioBuffers.erase(it);
-            m_AudioKeyToPath.erase(audioKey);
-
-            // Clear current music if this was the current music
-            if (audioKey == m_CurrentMusicPathKey)
+            if (!outgoingPlaying)
             {
-                m_CurrentMusicPathKey = 0;
-                m_CurrentMusicSource = 0;
+                ReleaseOutgoingMusic();
             }
         }
+
+        m_Crossfade.elapsed += deltaSeconds;
+        float t = m_Crossfade.duration > 0.0f ? std::min(m_Crossfade.elapsed / m_Crossfade.duration, 1.0f) : 1.0f;
+
+        // Equal power: sin^2 + cos^2 = 1 keeps the loudness constant through the overlap
+        const float angle = t * 1.57079632679f;
+        m_SourcePool.SetGain(m_CurrentMusicSource, m_MusicVolume * std::sin(angle));
+        if (m_Crossfade.outgoingSource)
+        {
+            m_SourcePool.SetGain(m_Crossfade.outgoingSource, m_Crossfade.outgoingGain * std::cos(angle));
+        }
+
+        if (t >= 1.0f)
+        {
+            ReleaseOutgoingMusic();
+            m_Crossfade.active = false;
+        }
     }
 
-    void OpenALAudio::FreeSoundByKey(uint32_t audioKey)
+    void OpenALAudio::BeginCrossfade()
     {
-        auto it = m_AudioBuffers.find(audioKey);
-        if (it != m_AudioBuffers.end())
+        // A crossfade still running loses its outgoing track, the current one fades from where it is
+        ReleaseOutgoingMusic();
+
+        // The current track keeps its source, stream and buffer while it fades out, but doesn't
+        // continue into the music queue
+        m_Crossfade.outgoingSource = m_CurrentMusicSource;
+        m_Crossfade.outgoingGain = m_CurrentMusicSource ? m_SourcePool.GetGain(m_CurrentMusicSource) : 0.0f;
+        m_Crossfade.outgoingStream = std::move(m_MusicStream);
+        m_Crossfade.outgoingBuffer = std::move(m_CurrentMusicBuffer);
+        if (m_Crossfade.outgoingStream)
         {
-            // Stop and delete all sources using this buffer
-            for (ALuint source : it->second.sources)
-            {
-                alSourceStop(source);
-                alDeleteSources(1, &source);
-            }
+            ReclaimNextMusic(*m_Crossfade.outgoingStream);
+        }
+        m_NextMusicPrepared = false;
+        m_MusicFading = false;
+
+        // A track still loading never starts
+        m_PendingMusic = PendingMusic();
+
+        // The incoming track is the current music from here on
+        m_MusicStream = std::move(m_Crossfade.incoming);
+        m_CurrentMusicSource = m_MusicStream->GetSource();
+        m_CurrentMusicPathKey = m_Crossfade.incomingKey;
+        m_MusicStream->Play();
+        m_MusicPaused = false;
+        m_MusicActive = true;
+        m_MusicStopped = false;
+
+        m_Crossfade.elapsed = 0.0f;
+        m_Crossfade.active = true;
+    }
+
+    void OpenALAudio::ReleaseOutgoingMusic()
+    {
+        // A stream owns its source, buffered music leased one from the pool
+        if (m_Crossfade.outgoingStream)
+        {
+            m_Crossfade.outgoingStream.reset();
+        }
+        else if (m_Crossfade.outgoingSource)
+        {
+            m_SourcePool.Release(m_Crossfade.outgoingSource);
+        }
+
+        m_Crossfade.outgoingSource = 0;
+        m_Crossfade.outgoingBuffer.reset();
+    }
+
+    void OpenALAudio::CancelCrossfade()
+    {
+        ReleaseOutgoingMusic();
+        m_Crossfade.incoming.reset();
+        m_Crossfade.active = false;
+    }
+
+    void OpenALAudio::FreeMusicByKey(uint32_t audioKey)
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        MusicStatusScope publish{ *this };
 
-            // Delete the buffer
-            alDeleteBuffers(1, &it->second.buffer);
-            m_AudioBuffers.erase(it);
-            m_AudioKeyToPath.erase(audioKey);
+        // A streamed track has no cached buffer, stopping it releases everything
+        if (audioKey == m_CurrentMusicPathKey && m_MusicStream)
+        {
+            StopCurrentMusic();
+            m_AudioKeys.Erase(audioKey);
+            return;
         }
+
+        // Music still playing the buffer keeps it until it is stopped or replaced
+        ReleaseBuffer(audioKey);
+        m_AudioKeys.Erase(audioKey);
+    }
+
+    void OpenALAudio::FreeSoundByKey(uint32_t audioKey)
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        ProcessCommands();
+
+        // Voices already playing the sound finish, the buffer goes once the last of them ends
+        ReleaseBuffer(audioKey);
+        m_AudioKeys.Erase(audioKey);
     }
 
     void OpenALAudio::SetMusicVolume(int volume)
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        if (!m_Initialized) return;
+        MusicStatusScope publish{ *this };
+
+        ApplyMusicVolume(volume);
+    }
+
+    void OpenALAudio::ApplyMusicVolume(int volume)
     {
         // Convert from 0-100 range to 0.0-1.0 range
         m_MusicVolume = std::max(0.0f, std::min(static_cast<float>(volume) / 100.0f, 1.0f));
 
         if (m_CurrentMusicSource)
         {
-            alSourcef(m_CurrentMusicSource, AL_GAIN, m_MusicVolume);
+            m_SourcePool.SetGain(m_CurrentMusicSource, m_MusicVolume);
         }
     }
 
     void OpenALAudio::SetSoundVolume(const char* filepath, int volume)
     {
-        float normalizedVolume = std::max(0.0f, std::min(static_cast<float>(volume) / 100.0f, 1.0f));
+        if (!m_Initialized) return;
 
-        uint32_t audioKey = GenerateAudioKey(filepath);
-        auto it = m_AudioBuffers.find(audioKey);
-        if (it != m_AudioBuffers.end())
+        EnqueueSoundCommand(AudioCommand::EType::kSetSoundVolume, filepath, HashAudioPath(filepath), volume);
+    }
+
+    void OpenALAudio::SetSoundVolume(SoundId sound, int volume)
+    {
+        if (!m_Initialized) return;
+
+        EnqueueSoundCommand(AudioCommand::EType::kSetSoundVolume, sound.GetPath(), sound.GetHash(), volume);
+    }
+
+    bool OpenALAudio::EnqueueCommand(const AudioCommand& command)
+    {
+        if (!m_Commands.TryPush(command))
         {
-            for (ALuint source : it->second.sources)
-            {
-                alSourcef(source, AL_GAIN, normalizedVolume);
-            }
+            printf("Warning: Audio command queue is full, dropping the command\n");
+            m_Stats.RecordDroppedCommand();
+            return false;
         }
+        return true;
     }
 
-    int OpenALAudio::GetMusicVolume()
+    bool OpenALAudio::EnqueueSoundCommand(AudioCommand::EType type, std::string_view filepath, uint32_t hash, int value)
     {
-        if (m_CurrentMusicSource)
+        AudioCommand command;
+        command.type = type;
+        command.action = EAudioAction::kStop;
+        command.value = value;
+        command.hash = hash;
+        if (!command.SetPath(filepath))
+        {
+            printf("Error: Audio path '%.*s' is longer than %d characters\n",
+                static_cast<int>(filepath.size()), filepath.data(), static_cast<int>(AudioCommand::kMaxPathLength));
+            return false;
+        }
+        return EnqueueCommand(command);
+    }
+
+    void OpenALAudio::ProcessCommands()
+    {
+        // Stop after one ring's worth so producers that never pause can't stall the tick
+        AudioCommand command;
+        for (size_t i = 0; i < m_Commands.Capacity() && m_Commands.TryPop(command); ++i)
         {
-            float volume;
-            alGetSourcef(m_CurrentMusicSource, AL_GAIN, &volume);
-            return static_cast<int>(volume * 100.0f);
+            ApplyCommand(command);
         }
-        return static_cast<int>(m_MusicVolume * 100.0f);
     }
 
-    int OpenALAudio::GetSoundVolume(const char* filepath)
+    void OpenALAudio::ApplyCommand(const AudioCommand& command)
     {
-        uint32_t audioKey = GenerateAudioKey(filepath);
-        auto it = m_AudioBuffers.find(audioKey);
-        if (it != m_AudioBuffers.end() && !it->second.sources.empty())
+        switch (command.type)
         {
-            float volume;
-            alGetSourcef(it->second.sources[0], AL_GAIN, &volume);
-            return static_cast<int>(volume * 100.0f);
+        case AudioCommand::EType::kPlaySound:
+        {
+            // Known sounds are found by the hash the caller took, a first play registers the path
+            uint32_t audioKey = ResolveAudioKey(command.hash, command.GetPath());
+            PlayWhenReady(command.path, audioKey != 0 ? audioKey : GenerateAudioKey(command.GetPath()));
+            break;
+        }
+        case AudioCommand::EType::kSetSoundVolume:
+            SetSoundVolumeByKey(ResolveAudioKey(command.hash, command.GetPath()), command.value);
+            break;
+        case AudioCommand::EType::kOperateSounds:
+            ApplySoundsAction(command.action);
+            break;
+        }
+    }
+
+    void OpenALAudio::SetSoundVolumeByKey(uint32_t audioKey, int volume)
+    {
+        float normalizedVolume = std::max(0.0f, std::min(static_cast<float>(volume) / 100.0f, 1.0f));
+
+        m_Voices.SetGain(audioKey, normalizedVolume);
+        for (const auto& voice : m_ProgressiveVoices)
+        {
+            if (voice->GetAudioKey() == audioKey) voice->SetGain(normalizedVolume);
         }
-        return 0;
+    }
+
+    int OpenALAudio::GetMusicVolume()
+    {
+        return m_MusicVolumeStatus.load(std::memory_order_relaxed);
+    }
+
+    int OpenALAudio::GetSoundVolume(const char* filepath)
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        ProcessCommands();
+        float gain = m_Voices.GetGain(FindAudioKey(filepath));
+        return gain >= 0.0f ? static_cast<int>(gain * 100.0f) : 0;
     }
 
     int OpenALAudio::GetMaxVolume()
@@ -485,276 +1549,272 @@ namespace Engine
         return 100; // OpenAL uses 0.0-1.0, we convert to 0-100 range
     }
 
+    void OpenALAudio::SetMusicStreaming(bool streaming)
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+
+        // Takes effect from the next PlayMusic call
+        m_StreamMusic = streaming;
+    }
+
     void OpenALAudio::SetFinishMusicCallback(void(*music_finished)())
     {
-        m_MusicFinishedCallback = music_finished;
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
 
-        // Note: OpenAL doesn't provide direct callback functionality
-        // You'll need to check the music state in your game loop
-        // and call the callback when the music finishes
+        // The audio thread checks the music every tick and calls this once it stops
+        m_MusicFinishedCallback = music_finished;
     }
 
     IAudio::EAudioFormat OpenALAudio::GetMusicType(const char* filepath)
     {
-        std::string path(filepath);
-        std::string ext;
+        return AudioAssets::GetFormat(filepath);
+    }
 
-        size_t dotPos = path.find_last_of('.');
-        if (dotPos != std::string::npos)
-        {
-            ext = path.substr(dotPos + 1);
-            // Convert to lowercase for comparison
-            std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
-        }
+    IAudio::SourcePoolStats OpenALAudio::GetSourcePoolStats()
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        const SourcePool::Stats& pool = m_SourcePool.GetStats();
+
+        SourcePoolStats stats;
+        stats.capacity = pool.capacity;
+        stats.inUse = pool.inUse;
+        stats.peakInUse = pool.peakInUse;
+        stats.leases = pool.leases;
+        stats.exhausted = pool.exhausted;
+        return stats;
+    }
+
+    IAudio::BufferCacheStats OpenALAudio::GetBufferCacheStats()
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        return m_BufferCache.GetStats();
+    }
 
-        if (ext == "wav") return EAudioFormat::kWav;
-        if (ext == "ogg") return EAudioFormat::kOgg;
-        if (ext == "mp3") return EAudioFormat::kMp3;
-        if (ext == "flac") return EAudioFormat::kFlac;
-        if (ext == "mid" || ext == "midi") return EAudioFormat::kMidi;
-        if (ext == "mod") return EAudioFormat::kMod;
-        if (ext == "aiff") return EAudioFormat::kAiff;
-        if (ext == "raw") return EAudioFormat::kRaw;
+    IAudio::AudioStats OpenALAudio::GetAudioStats()
+    {
+        // Read straight from the atomics, the audio thread may be in the middle of a tick
+        return m_Stats.Snapshot();
+    }
 
-        return EAudioFormat::kOthers;
+    void OpenALAudio::SetAudioStatsDump(const char* filepath, int intervalMs)
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        m_Stats.SetDump(filepath, intervalMs);
     }
 
+    // The music getters read what the last tick or music call published, they never wait for the audio thread
     bool OpenALAudio::IsMusicPlaying()
     {
-        if (!m_CurrentMusicSource)
-            return false;
-
-        ALint state;
-        alGetSourcei(m_CurrentMusicSource, AL_SOURCE_STATE, &state);
-        return state == AL_PLAYING;
+        return m_MusicPlayingStatus.load(std::memory_order_relaxed);
     }
 
     bool OpenALAudio::IsMusicPaused()
     {
-        if (!m_CurrentMusicSource)
-            return false;
-
-        ALint state;
-        alGetSourcei(m_CurrentMusicSource, AL_SOURCE_STATE, &state);
-        return state == AL_PAUSED;
+        return m_MusicPausedStatus.load(std::memory_order_relaxed);
     }
 
     bool OpenALAudio::IsMusicFading()
     {
-        return m_MusicFading;
+        return m_MusicFadingStatus.load(std::memory_order_relaxed);
     }
 
     // Helper method to clean up sources that have finished playing
     void OpenALAudio::CleanupFinishedSources()
     {
-        for (auto& pair : m_AudioBuffers)
-        {
-            auto& sources = pair.second.sources;
-            sources.erase(
-                std::remove_if(sources.begin(), sources.end(),
-                    [](ALuint source) {
-                        ALint state;
-                        alGetSourcei(source, AL_SOURCE_STATE, &state);
-                        if (state == AL_STOPPED)
-                        {
-                            alDeleteSources(1, &source);
-                            return true;
-                        }
-                        return false;
-                    }
-                ),
-                sources.end()
-            );
+        if (!m_alEventControlSOFT)
+        {
+            m_Voices.PollFinished(kMaxFinishedPollsPerUpdate);
+            return;
         }
-    }
 
-    bool OpenALAudio::LoadAudioFile(const char *filepath, ALuint &buffer)
-    {
-        // Detect file format
-        EAudioFormat format = GetMusicType(filepath);
-        
-        // Load based on format
-        switch (format)
+        ALuint source;
+        while (m_StoppedSources.TryPop(source))
         {
-        case EAudioFormat::kWav:
-            return LoadWAVFile(filepath, buffer);
-            
-        case EAudioFormat::kMp3:
-            return LoadMP3File(filepath, buffer);
-            
-        case EAudioFormat::kFlac:
-            return LoadFLACFile(filepath, buffer);
-            
-        default:
-			printf("Error: Unsupported audio format for file '%s'\n", filepath);
-            return false;
+            m_Voices.OnSourceStopped(source);
         }
-    }
 
-    bool OpenALAudio::LoadWAVFile(const char *filepath, ALuint &buffer)
-    {
-        // Initialize WAV decoder
-        drwav wav;
-        if (!drwav_init_file(&wav, filepath, nullptr))
+        // Some reports were dropped, check every voice once to catch up
+        if (m_StoppedSourcesOverflow.exchange(false, std::memory_order_acquire))
         {
-            // Log error or handle failure
-            return false;
+            m_Voices.PollFinished(m_Voices.GetRealVoiceCount() + m_Voices.GetVirtualVoiceCount());
         }
+    }
 
-        // Allocate buffer for audio data
-        std::vector<uint8_t> audioData(wav.totalPCMFrameCount * wav.channels * sizeof(int16_t));
-        
-        // Read PCM frames as 16-bit signed integers
-        drwav_uint64 framesRead = drwav_read_pcm_frames_s16(&wav, wav.totalPCMFrameCount,
-            reinterpret_cast<int16_t*>(audioData.data()));
+    bool OpenALAudio::UploadBuffer(const DecodedAudio& audio, AudioBuffer& target)
+    {
+        // Determine format (mono or stereo)
+        ALenum format = (audio.channels == 1) ? AL_FORMAT_MONO16 : AL_FORMAT_STEREO16;
+        ALsizei size = static_cast<ALsizei>(audio.GetSampleCount() * sizeof(int16_t));
 
-        // If framesRead == 0, it means no valid audio was read
-        if (framesRead == 0)
+        bool uploaded = false;
+        if (audio.mappedSamples && m_alBufferDataStatic)
         {
-			printf("Error: WAV file '%s' contains no valid audio data.\n", filepath);
-			drwav_uninit(&wav);
-            return false;
+            // OpenAL mixes straight from the mapped file, which the buffer now keeps open
+            m_alBufferDataStatic(target.buffer, format, const_cast<int16_t*>(audio.mappedSamples), size,
+                static_cast<ALsizei>(audio.sampleRate));
+            uploaded = m_Stats.TakeALError() == AL_NO_ERROR;
+            if (uploaded)
+            {
+                target.storage = audio.storage;
+            }
         }
 
-        // check if framesRead < totalPCMFrameCount in case the file is truncated
-        if (framesRead < wav.totalPCMFrameCount)
+        if (!uploaded)
         {
-            // Log a warning instead of failing completely
-			printf("Warning: WAV file '%s' may be truncated. Expected %d frames but read %d.\n",
-				filepath, wav.totalPCMFrameCount, static_cast<int>(framesRead));
+            // Load data into OpenAL buffer, mapped samples are copied once and the file can be closed
+            alBufferData(target.buffer, format, audio.GetSamples(), size, static_cast<ALsizei>(audio.sampleRate));
+            if (m_Stats.TakeALError() != AL_NO_ERROR) return false;
         }
 
-        // Determine format (mono or stereo)
-        ALenum format = (wav.channels == 1) ? AL_FORMAT_MONO16 : AL_FORMAT_STEREO16;
-        
-        // Load data into OpenAL buffer
-        alBufferData(buffer, format, audioData.data(), 
-            static_cast<ALsizei>(audioData.size()), wav.sampleRate);
-
-        // Clean up WAV decoder
-        drwav_uninit(&wav);
-
-        // Check for OpenAL errors
-        ALenum error = alGetError();
-        if (error != AL_NO_ERROR)
+        // Sources looping this buffer repeat only the loop region
+        if (m_HasLoopPoints && audio.loopEnd > audio.loopStart)
         {
-            // Log error or handle failure
-            return false;
+            ALint loopPoints[2] = { static_cast<ALint>(audio.loopStart), static_cast<ALint>(audio.loopEnd) };
+            alBufferiv(target.buffer, AL_LOOP_POINTS_SOFT, loopPoints);
+            if (m_Stats.TakeALError() != AL_NO_ERROR)
+            {
+                printf("Warning: Invalid loop points %d-%d, the whole sound will loop\n", loopPoints[0], loopPoints[1]);
+            }
         }
 
         return true;
     }
 
-    bool OpenALAudio::LoadMP3File(const char* filepath, ALuint& buffer)
+    float OpenALAudio::QueryBufferDuration(ALuint buffer)
     {
-        // Initialize MP3 decoder
-        drmp3 mp3;
-        if (!drmp3_init_file(&mp3, filepath, nullptr))
-        {
-            return false;
-        }
+        ALint size = 0, channels = 0, bits = 0, frequency = 0;
+        alGetBufferi(buffer, AL_SIZE, &size);
+        alGetBufferi(buffer, AL_CHANNELS, &channels);
+        alGetBufferi(buffer, AL_BITS, &bits);
+        alGetBufferi(buffer, AL_FREQUENCY, &frequency);
+
+        if (channels <= 0 || bits <= 0 || frequency <= 0) return 0.0f;
+        return static_cast<float>(size) / static_cast<float>(channels * (bits / 8) * frequency);
+    }
+
+    void OpenALAudio::ProcessCompletedLoads()
+    {
+        if (!m_DecodePool.CollectResults(m_CompletedLoads)) return;
 
-        // Retrieve the total number of PCM frames
-        drmp3_uint64 totalPCMFrameCount = drmp3_get_pcm_frame_count(&mp3);
-        if (totalPCMFrameCount == 0)
+        for (AudioDecodePool::Result& result : m_CompletedLoads)
         {
-            drmp3_uninit(&mp3);
-            return false;
-        }
+            auto pending = m_PendingLoads.find(result.audioKey);
+            if (pending == m_PendingLoads.end()) continue;
+
+            // Drop the result if the key was freed while it was decoding
+            bool success = result.success && m_AudioKeys.Contains(result.audioKey);
+            AudioBufferHandle buffer;
+            if (success)
+            {
+                auto it = m_AudioBuffers.find(result.audioKey);
+                buffer = it != m_AudioBuffers.end() ? it->second : nullptr;
+                if (!buffer)
+                {
+                    buffer = CreateBuffer();
+                    if (UploadBuffer(result.audio, *buffer))
+                    {
+                        buffer->duration = QueryBufferDuration(buffer->buffer);
+                        CacheBuffer(result.audioKey, buffer, pending->second.category);
+                    }
+                    else
+                    {
+                        success = false;
+                    }
+                }
 
-        // Allocate a buffer for the PCM data
-        std::vector<int16_t> audioData(static_cast<size_t>(totalPCMFrameCount) * mp3.channels);
+                // Start the sounds that were requested while the file was decoding
+                for (int i = 0; success && i < pending->second.playRequests; ++i)
+                {
+                    PlayBuffer(result.audioKey, buffer);
+                }
+            }
 
-        // Read the entire MP3 file into the PCM buffer
-        drmp3_uint64 framesRead = drmp3_read_pcm_frames_s16(
-            &mp3,
-            totalPCMFrameCount,
-            audioData.data()
-        );
+            // And the music track waiting on it
+            if (result.audioKey == m_PendingMusic.audioKey)
+            {
+                StartPendingMusic(success ? buffer : nullptr);
+            }
 
-        // If framesRead == 0, it means no valid audio was read
-        if (framesRead == 0)
-        {
-			printf("Error: MP3 file '%s' contains no valid audio data.\n", filepath);
-            drmp3_uninit(&mp3);
-            return false;
-        }
+            // Queued tracks hold on to their buffer so the cache can't drop it before they start
+            for (QueuedMusic& queued : m_MusicQueue)
+            {
+                if (success && !queued.track && !queued.buffer && FindAudioKey(queued.filepath) == result.audioKey)
+                {
+                    queued.buffer = buffer;
+                }
+            }
 
-        // check if framesRead < totalPCMFrameCount in case the file is truncated
-        if (framesRead < totalPCMFrameCount)
-        {
-            // Log a warning instead of failing completely
-			printf("Warning: MP3 file '%s' may be truncated. Expected %d frames but read %d.\n",
-				filepath, totalPCMFrameCount, static_cast<int>(framesRead));
+            pending->second.promise.set_value(success);
+            m_PendingLoads.erase(pending);
         }
 
-        // Determine the OpenAL format based on channel count
-        ALenum format = (mp3.channels == 1) ? AL_FORMAT_MONO16 : AL_FORMAT_STEREO16;
-
-        // Copy the PCM data into the OpenAL buffer
-        alBufferData(
-            buffer,
-            format,
-            audioData.data(),
-            static_cast<ALsizei>(audioData.size() * sizeof(int16_t)),
-            mp3.sampleRate
-        );
+        m_CompletedLoads.clear();
+    }
 
-        // Clean up the MP3 decoder
-        drmp3_uninit(&mp3);
+    AudioBufferHandle OpenALAudio::CreateBuffer()
+    {
+        AudioBuffer* buffer = new AudioBuffer();
+        alGenBuffers(1, &buffer->buffer);
 
-        // Check for OpenAL errors
-        return (alGetError() == AL_NO_ERROR);
+        // Handles are only dropped on the audio thread or under m_AudioMutex, so the lists need no lock of their own
+        return AudioBufferHandle(buffer, [this](AudioBuffer* released)
+            {
+                m_ReclaimedBuffers.push_back(released->buffer);
+                if (released->storage)
+                {
+                    m_ReclaimedStorage.push_back(std::move(released->storage));
+                }
+                delete released;
+            });
     }
 
-    bool OpenALAudio::LoadFLACFile(const char* filepath, ALuint& buffer)
+    AudioBufferHandle OpenALAudio::FindBufferForPlay(uint32_t audioKey)
     {
-        // Initialize FLAC decoder
-        drflac* flac = drflac_open_file(filepath, nullptr);
-        if (!flac)
+        auto it = m_AudioBuffers.find(audioKey);
+        if (it == m_AudioBuffers.end())
         {
-            return false;
+            m_BufferCache.RecordMiss();
+            return nullptr;
         }
 
-        // Read PCM data
-        std::vector<int16_t> audioData(flac->totalPCMFrameCount * flac->channels);
-        drflac_read_pcm_frames_s16(flac, flac->totalPCMFrameCount, audioData.data());
+        m_BufferCache.Touch(audioKey);
+        return it->second;
+    }
 
-        // Set format based on channel count
-        ALenum format = (flac->channels == 1) ? AL_FORMAT_MONO16 : AL_FORMAT_STEREO16;
-        
-        // Load into OpenAL buffer
-        alBufferData(buffer, format, audioData.data(), 
-            static_cast<ALsizei>(audioData.size() * sizeof(int16_t)), flac->sampleRate);
+    void OpenALAudio::CacheBuffer(uint32_t audioKey, const AudioBufferHandle& buffer, EAudioCategory category)
+    {
+        ALint size = 0;
+        alGetBufferi(buffer->buffer, AL_SIZE, &size);
 
-        // Cleanup
-        drflac_close(flac);
-        
-        return (alGetError() == AL_NO_ERROR);
+        m_AudioBuffers.insert({ audioKey, buffer });
+        m_BufferCache.Insert(audioKey, static_cast<uint64_t>(std::max(size, 0)), category);
     }
 
-    ALuint OpenALAudio::LoadAudioBuffer(const char* filepath, uint32_t audioKey)
+    void OpenALAudio::EnforceMemoryBudget()
     {
-        // Check if buffer is already loaded
-        auto it = m_AudioBuffers.find(audioKey);
-        if (it != m_AudioBuffers.end())
-        {
-            return it->second.buffer;
-        }
+        if (!m_BufferCache.IsOverBudget()) return;
 
-        // Create new OpenAL buffer
-        AudioBuffer newBuffer;
-        alGenBuffers(1, &newBuffer.buffer);
+        // Buffers music or voices hold a handle to stay, the budget catches up once they finish
+        m_BufferCache.CollectEvictions([this](uint32_t audioKey)
+            {
+                return m_AudioBuffers.at(audioKey).use_count() > 1;
+            }, m_Evictions);
 
-        // Load audio data into buffer using format detection
-        if (!LoadAudioFile(filepath, newBuffer.buffer))
+        // The key stays registered, the next play reloads the file
+        for (uint32_t audioKey : m_Evictions)
         {
-            alDeleteBuffers(1, &newBuffer.buffer);
-            return 0;
+            m_AudioBuffers.erase(audioKey);
+            m_BufferCache.Evict(audioKey);
         }
+        m_Evictions.clear();
+    }
+
+    void OpenALAudio::ReclaimBuffers()
+    {
+        if (m_ReclaimedBuffers.empty()) return;
 
-        // Cache the buffer
-        m_AudioBuffers.insert({ audioKey, newBuffer });
-        return newBuffer.buffer;
+        alDeleteBuffers(static_cast<ALsizei>(m_ReclaimedBuffers.size()), m_ReclaimedBuffers.data());
+        m_ReclaimedBuffers.clear();
+        m_ReclaimedStorage.clear();
     }
 }
\ No newline at end of file
@@ -5,31 +5,39 @@
 #include "IAudio.h"
 #include "AL/al.h"
 #include "AL/alc.h"
+#include "AL/alext.h"
+#include "MusicStream.h"
+#include "AudioDecodePool.h"
+#include "AudioCommand.h"
+#include "SourcePool.h"
+#include "VoiceManager.h"
+#include "AudioBufferCache.h"
+#include "AudioAssets.h"
+#include "AudioStatsRecorder.h"
+#include "ProgressiveSound.h"
+#include "AudioBuffer.h"
+#include "../../Utility/MPSCQueue.h"
 #include <unordered_map>
+#include <unordered_set>
+#include <deque>
+#include <atomic>
 #include <string>
 #include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <chrono>
 
 namespace Engine
 {
-    // Buffer ID and sources using this buffer
-    struct AudioBuffer
-    {
-        // Buffer ID which helps to identify the sound dat
-        ALuint buffer;
-
-        // Sources using this buffer. Multiple sources can use the same buffer (eg: footsteps, gunshots, etc.)
-        std::vector<ALuint> sources;
-
-		// Default constructor
-		AudioBuffer() : buffer(0) {}
-    };
-
     // OpenAL audio system
     class OpenALAudio : public IAudio
     {
     public:
         // Default constructor
-        OpenALAudio();
+        explicit OpenALAudio(const AudioSystemOptions& options = AudioSystemOptions());
 
         // Default destructor
         virtual ~OpenALAudio();
@@ -39,10 +47,19 @@ namespace Engine
 
         // Music playback functions
         virtual bool PlayMusic(const char* filepath) override;
+        virtual bool PlayMusic(SoundId music) override;
+        virtual bool QueueMusic(const char* filepath) override;
+        virtual void ClearMusicQueue() override;
         virtual bool PlaySoundEffect(const char* filepath) override;
+        virtual bool PlaySoundEffect(SoundId sound) override;
+        virtual bool PlaySoundEffectWhenReady(const char* filepath) override;
+        virtual AudioLoadHandle LoadAudioAsync(const char* filepath) override;
+        virtual void Update() override;
+        virtual bool RenderAudio(float* out, uint32_t frameCount) override;
         virtual void OperateCurrentMusic(EAudioAction action) override;
         virtual void OperateCurrentSounds(EAudioAction action) override;
         virtual void FadeInMusic(const char* filepath, int loops, int ms) override;
+        virtual bool CrossfadeMusic(const char* filepath, int loops, int ms) override;
         virtual void FadeOutMusic(int ms) override;
         virtual void FreeMusicByKey(uint32_t audioKey) override;
         virtual void FreeSoundByKey(uint32_t audioKey) override;
@@ -50,12 +67,24 @@ namespace Engine
         // Volume control
         virtual void SetMusicVolume(int volume) override;
         virtual void SetSoundVolume(const char* filepath, int volume) override;
+        virtual void SetSoundVolume(SoundId sound, int volume) override;
         virtual int GetMusicVolume() override;
         virtual int GetSoundVolume(const char* filepath) override;
         virtual int GetMaxVolume() override;
 
         // Position and callback
         virtual void SetMusicPosition(double position_x, double position_y) override;
+        virtual void SetSoundPriority(const char* filepath, int priority) override;
+        virtual void SetSoundProgressive(const char* filepath, bool progressive) override;
+        virtual void SetMaxRealVoices(int count) override;
+        virtual void SetMusicStreaming(bool streaming) override;
+        virtual void SetAudioTickInterval(int ms) override;
+        virtual void SetAudioMemoryBudget(uint64_t bytes) override;
+        virtual void SetAudioMemoryBudget(EAudioCategory category, uint64_t bytes) override;
+        virtual bool MountSoundBank(const char* filepath) override;
+        virtual bool LoadCompressedAudio(const char* filepath) override;
+        virtual void FreeCompressedAudio(const char* filepath) override;
+        virtual bool EnableDecodedAudioCache(const char* directory, uint64_t maxBytes) override;
         virtual void SetFinishMusicCallback(void(*music_finished)()) override;
 
         // Status queries
@@ -63,39 +92,299 @@ namespace Engine
         virtual bool IsMusicPlaying() override;
         virtual bool IsMusicPaused() override;
         virtual bool IsMusicFading() override;
+        virtual SourcePoolStats GetSourcePoolStats() override;
+        virtual BufferCacheStats GetBufferCacheStats() override;
+        virtual AudioStats GetAudioStats() override;
+        virtual void SetAudioStatsDump(const char* filepath, int intervalMs) override;
 
     private:
         // Helper functions for audio loading
-        bool LoadAudioFile(const char* filepath, ALuint& buffer);
-        ALuint LoadAudioBuffer(const char* filepath, uint32_t audioKey);
-        bool LoadWAVFile(const char* filepath, ALuint& buffer);
-        bool LoadMP3File(const char* filepath, ALuint& buffer);
-        bool LoadFLACFile(const char* filepath, ALuint& buffer);
+        bool UploadBuffer(const DecodedAudio& audio, AudioBuffer& target);
+
+        // Generate a buffer whose deletion is deferred to ReclaimBuffers once the last handle is dropped
+        AudioBufferHandle CreateBuffer();
+
+        // Resident buffer for a play, counted as a cache hit or miss. Null if it has to be loaded
+        AudioBufferHandle FindBufferForPlay(uint32_t audioKey);
+
+        // Add a freshly uploaded buffer to m_AudioBuffers and the cache
+        void CacheBuffer(uint32_t audioKey, const AudioBufferHandle& buffer, EAudioCategory category);
+
+        // Drop the cache's reference to a buffer, voices still playing it keep it alive
+        void ReleaseBuffer(uint32_t audioKey);
+
+        // Evict least recently used buffers nothing else references until the cache fits its budgets
+        void EnforceMemoryBudget();
+
+        // Delete every buffer whose last handle went away, in one call at the end of the tick
+        void ReclaimBuffers();
+
+        // Queue a background load of a file not loading yet, category picks the budget it is cached under
+        void SubmitLoad(const char* filepath, uint32_t audioKey, EAudioCategory category,
+            std::shared_ptr<ProgressiveAudio> progressive = nullptr);
+
+        // Upload background loads that finished decoding and play the sounds waiting on them
+        void ProcessCompletedLoads();
 
         // Helper functions
         void CleanupBuffer(const std::string& filepath);
         ALuint CreateSource();
-        void UpdateFading();
+        bool PlayBuffer(uint32_t audioKey, const AudioBufferHandle& audioBuffer);
+        static float QueryBufferDuration(ALuint buffer);
+        void SetSoundVolumeByKey(uint32_t audioKey, int volume);
+
+        // Queue a command for the audio thread, never blocks. Returns false if the ring is full
+        bool EnqueueCommand(const AudioCommand& command);
+        bool EnqueueSoundCommand(AudioCommand::EType type, std::string_view filepath, uint32_t hash, int value);
+
+        // Apply the queued commands in one batch, run with m_AudioMutex held. Every tick runs it, and so does every
+        // direct call that reads or changes sounds, so that call sees the sound calls queued before it
+        void ProcessCommands();
+        void ApplyCommand(const AudioCommand& command);
+
+        // Play a resident sound right away, otherwise load it in the background and play it when it lands
+        bool PlayWhenReady(const char* filepath, uint32_t audioKey);
+
+        // Start a progressive voice for a sound that isn't loaded, sharing its decode if one is already running.
+        // Returns false when the sound has to wait for a full load instead
+        bool PlayProgressive(const char* filepath, uint32_t audioKey);
+
+        // Feed progressive voices and drop the finished ones
+        void UpdateProgressiveVoices();
+
+        // Work behind the calls of the same name, run with m_AudioMutex held
+        void ApplyMusicAction(EAudioAction action);
+        void ApplyPendingMusicAction(EAudioAction action);
+        void ApplySoundsAction(EAudioAction action);
+        void ApplyMusicVolume(int volume);
+        void UpdateFading(float deltaSeconds);
+
+        // Prebuffer the incoming crossfade track, then advance the gains of both tracks
+        void UpdateCrossfade(float deltaSeconds);
+        void BeginCrossfade();
+        void ReleaseOutgoingMusic();
+        void CancelCrossfade();
         void CleanupFinishedSources();
+        void StopCurrentMusic();
+
+        // Open an ALC_SOFT_loopback device and load its entry points, null if the extension is missing
+        ALCdevice* OpenLoopbackDevice();
+
+        // Subscribe to source state changes through AL_SOFT_events, returns false when unsupported
+        bool EnableSourceEvents();
+        void DisableSourceEvents();
+
+        // Called on OpenAL's event thread, must not call back into OpenAL
+        static void AL_APIENTRY OnSourceEvent(ALenum eventType, ALuint object, ALuint param,
+            ALsizei length, const ALchar* message, void* userParam) noexcept;
+
+        // Audio thread loop, runs ServiceAudio every tick until the system is destroyed
+        void AudioThreadMain();
+
+        // One audio tick. Returns true when the music stopped since the last tick
+        bool ServiceAudio(float deltaSeconds);
+
+        // Refill the music stream and check whether the music is still going
+        bool UpdateMusicState();
+
+        // Store the music status the getters read without locking. Runs at the end of every tick and of every
+        // call that changes the music, through MusicStatusScope
+        void PublishMusicStatus();
+
+        struct MusicStatusScope
+        {
+            OpenALAudio& audio;
+            ~MusicStatusScope() { audio.PublishMusicStatus(); }
+        };
+
+        // Sample the voice and cache gauges at the end of a tick, and write the stats dump when it is due
+        void UpdateStats();
+
+        // Follow the stream into queued tracks and hand it the next one
+        void UpdateMusicQueue();
+
+        // Start the first playable queued track, false if the queue ran out
+        bool PlayQueuedMusic();
+
+        // Make an opened stream the current music and start it
+        bool StartMusicStream(std::unique_ptr<MusicStream> stream, uint32_t audioKey);
+
+        // Make a resident buffer the current music on a leased source, started unless held is set
+        bool StartMusicBuffer(const AudioBufferHandle& buffer, uint32_t audioKey, bool held = false);
+
+        // Make the track waiting on its load the current music, or drop it if the load failed
+        void StartPendingMusic(const AudioBufferHandle& buffer);
+
+        // Take the next track back from a stream that is going away, so it stays ready at the front of the queue
+        void ReclaimNextMusic(MusicStream& stream);
 
     private:
         ALCdevice* m_Device;     // Pointer to the audio device
         ALCcontext* m_Context;   // Audio context for this device
+
+        // Health counters, before everything that records into them: the source pool, streams and m_Assets
+        AudioStatsRecorder m_Stats;
       
+        // Sources leased to sound effects and buffered music
+        SourcePool m_SourcePool;
+
+        // Sound effect voices, with priorities and virtualization
+        VoiceManager m_Voices;
+
+        // Priority set per sound, 0 when not set
+        std::unordered_map<uint32_t, int> m_SoundPriorities;
+
+        // Sounds played while they decode, and the voices currently doing so
+        std::unordered_set<uint32_t> m_ProgressiveSounds;
+        std::vector<std::unique_ptr<ProgressiveVoice>> m_ProgressiveVoices;
+
+        // Commands from any thread, applied at the start of every tick
+        MPSCQueue<AudioCommand> m_Commands;
+
+        // Sources OpenAL reported as stopped, pushed from the event thread and drained every tick
+        MPSCQueue<ALuint> m_StoppedSources;
+
+        // Set when a stop report was dropped because the queue was full, forces a full poll
+        std::atomic<bool> m_StoppedSourcesOverflow;
+
+        // AL_SOFT_events entry points, null when the extension is missing
+        LPALEVENTCONTROLSOFT m_alEventControlSOFT;
+        LPALEVENTCALLBACKSOFT m_alEventCallbackSOFT;
+
+        // AL_EXT_STATIC_BUFFER entry point, null when the extension is missing
+        PFNALBUFFERDATASTATICPROC m_alBufferDataStatic;
+
+        // AL_SOFT_loop_points is supported, buffers can loop a region instead of the whole sound
+        bool m_HasLoopPoints;
+
+        // AL_SOFT_deferred_updates entry points, null when the extension is missing
+        LPALDEFERUPDATESSOFT m_alDeferUpdatesSOFT;
+        LPALPROCESSUPDATESSOFT m_alProcessUpdatesSOFT;
+
+        // Time of the last audio tick, for advancing fades and virtual voices
+        std::chrono::steady_clock::time_point m_LastUpdateTime;
+
+        // Backend and output format chosen at creation
+        AudioSystemOptions m_Options;
+
+        // ALC_SOFT_loopback entry point, only set for the loopback backend
+        LPALCRENDERSAMPLESSOFT m_alcRenderSamplesSOFT;
+
         // Audio buffer map using audio path key as a unique identifier
-        std::unordered_map<uint32_t, AudioBuffer> m_AudioBuffers;
+        std::unordered_map<uint32_t, AudioBufferHandle> m_AudioBuffers;
+
+        // Recency and byte budgets of m_AudioBuffers
+        AudioBufferCache m_BufferCache;
+        std::vector<uint32_t> m_Evictions;
+
+        // Buffers whose last handle was dropped, deleted together by ReclaimBuffers. Static buffers keep
+        // their storage here until then
+        std::vector<ALuint> m_ReclaimedBuffers;
+        std::vector<std::shared_ptr<const void>> m_ReclaimedStorage;
 
         // Path key of the current music tracking
         uint32_t m_CurrentMusicPathKey;
 
         // Source of the current music
         ALuint m_CurrentMusicSource;
+
+        // Buffer the current music plays, null when it streams
+        AudioBufferHandle m_CurrentMusicBuffer;
+
+        // Streaming state, also read by PlayMusic and QueueMusic before they take the lock
+        std::atomic<bool> m_StreamMusic;
+        std::unique_ptr<MusicStream> m_MusicStream;
+
+        // Music that isn't streamed is decoded on a worker and becomes the current track once it lands.
+        // Music calls made while it loads are kept here and applied when the source starts
+        struct PendingMusic
+        {
+            uint32_t audioKey = 0;      // 0 when no track is loading
+            bool looping = false;
+            bool muted = false;
+            bool held = false;          // Rewound, starts at the beginning without playing
+        };
+        PendingMusic m_PendingMusic;
+
+        // Crossfade between the current music and an incoming stream. The incoming track is prebuffered
+        // first, then becomes the current music while the outgoing one fades out on its own source
+        struct MusicCrossfade
+        {
+            std::unique_ptr<MusicStream> incoming;
+            uint32_t incomingKey = 0;
+            std::unique_ptr<MusicStream> outgoingStream;
+            ALuint outgoingSource = 0;              // Owned by outgoingStream, or leased from the pool for buffered music
+            AudioBufferHandle outgoingBuffer;
+            float outgoingGain = 0.0f;              // Gain the outgoing track had when the fade began
+            float duration = 0.0f;
+            float elapsed = 0.0f;
+            bool active = false;                    // Gains are crossing
+        };
+        MusicCrossfade m_Crossfade;
+
+        // Thread servicing fades, stream refills, finished voices and the music callback at a fixed tick.
+        // Queued calls go through m_Commands, the remaining public calls and the tick hold m_AudioMutex,
+        // which is recursive because those calls nest
+        std::thread m_AudioThread;
+        std::recursive_mutex m_AudioMutex;
+        std::condition_variable_any m_AudioWakeup;
+        bool m_AudioThreadExit;
+        std::chrono::microseconds m_TickInterval;
+
+        // A background load and the plays requested before it finished
+        struct PendingLoad
+        {
+            std::promise<bool> promise;
+            AudioLoadHandle future;
+            int playRequests = 0;
+            std::shared_ptr<ProgressiveAudio> progressive;    // Set for progressive loads
+            EAudioCategory category = EAudioCategory::kSound;
+        };
+
+        // Sound banks, resident compressed files and the decoded PCM cache. Decode workers use it
+        AudioAssets m_Assets;
+
+        // Background decoding, results are uploaded by the audio thread
+        AudioDecodePool m_DecodePool;
+        std::unordered_map<uint32_t, PendingLoad> m_PendingLoads;
+        std::vector<AudioDecodePool::Result> m_CompletedLoads;
         
         // Audio state
         bool m_Initialized;
         float m_MusicVolume;
         bool m_MusicPaused;
         bool m_MusicFading;
+
+        // Music status for IsMusicPlaying, IsMusicPaused, IsMusicFading and GetMusicVolume, so polling it every frame
+        // never waits on a tick
+        std::atomic<bool> m_MusicPlayingStatus;
+        std::atomic<bool> m_MusicPausedStatus;
+        std::atomic<bool> m_MusicFadingStatus;
+        std::atomic<int> m_MusicVolumeStatus;
+
+        // Music was started and hasn't been reported as finished yet
+        bool m_MusicActive;
+
+        // Music was stopped on purpose, the queue doesn't move on when it ends
+        bool m_MusicStopped;
+
+        // A track to play after the current music. QueueMusic opens it and decodes its first block when music
+        // streams, or has the decode pool decode all of it when it doesn't, so moving on to it never touches
+        // the file on the audio thread
+        struct QueuedMusic
+        {
+            std::string filepath;
+            std::unique_ptr<MusicStream::Track> track;    // Null when it was queued without streaming
+            AudioBufferHandle buffer;                     // Set once its load lands when queued without streaming
+        };
+
+        // Tracks to play after the current music. Once m_NextMusicPrepared is set the front one has
+        // been handed to the stream, waiting for the current track to run out
+        std::deque<QueuedMusic> m_MusicQueue;
+        bool m_NextMusicPrepared;
+        uint32_t m_NextMusicPathKey;
+
+        // Called on the audio thread, without m_AudioMutex held
         void(*m_MusicFinishedCallback)();
 
         // Fading state
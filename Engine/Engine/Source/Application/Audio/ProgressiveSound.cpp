@@ -0,0 +1,202 @@
+﻿// © 2025 Yanan Liu <yanan.liu0325@gmail.com>
+
+#include "ProgressiveSound.h"
+#include "AudioStatsRecorder.h"
+#include <algorithm>
+#include <cstring>
+
+namespace Engine
+{
+    ProgressiveAudio::ProgressiveAudio()
+        : m_Channels(0)
+        , m_SampleRate(0)
+        , m_DecodedFrames(0)
+        , m_State(EState::kDecoding)
+    {
+    }
+
+    void ProgressiveAudio::Begin(uint32_t channels, uint32_t sampleRate, uint64_t expectedFrames)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Samples.reserve(static_cast<size_t>(expectedFrames) * channels);
+        }
+        m_SampleRate.store(sampleRate, std::memory_order_release);
+        m_Channels.store(channels, std::memory_order_release);
+    }
+
+    void ProgressiveAudio::Append(const int16_t* samples, uint64_t frameCount)
+    {
+        const size_t sampleCount = static_cast<size_t>(frameCount) * GetChannels();
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Samples.insert(m_Samples.end(), samples, samples + sampleCount);
+        }
+        m_DecodedFrames.fetch_add(frameCount, std::memory_order_release);
+    }
+
+    void ProgressiveAudio::Finish(bool success)
+    {
+        m_State.store(success ? EState::kComplete : EState::kFailed, std::memory_order_release);
+    }
+
+    uint64_t ProgressiveAudio::Read(uint64_t frame, int16_t* out, uint64_t maxFrames) const
+    {
+        const uint32_t channels = GetChannels();
+        const uint64_t decoded = GetDecodedFrames();
+        if (frame >= decoded) return 0;
+
+        const uint64_t frames = std::min(maxFrames, decoded - frame);
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        std::memcpy(out, m_Samples.data() + frame * channels, static_cast<size_t>(frames) * channels * sizeof(int16_t));
+        return frames;
+    }
+
+    ProgressiveVoice::ProgressiveVoice(uint32_t audioKey, std::shared_ptr<ProgressiveAudio> audio, ALuint source, SourcePool& pool,
+        AudioStatsRecorder& stats)
+        : m_AudioKey(audioKey)
+        , m_Audio(std::move(audio))
+        , m_Source(source)
+        , m_Pool(pool)
+        , m_Stats(stats)
+        , m_Buffers{}
+        , m_Format(AL_FORMAT_MONO16)
+        , m_FramesPerBuffer(0)
+        , m_Cursor(0)
+        , m_Started(false)
+        , m_Paused(false)
+        , m_Stopped(false)
+    {
+    }
+
+    ProgressiveVoice::~ProgressiveVoice()
+    {
+        // Releasing stops the source and unqueues every buffer, so they can be deleted right after
+        m_Pool.Release(m_Source);
+        if (m_Buffers[0])
+        {
+            alDeleteBuffers(kBufferCount, m_Buffers);
+        }
+    }
+
+    bool ProgressiveVoice::Update()
+    {
+        if (m_Stopped || m_Audio->HasFailed()) return false;
+
+        if (!m_Started)
+        {
+            // Wait for the first block, or the whole sound if it's shorter than that
+            const uint32_t sampleRate = m_Audio->GetSampleRate();
+            if (sampleRate == 0) return true;
+
+            m_FramesPerBuffer = std::max<uint64_t>(static_cast<uint64_t>(sampleRate) * kBufferMilliseconds / 1000, 1);
+            if (!m_Audio->IsComplete() && m_Audio->GetDecodedFrames() < m_FramesPerBuffer) return true;
+
+            return Start();
+        }
+
+        // Refill the buffers the source has finished with
+        ALint processed = 0;
+        alGetSourcei(m_Source, AL_BUFFERS_PROCESSED, &processed);
+        while (processed-- > 0)
+        {
+            ALuint buffer = 0;
+            alSourceUnqueueBuffers(m_Source, 1, &buffer);
+            m_IdleBuffers.push_back(buffer);
+        }
+
+        ALint queued = 0;
+        alGetSourcei(m_Source, AL_BUFFERS_QUEUED, &queued);
+        while (!m_IdleBuffers.empty() && QueueBlock(m_IdleBuffers.back(), queued == 0))
+        {
+            m_IdleBuffers.pop_back();
+            ++queued;
+        }
+
+        if (queued == 0)
+        {
+            // Played to the end of a complete file
+            if (m_Audio->IsComplete() && m_Cursor >= m_Audio->GetDecodedFrames()) return false;
+            return true;
+        }
+
+        // The decoder fell behind and the source ran dry, carry on now that there is more
+        ALint state = AL_STOPPED;
+        alGetSourcei(m_Source, AL_SOURCE_STATE, &state);
+        if (state == AL_STOPPED && !m_Paused)
+        {
+            alSourcePlay(m_Source);
+        }
+        return true;
+    }
+
+    void ProgressiveVoice::Pause()
+    {
+        m_Paused = true;
+        if (m_Started)
+        {
+            alSourcePause(m_Source);
+        }
+    }
+
+    void ProgressiveVoice::Resume()
+    {
+        m_Paused = false;
+        if (m_Started)
+        {
+            alSourcePlay(m_Source);
+        }
+    }
+
+    void ProgressiveVoice::Stop()
+    {
+        m_Stopped = true;
+    }
+
+    bool ProgressiveVoice::Start()
+    {
+        const uint32_t channels = m_Audio->GetChannels();
+        m_Format = (channels == 1) ? AL_FORMAT_MONO16 : AL_FORMAT_STEREO16;
+        m_Pcm.resize(static_cast<size_t>(m_FramesPerBuffer) * channels);
+
+        alGenBuffers(kBufferCount, m_Buffers);
+        if (m_Stats.TakeALError() != AL_NO_ERROR)
+        {
+            m_Buffers[0] = 0;
+            return false;
+        }
+
+        // Queue whatever is decoded already, the rest of the ring fills as the worker catches up
+        for (ALuint buffer : m_Buffers)
+        {
+            if (!QueueBlock(buffer, false))
+            {
+                m_IdleBuffers.push_back(buffer);
+            }
+        }
+
+        m_Started = true;
+        if (!m_Paused)
+        {
+            alSourcePlay(m_Source);
+        }
+        return true;
+    }
+
+    bool ProgressiveVoice::QueueBlock(ALuint buffer, bool starving)
+    {
+        const uint64_t available = m_Audio->GetDecodedFrames() - m_Cursor;
+        if (available == 0) return false;
+        if (available < m_FramesPerBuffer && !starving && !m_Audio->IsComplete()) return false;
+
+        const uint64_t frames = m_Audio->Read(m_Cursor, m_Pcm.data(), m_FramesPerBuffer);
+        alBufferData(buffer, m_Format, m_Pcm.data(),
+            static_cast<ALsizei>(frames * m_Audio->GetChannels() * sizeof(int16_t)),
+            static_cast<ALsizei>(m_Audio->GetSampleRate()));
+        if (m_Stats.TakeALError() != AL_NO_ERROR) return false;
+
+        alSourceQueueBuffers(m_Source, 1, &buffer);
+        m_Cursor += frames;
+        return true;
+    }
+}
@@ -0,0 +1,128 @@
+﻿// © 2025 Yanan Liu <yanan.liu0325@gmail.com>
+
+#pragma once
+
+#include "SourcePool.h"
+#include "AL/al.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Engine
+{
+    // PCM of one sound that a decode worker appends to block by block while the audio thread
+    // already plays what is there. Once complete it becomes the sound's static buffer as it is
+    class ProgressiveAudio
+    {
+    public:
+        // Default constructor
+        ProgressiveAudio();
+
+        ProgressiveAudio(const ProgressiveAudio&) = delete;
+        ProgressiveAudio& operator=(const ProgressiveAudio&) = delete;
+
+        // Worker side: set the format before the first block, expectedFrames may be 0 if unknown
+        void Begin(uint32_t channels, uint32_t sampleRate, uint64_t expectedFrames);
+        void Append(const int16_t* samples, uint64_t frameCount);
+        void Finish(bool success);
+
+        // Copy up to maxFrames decoded frames starting at frame, returns the number copied
+        uint64_t Read(uint64_t frame, int16_t* out, uint64_t maxFrames) const;
+
+    public:
+        // --------------------------------------------------------------------- //
+        // Accessors
+        // --------------------------------------------------------------------- //
+        uint32_t GetChannels() const { return m_Channels.load(std::memory_order_acquire); }
+        uint32_t GetSampleRate() const { return m_SampleRate.load(std::memory_order_acquire); }
+        uint64_t GetDecodedFrames() const { return m_DecodedFrames.load(std::memory_order_acquire); }
+        bool IsComplete() const { return m_State.load(std::memory_order_acquire) == EState::kComplete; }
+        bool HasFailed() const { return m_State.load(std::memory_order_acquire) == EState::kFailed; }
+
+        // Every sample, only stable once IsComplete()
+        const std::vector<int16_t>& GetSamples() const { return m_Samples; }
+
+    private:
+        enum class EState
+        {
+            kDecoding,
+            kComplete,
+            kFailed
+        };
+
+        // Guards m_Samples while it can still grow
+        mutable std::mutex m_Mutex;
+        std::vector<int16_t> m_Samples;
+
+        std::atomic<uint32_t> m_Channels;
+        std::atomic<uint32_t> m_SampleRate;
+        std::atomic<uint64_t> m_DecodedFrames;
+        std::atomic<EState> m_State;
+    };
+
+    // A sound playing from a queued-buffer source while its file is still decoding. Playback starts as soon
+    // as the first block is in, so the wait doesn't grow with the length of the file.
+    // The voice leases its source from the pool and gives it back when destroyed
+    class ProgressiveVoice
+    {
+    public:
+        // Number of buffers queued on the source
+        static constexpr int kBufferCount = 4;
+
+        // Audio decoded before playback starts, and in each queued buffer
+        static constexpr uint32_t kBufferMilliseconds = 100;
+
+        // Default constructor, AL errors are counted on stats
+        ProgressiveVoice(uint32_t audioKey, std::shared_ptr<ProgressiveAudio> audio, ALuint source, SourcePool& pool,
+            AudioStatsRecorder& stats);
+
+        // Default destructor
+        ~ProgressiveVoice();
+
+        ProgressiveVoice(const ProgressiveVoice&) = delete;
+        ProgressiveVoice& operator=(const ProgressiveVoice&) = delete;
+
+        // Start once the first block is decoded, then queue blocks as they arrive.
+        // Returns false once everything has played, or the decode failed
+        bool Update();
+
+        void Pause();
+        void Resume();
+        void Stop();
+
+    public:
+        // --------------------------------------------------------------------- //
+        // Accessors & Mutators
+        // --------------------------------------------------------------------- //
+        uint32_t GetAudioKey() const { return m_AudioKey; }
+        void SetGain(float gain) { m_Pool.SetGain(m_Source, gain); }
+
+    private:
+        // Start playback with whatever blocks are ready
+        bool Start();
+
+        // Fill and queue the buffer with the next block. A partial block is only taken when the file is
+        // complete or the source would otherwise run dry. Returns false if nothing was queued
+        bool QueueBlock(ALuint buffer, bool starving);
+
+    private:
+        uint32_t m_AudioKey;
+        std::shared_ptr<ProgressiveAudio> m_Audio;
+        ALuint m_Source;
+        SourcePool& m_Pool;
+        AudioStatsRecorder& m_Stats;
+
+        ALuint m_Buffers[kBufferCount];
+        std::vector<ALuint> m_IdleBuffers;    // Not queued, waiting for the decoder to catch up
+        std::vector<int16_t> m_Pcm;
+        ALenum m_Format;
+        uint64_t m_FramesPerBuffer;
+        uint64_t m_Cursor;                    // Next frame to queue
+
+        bool m_Started;
+        bool m_Paused;
+        bool m_Stopped;
+    };
+}
@@ -0,0 +1,1343 @@
+﻿// © 2025 Yanan Liu <yanan.liu0325@gmail.com>
+
+#include "SoftwareAudio.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace Engine
+{
+    // Default mixer tick, also the length of one block handed to the sink
+    static constexpr auto kDefaultTickInterval = std::chrono::milliseconds(5);
+
+    // Voices mixed per block by default, the same as the OpenAL backend's source pool
+    static constexpr uint32_t kDefaultMixedVoices = 128;
+
+    // Commands that can wait for the mixer thread, one block rarely has more than a few dozen
+    static constexpr size_t kCommandQueueSize = 1024;
+
+    // Resident PCM allowed before unused sounds start being evicted, about 25 minutes of 44.1 kHz stereo
+    static constexpr uint64_t kDefaultAudioMemoryBudget = 256ull * 1024 * 1024;
+
+    // Voices quieter than this aren't worth a mixing slot, about -60 dB
+    static constexpr float kInaudibleGain = 0.001f;
+
+    // Voices play mono and stereo sources only
+    static bool IsPlayableChannelCount(uint32_t channels, const char* filepath)
+    {
+        if (channels == 0 || channels > MixerVoice::kMaxChannels)
+        {
+            printf("Error: Sound file '%s' has %u channels, only mono and stereo can be played.\n", filepath, channels);
+            return false;
+        }
+        return true;
+    }
+
+    SoftwareAudio::SoftwareAudio(const AudioSystemOptions& options)
+        : m_Options(options)
+        , m_Kernels(&GetMixerKernels())
+        , m_MaxRealVoices(kDefaultMixedVoices)
+        , m_Commands(kCommandQueueSize)
+        , m_Assets(&m_Stats)
+        , m_DecodePool([this](const char* filepath, EAudioFormat format, EAudioCategory category,
+            const std::shared_ptr<ProgressiveAudio>& progressive, DecodedAudio& out)
+            {
+                return progressive ? m_Assets.DecodeProgressive(filepath, format, progressive, out) : m_Assets.Decode(filepath, format, category, out);
+            })
+        , m_CurrentMusicPathKey(0)
+        , m_StreamMusic(true)
+        , m_Initialized(false)
+        , m_MusicVolume(1.0f)
+        , m_MusicPaused(false)
+        , m_MusicFading(false)
+        , m_MusicActive(false)
+        , m_MusicStopped(false)
+        , m_MusicFinishedCallback(nullptr)
+        , m_FadeStartVolume(0.0f)
+        , m_FadeTargetVolume(0.0f)
+        , m_FadeTimeRemaining(0.0f)
+        , m_FadeDuration(0.0f)
+        , m_MixerThreadExit(false)
+        , m_TickInterval(kDefaultTickInterval)
+    {
+        m_SoundCache.SetBudget(kDefaultAudioMemoryBudget);
+        m_VoiceStats.capacity = m_MaxRealVoices;
+    }
+
+    SoftwareAudio::~SoftwareAudio()
+    {
+        // Stop the mixer thread before tearing down the state it works on
+        if (m_MixerThread.joinable())
+        {
+            {
+                std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+                m_MixerThreadExit = true;
+            }
+            m_MixerWakeup.notify_one();
+            m_MixerThread.join();
+        }
+
+        // Nobody is left to keep outstanding background loads
+        m_DecodePool.Shutdown();
+        for (auto& pair : m_PendingLoads)
+        {
+            pair.second.promise.set_value(false);
+        }
+        m_PendingLoads.clear();
+
+        m_Voices.clear();
+        m_Music.reset();
+        m_Crossfade.outgoing.reset();
+        m_Sounds.clear();
+
+        // A WAV sink finishes its file here
+        if (m_Sink)
+        {
+            m_Sink->Close();
+        }
+    }
+
+    bool SoftwareAudio::Init()
+    {
+        if (m_Options.channels != 1 && m_Options.channels != 2)
+        {
+            printf("Error: The software mixer outputs mono or stereo, not %u channels\n", m_Options.channels);
+            return false;
+        }
+        if (m_Options.sampleRate == 0)
+        {
+            printf("Error: The software mixer needs an output sample rate\n");
+            return false;
+        }
+
+        m_Sink = MixerSink::Create(m_Options.sink, m_Options.wavPath, m_Stats);
+        if (!m_Sink->Open(m_Options.sampleRate, m_Options.channels))
+        {
+            m_Sink.reset();
+            return false;
+        }
+        printf("Software mixer using %s kernels\n", m_Kernels->name);
+
+        m_Initialized = true;
+        if (m_Sink->IsRealTime())
+        {
+            // The WAV and null sinks are serviced by RenderAudio instead
+            m_MixerThread = std::thread(&SoftwareAudio::MixerThreadMain, this);
+        }
+        m_DecodePool.Start();
+        return true;
+    }
+
+    void SoftwareAudio::MixerThreadMain()
+    {
+        std::unique_lock<std::recursive_mutex> lock(m_AudioMutex);
+        auto nextTick = std::chrono::steady_clock::now();
+        while (!m_MixerThreadExit)
+        {
+            // Top the sink up, one block for every buffer it has played
+            const uint32_t blockFrames = GetBlockFrames();
+            m_Output.resize(static_cast<size_t>(blockFrames) * m_Options.channels);
+            while (!m_MixerThreadExit && m_Sink->GetFreeBlocks() > 0)
+            {
+                void(*musicFinished)() = RenderBlock(m_Output.data(), blockFrames) ? m_MusicFinishedCallback : nullptr;
+                const bool written = m_Sink->Write(m_Output.data(), blockFrames);
+
+                // Run the callback unlocked so it can call back into the audio system or take game locks
+                if (musicFinished)
+                {
+                    lock.unlock();
+                    musicFinished();
+                    lock.lock();
+                }
+
+                // A sink that refused the block still reports the same free room, try again next tick
+                if (!written)
+                {
+                    break;
+                }
+            }
+
+            // Ticks are scheduled from the previous deadline so they don't drift,
+            // after a stall the schedule restarts from now instead of catching up in a burst
+            nextTick += m_TickInterval;
+            auto now = std::chrono::steady_clock::now();
+            if (nextTick < now)
+            {
+                nextTick = now;
+            }
+            m_MixerWakeup.wait_until(lock, nextTick, [this] { return m_MixerThreadExit; });
+        }
+    }
+
+    bool SoftwareAudio::RenderAudio(float* out, uint32_t frameCount)
+    {
+        std::unique_lock<std::recursive_mutex> lock(m_AudioMutex);
+        if (!m_Initialized || m_Sink->IsRealTime()) return false;
+
+        // Mix in tick-sized blocks, servicing before each one, so fades, loads and voices advance with
+        // rendered time however fast it is rendered
+        const uint32_t blockFrames = GetBlockFrames();
+        if (!out)
+        {
+            m_Output.resize(static_cast<size_t>(blockFrames) * m_Options.channels);
+        }
+
+        // A failed sink write doesn't stop the mix, out still gets every frame
+        bool written = true;
+        while (frameCount > 0)
+        {
+            const uint32_t frames = std::min(frameCount, blockFrames);
+            float* block = out ? out : m_Output.data();
+
+            void(*musicFinished)() = RenderBlock(block, frames) ? m_MusicFinishedCallback : nullptr;
+            written = m_Sink->Write(block, frames) && written;
+            if (musicFinished)
+            {
+                lock.unlock();
+                musicFinished();
+                lock.lock();
+            }
+
+            if (out)
+            {
+                out += static_cast<size_t>(frames) * m_Options.channels;
+            }
+            frameCount -= frames;
+        }
+        return written;
+    }
+
+    bool SoftwareAudio::RenderBlock(float* out, uint32_t frameCount)
+    {
+        const float deltaSeconds = static_cast<float>(frameCount) / m_Options.sampleRate;
+
+        ProcessCommands();
+        ProcessCompletedLoads();
+        UpdateFading(deltaSeconds);
+        UpdateCrossfade(deltaSeconds);
+        MixVoices(frameCount);
+
+        const float* bus[MixerVoice::kMaxChannels] = { m_Bus[0].data(), m_Bus[1].data() };
+        m_Kernels->interleave(bus, m_Options.channels, out, frameCount);
+
+        bool musicFinished = UpdateMusicState();
+        EnforceMemoryBudget();
+        UpdateStats();
+        return musicFinished;
+    }
+
+    void SoftwareAudio::MixVoices(uint32_t frameCount)
+    {
+        float* bus[MixerVoice::kMaxChannels] = {};
+        for (uint32_t c = 0; c < m_Options.channels; ++c)
+        {
+            m_Bus[c].assign(frameCount, 0.0f);
+            bus[c] = m_Bus[c].data();
+        }
+
+        // Only the most important voices are mixed, ties going to the loudest. The rest keep their place in
+        // silence and are heard again once a slot frees up
+        m_Ranking.clear();
+        for (const auto& voice : m_Voices)
+        {
+            if (!voice->IsPaused())
+            {
+                m_Ranking.push_back(voice.get());
+            }
+        }
+
+        const size_t mixed = std::min<size_t>(m_Ranking.size(), m_MaxRealVoices);
+        if (mixed < m_Ranking.size())
+        {
+            std::nth_element(m_Ranking.begin(), m_Ranking.begin() + mixed, m_Ranking.end(),
+                [](const MixerVoice* a, const MixerVoice* b)
+                {
+                    if (a->GetPriority() != b->GetPriority()) return a->GetPriority() > b->GetPriority();
+                    return a->GetEffectiveGain() > b->GetEffectiveGain();
+                });
+        }
+
+        uint32_t inUse = 0;
+        for (size_t i = 0; i < m_Ranking.size(); ++i)
+        {
+            MixerVoice* voice = m_Ranking[i];
+            const bool audible = i < mixed && voice->GetEffectiveGain() > kInaudibleGain;
+            voice->Mix(*m_Kernels, bus, m_Options.channels, m_Options.sampleRate, frameCount, m_Options.resampler, audible);
+            inUse += audible ? 1 : 0;
+        }
+
+        m_Voices.erase(std::remove_if(m_Voices.begin(), m_Voices.end(),
+            [](const std::unique_ptr<MixerVoice>& voice) { return voice->IsFinished(); }), m_Voices.end());
+
+        m_VoiceStats.inUse = inUse;
+        m_VoiceStats.peakInUse = std::max(m_VoiceStats.peakInUse, inUse);
+
+        // Music is always mixed, outside the voice cap
+        if (m_Music && !m_Music->IsPaused())
+        {
+            m_Music->Mix(*m_Kernels, bus, m_Options.channels, m_Options.sampleRate, frameCount, m_Options.resampler, true);
+        }
+        if (m_Crossfade.outgoing && !m_Crossfade.outgoing->IsPaused() &&
+            !m_Crossfade.outgoing->Mix(*m_Kernels, bus, m_Options.channels, m_Options.sampleRate, frameCount, m_Options.resampler, true))
+        {
+            // The outgoing track ran out before the fade ended
+            m_Crossfade.outgoing.reset();
+        }
+    }
+
+    void SoftwareAudio::UpdateStats()
+    {
+        uint32_t unpaused = 0;
+        uint32_t progressive = 0;
+        for (const auto& voice : m_Voices)
+        {
+            unpaused += voice->IsPaused() ? 0 : 1;
+            progressive += voice->IsProgressive() ? 1 : 0;
+        }
+
+        // Voices within the cap are the real ones, paused voices aren't mixed and count as virtual
+        const uint32_t voices = static_cast<uint32_t>(m_Voices.size());
+        const uint32_t real = std::min(unpaused, m_MaxRealVoices);
+        const uint32_t musicTracks = (m_Music ? 1 : 0) + (m_Crossfade.outgoing ? 1 : 0);
+        m_Stats.SetVoiceCounts(real, voices - real, voices - unpaused, progressive, musicTracks);
+        m_Stats.SetBufferCache(m_SoundCache.GetStats());
+
+        m_Stats.RecordTick();
+        m_Stats.UpdateDump();
+    }
+
+    uint32_t SoftwareAudio::GetBlockFrames() const
+    {
+        return std::max<uint32_t>(static_cast<uint32_t>(m_Options.sampleRate * m_TickInterval.count() / 1000000), 1);
+    }
+
+    bool SoftwareAudio::UpdateMusicState()
+    {
+        if (!m_MusicActive) return false;
+
+        // A track still loading hasn't started yet, let alone finished
+        if (m_PendingMusic.audioKey != 0) return false;
+
+        // Paused music is still playing as far as the queue is concerned
+        const bool playing = m_Music && !m_Music->IsFinished() && !m_MusicStopped;
+        if (playing) return false;
+
+        // A track that ends by itself moves on to the queue, a stopped one doesn't
+        if (!m_MusicStopped && PlayQueuedMusic()) return false;
+
+        m_MusicActive = false;
+        return true;
+    }
+
+    bool SoftwareAudio::PlayQueuedMusic()
+    {
+        while (!m_MusicQueue.empty())
+        {
+            QueuedMusic next = std::move(m_MusicQueue.front());
+            m_MusicQueue.pop_front();
+            if (StartMusic(next.filepath.c_str(), std::move(next.audio), nullptr))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool SoftwareAudio::QueueMusic(const char* filepath)
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        if (!m_Initialized) return false;
+
+        QueuedMusic queued;
+        queued.filepath = filepath;
+
+        // Decode the whole track on a worker now, it is handed over ready when the current one ends
+        if (!m_StreamMusic)
+        {
+            uint32_t audioKey = GenerateAudioKey(filepath);
+            auto it = m_Sounds.find(audioKey);
+            if (it != m_Sounds.end())
+            {
+                queued.audio = it->second;
+            }
+            else
+            {
+                SubmitLoad(filepath, audioKey, EAudioCategory::kMusic);
+            }
+        }
+
+        m_MusicQueue.push_back(std::move(queued));
+
+        // Nothing to follow, start right away
+        if (!m_MusicActive)
+        {
+            return PlayQueuedMusic();
+        }
+        return true;
+    }
+
+    void SoftwareAudio::ClearMusicQueue()
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        m_MusicQueue.clear();
+    }
+
+    void SoftwareAudio::StopCurrentMusic()
+    {
+        // Replacing or freeing the track isn't the music finishing
+        m_MusicActive = false;
+
+        // Nothing of a crossfade survives a hard stop
+        m_Crossfade.outgoing.reset();
+        m_Crossfade.active = false;
+
+        // A cached track stays resident, the voice only held a reference. A track still loading is
+        // cached when it lands but not started
+        m_Music.reset();
+        m_PendingMusic = PendingMusic();
+        m_CurrentMusicPathKey = 0;
+    }
+
+    std::unique_ptr<AudioDecoder> SoftwareAudio::OpenMusicDecoder(const char* filepath)
+    {
+        // The mixer decodes the rest a block at a time while it plays
+        EncodedAudio file;
+        auto decoder = std::make_unique<AudioDecoder>();
+        if (!m_Assets.Open(filepath, EAudioCategory::kMusic, file) || !decoder->Open(file, GetMusicType(filepath), filepath) ||
+            !IsPlayableChannelCount(decoder->GetChannels(), filepath))
+        {
+            return nullptr;
+        }
+        return decoder;
+    }
+
+    void SoftwareAudio::StartPendingMusic(std::shared_ptr<const DecodedAudio> audio)
+    {
+        const PendingMusic pending = m_PendingMusic;
+        m_PendingMusic = PendingMusic();
+
+        // A failed load ends the track like it played out, the queue moves on in UpdateMusicState
+        if (!audio) return;
+
+        auto music = std::make_unique<MixerVoice>(pending.audioKey, std::move(audio));
+        music->SetGain(m_MusicFading ? m_FadeStartVolume : m_MusicVolume);
+        music->SetLooping(pending.looping);
+        music->SetMuted(pending.muted);
+        music->SetPaused(pending.held);
+        m_Music = std::move(music);
+    }
+
+    bool SoftwareAudio::PlayMusic(const char* filepath)
+    {
+        // Parse the header before taking the lock, the mixer never waits on the file
+        std::unique_ptr<AudioDecoder> decoder;
+        if (m_StreamMusic && !(decoder = OpenMusicDecoder(filepath)))
+        {
+            return false;
+        }
+
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        if (!m_Initialized) return false;
+
+        return StartMusic(filepath, nullptr, std::move(decoder));
+    }
+
+    bool SoftwareAudio::StartMusic(const char* filepath, std::shared_ptr<const DecodedAudio> audio, std::unique_ptr<AudioDecoder> decoder)
+    {
+        uint32_t audioKey = GenerateAudioKey(filepath);
+
+        // Stop current music if playing
+        StopCurrentMusic();
+
+        if (audio)
+        {
+            m_Music = std::make_unique<MixerVoice>(audioKey, std::move(audio));
+            m_Music->SetGain(m_MusicVolume);
+        }
+        else if (decoder || m_StreamMusic)
+        {
+            // A track moving on from the queue is opened here
+            if (!decoder && !(decoder = OpenMusicDecoder(filepath)))
+            {
+                return false;
+            }
+            m_Music = std::make_unique<MixerVoice>(audioKey, std::move(decoder));
+            m_Music->SetGain(m_MusicVolume);
+        }
+        else if ((audio = FindSoundForPlay(audioKey)))
+        {
+            m_Music = std::make_unique<MixerVoice>(audioKey, std::move(audio));
+            m_Music->SetGain(m_MusicVolume);
+        }
+        else
+        {
+            // Decoded on a worker so the mix doesn't wait on it, the track starts in the block its load lands
+            SubmitLoad(filepath, audioKey, EAudioCategory::kMusic);
+            m_PendingMusic.audioKey = audioKey;
+        }
+
+        m_CurrentMusicPathKey = audioKey;
+        m_MusicPaused = false;
+        m_MusicFading = false;
+        m_MusicActive = true;
+        m_MusicStopped = false;
+        return true;
+    }
+
+    bool SoftwareAudio::PlayMusic(SoundId music)
+    {
+        // Music start is rare and the decoder needs the path anyway
+        return PlayMusic(std::string(music.GetPath()).c_str());
+    }
+
+    bool SoftwareAudio::PlaySoundEffect(const char* filepath)
+    {
+        if (!m_Initialized) return false;
+
+        return EnqueueSoundCommand(AudioCommand::EType::kPlaySound, filepath, HashAudioPath(filepath), 0);
+    }
+
+    bool SoftwareAudio::PlaySoundEffect(SoundId sound)
+    {
+        if (!m_Initialized) return false;
+
+        return EnqueueSoundCommand(AudioCommand::EType::kPlaySound, sound.GetPath(), sound.GetHash(), 0);
+    }
+
+    bool SoftwareAudio::PlaySoundEffectWhenReady(const char* filepath)
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        if (!m_Initialized) return false;
+        ProcessCommands();
+
+        return PlayWhenReady(filepath, GenerateAudioKey(filepath));
+    }
+
+    bool SoftwareAudio::PlayWhenReady(const char* filepath, uint32_t audioKey)
+    {
+        if (std::shared_ptr<const DecodedAudio> audio = FindSoundForPlay(audioKey))
+        {
+            StartVoice(std::make_unique<MixerVoice>(audioKey, std::move(audio)));
+            return true;
+        }
+
+        if (m_ProgressiveSounds.count(audioKey) != 0 && PlayProgressive(filepath, audioKey))
+        {
+            return true;
+        }
+
+        LoadAudioAsync(filepath);
+
+        auto pending = m_PendingLoads.find(audioKey);
+        if (pending == m_PendingLoads.end())
+        {
+            return false;
+        }
+
+        ++pending->second.playRequests;
+        return true;
+    }
+
+    bool SoftwareAudio::PlayProgressive(const char* filepath, uint32_t audioKey)
+    {
+        // A plain load already in flight finishes first, the sound plays once it's done
+        auto pending = m_PendingLoads.find(audioKey);
+        if (pending != m_PendingLoads.end() && !pending->second.progressive)
+        {
+            return false;
+        }
+
+        std::shared_ptr<ProgressiveAudio> audio;
+        if (pending != m_PendingLoads.end())
+        {
+            audio = pending->second.progressive;
+        }
+        else
+        {
+            audio = std::make_shared<ProgressiveAudio>();
+            SubmitLoad(filepath, audioKey, EAudioCategory::kSound, audio);
+        }
+
+        // Unlike OpenAL sources, progressive voices take part in the voice cap like any other
+        StartVoice(std::make_unique<MixerVoice>(audioKey, std::move(audio)));
+        return true;
+    }
+
+    void SoftwareAudio::StartVoice(std::unique_ptr<MixerVoice> voice)
+    {
+        auto priority = m_SoundPriorities.find(voice->GetAudioKey());
+        voice->SetPriority(priority != m_SoundPriorities.end() ? priority->second : 0);
+
+        // Counted as exhausted when it starts without a mixing slot, it may still take one from a quieter voice
+        ++m_VoiceStats.leases;
+        if (m_VoiceStats.inUse >= m_MaxRealVoices)
+        {
+            ++m_VoiceStats.exhausted;
+        }
+        m_Voices.push_back(std::move(voice));
+    }
+
+    IAudio::AudioLoadHandle SoftwareAudio::LoadAudioAsync(const char* filepath)
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        uint32_t audioKey = GenerateAudioKey(filepath);
+
+        // Already resident or already decoding
+        auto pending = m_PendingLoads.find(audioKey);
+        if (pending != m_PendingLoads.end())
+        {
+            return pending->second.future;
+        }
+
+        if (!m_Initialized || m_Sounds.find(audioKey) != m_Sounds.end())
+        {
+            std::promise<bool> done;
+            done.set_value(m_Initialized);
+            return done.get_future().share();
+        }
+
+        SubmitLoad(filepath, audioKey, EAudioCategory::kSound);
+        return m_PendingLoads[audioKey].future;
+    }
+
+    void SoftwareAudio::SubmitLoad(const char* filepath, uint32_t audioKey, EAudioCategory category,
+        std::shared_ptr<ProgressiveAudio> progressive)
+    {
+        // A load already in flight serves this request too
+        if (m_PendingLoads.count(audioKey) != 0) return;
+
+        PendingLoad& load = m_PendingLoads[audioKey];
+        load.future = load.promise.get_future().share();
+        load.progressive = progressive;
+        load.category = category;
+        m_DecodePool.Submit(audioKey, filepath, GetMusicType(filepath), category, std::move(progressive));
+    }
+
+    void SoftwareAudio::ProcessCompletedLoads()
+    {
+        if (!m_DecodePool.CollectResults(m_CompletedLoads)) return;
+
+        for (AudioDecodePool::Result& result : m_CompletedLoads)
+        {
+            auto pending = m_PendingLoads.find(result.audioKey);
+            if (pending == m_PendingLoads.end()) continue;
+
+            // Drop the result if the key was freed while it was decoding
+            bool success = result.success && m_AudioKeys.Contains(result.audioKey);
+            std::shared_ptr<const DecodedAudio> audio;
+            if (success)
+            {
+                auto it = m_Sounds.find(result.audioKey);
+                audio = it != m_Sounds.end() ? it->second : nullptr;
+                if (!audio)
+                {
+                    if (IsPlayableChannelCount(result.audio.channels, GetFilePath(result.audioKey).c_str()))
+                    {
+                        audio = std::make_shared<DecodedAudio>(std::move(result.audio));
+                        CacheSound(result.audioKey, audio, pending->second.category);
+                    }
+                    else
+                    {
+                        success = false;
+                    }
+                }
+
+                // Start the sounds that were requested while the file was decoding
+                for (int i = 0; success && i < pending->second.playRequests; ++i)
+                {
+                    StartVoice(std::make_unique<MixerVoice>(result.audioKey, audio));
+                }
+            }
+
+            // Queued tracks hold on to their audio so the cache can't drop it before they start
+            for (QueuedMusic& queued : m_MusicQueue)
+            {
+                if (success && !queued.audio && FindAudioKey(queued.filepath) == result.audioKey)
+                {
+                    queued.audio = audio;
+                }
+            }
+
+            // And the music track waiting on it
+            if (result.audioKey == m_PendingMusic.audioKey)
+            {
+                StartPendingMusic(success ? std::move(audio) : nullptr);
+            }
+
+            pending->second.promise.set_value(success);
+            m_PendingLoads.erase(pending);
+        }
+
+        m_CompletedLoads.clear();
+    }
+
+    std::shared_ptr<const DecodedAudio> SoftwareAudio::FindSoundForPlay(uint32_t audioKey)
+    {
+        auto it = m_Sounds.find(audioKey);
+        if (it == m_Sounds.end())
+        {
+            m_SoundCache.RecordMiss();
+            return nullptr;
+        }
+
+        m_SoundCache.Touch(audioKey);
+        return it->second;
+    }
+
+    void SoftwareAudio::CacheSound(uint32_t audioKey, std::shared_ptr<const DecodedAudio> audio, EAudioCategory category)
+    {
+        const uint64_t bytes = audio->GetSampleCount() * sizeof(int16_t);
+        m_Sounds[audioKey] = std::move(audio);
+        m_SoundCache.Insert(audioKey, bytes, category);
+    }
+
+    void SoftwareAudio::ReleaseSound(uint32_t audioKey)
+    {
+        auto it = m_Sounds.find(audioKey);
+        if (it == m_Sounds.end()) return;
+
+        // Voices and music still playing it hold their own reference and finish normally
+        m_Sounds.erase(it);
+        m_SoundCache.Remove(audioKey);
+    }
+
+    void SoftwareAudio::EnforceMemoryBudget()
+    {
+        if (!m_SoundCache.IsOverBudget()) return;
+
+        // Sounds a voice still reads stay, the budget catches up once they finish
+        m_SoundCache.CollectEvictions([this](uint32_t audioKey)
+            {
+                return m_Sounds.at(audioKey).use_count() > 1;
+            }, m_Evictions);
+
+        // The key stays registered, the next play reloads the file
+        for (uint32_t audioKey : m_Evictions)
+        {
+            m_Sounds.erase(audioKey);
+            m_SoundCache.Evict(audioKey);
+        }
+        m_Evictions.clear();
+    }
+
+    void SoftwareAudio::Update()
+    {
+        // Nothing to do, the mixer thread or RenderAudio services loads, voices, fades and music every block
+    }
+
+    void SoftwareAudio::SetAudioTickInterval(int ms)
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+
+        // Also the block length, so a real-time sink buffers kBufferCount ticks of audio
+        m_TickInterval = std::chrono::milliseconds(std::max(ms, 1));
+    }
+
+    void SoftwareAudio::SetAudioMemoryBudget(uint64_t bytes)
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        m_SoundCache.SetBudget(bytes);
+    }
+
+    void SoftwareAudio::SetAudioMemoryBudget(EAudioCategory category, uint64_t bytes)
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        m_SoundCache.SetBudget(category, bytes);
+    }
+
+    bool SoftwareAudio::MountSoundBank(const char* filepath)
+    {
+        return m_Assets.MountSoundBank(filepath);
+    }
+
+    bool SoftwareAudio::LoadCompressedAudio(const char* filepath)
+    {
+        return m_Assets.LoadCompressedAudio(filepath);
+    }
+
+    void SoftwareAudio::FreeCompressedAudio(const char* filepath)
+    {
+        m_Assets.FreeCompressedAudio(filepath);
+    }
+
+    bool SoftwareAudio::EnableDecodedAudioCache(const char* directory, uint64_t maxBytes)
+    {
+        return m_Assets.EnableDecodedAudioCache(directory, maxBytes);
+    }
+
+    void SoftwareAudio::SetSoundPriority(const char* filepath, int priority)
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        ProcessCommands();
+        m_SoundPriorities[GenerateAudioKey(filepath)] = priority;
+    }
+
+    void SoftwareAudio::SetSoundProgressive(const char* filepath, bool progressive)
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        ProcessCommands();
+        if (progressive)
+        {
+            m_ProgressiveSounds.insert(GenerateAudioKey(filepath));
+        }
+        else
+        {
+            m_ProgressiveSounds.erase(GenerateAudioKey(filepath));
+        }
+    }
+
+    void SoftwareAudio::SetMaxRealVoices(int count)
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        ProcessCommands();
+
+        // Any number works, the cap only bounds the mixing cost per block
+        m_MaxRealVoices = static_cast<uint32_t>(std::max(count, 0));
+        m_VoiceStats.capacity = m_MaxRealVoices;
+    }
+
+    void SoftwareAudio::OperateCurrentMusic(EAudioAction action)
+    {
+        // Applied right away like the other music calls, so it stays in order with them
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        if (!m_Initialized) return;
+
+        ApplyMusicAction(action);
+    }
+
+    void SoftwareAudio::ApplyMusicAction(EAudioAction action)
+    {
+        if (!m_Music)
+        {
+            ApplyPendingMusicAction(action);
+            return;
+        }
+
+        // A track fading out under a crossfade has nothing to come back to, stopping or pausing ends it
+        if (action == EAudioAction::kStop || action == EAudioAction::kPause)
+        {
+            m_Crossfade.outgoing.reset();
+        }
+
+        switch (action)
+        {
+        case EAudioAction::kStop:
+            // Like a stopped OpenAL source, resuming starts over
+            m_Music->Rewind();
+            m_Music->SetPaused(true);
+            m_MusicPaused = false;
+            m_MusicStopped = true;
+            break;
+        case EAudioAction::kPause:
+            m_Music->SetPaused(true);
+            m_MusicPaused = true;
+            break;
+        case EAudioAction::kResume:
+            if (m_MusicStopped || m_Music->IsFinished())
+            {
+                m_Music->Rewind();
+            }
+            m_Music->SetPaused(false);
+            m_MusicPaused = false;
+            m_MusicActive = true;
+            m_MusicStopped = false;
+            break;
+        case EAudioAction::kReplay:
+            m_Music->Rewind();
+            m_Music->SetPaused(false);
+            m_MusicPaused = false;
+            m_MusicActive = true;
+            m_MusicStopped = false;
+            break;
+        case EAudioAction::kLoop:
+            m_Music->SetLooping(true);
+            break;
+        case EAudioAction::kStopLoop:
+            m_Music->SetLooping(false);
+            break;
+        case EAudioAction::kMute:
+            m_Music->SetMuted(true);
+            break;
+        case EAudioAction::kUnmute:
+            m_Music->SetMuted(false);
+            break;
+        case EAudioAction::kVolumeUp:
+            m_MusicVolume = std::min(m_MusicVolume + 0.1f, 1.0f);
+            m_Music->SetGain(m_MusicVolume);
+            break;
+        case EAudioAction::kVolumeDown:
+            m_MusicVolume = std::max(m_MusicVolume - 0.1f, 0.0f);
+            m_Music->SetGain(m_MusicVolume);
+            break;
+        case EAudioAction::kRewind:
+            // Back to the start and held there until resumed, the track is still current
+            m_Music->Rewind();
+            m_Music->SetPaused(true);
+            break;
+        default:
+            printf("Invalid audio action\n");
+            break;
+        }
+    }
+
+    void SoftwareAudio::ApplyPendingMusicAction(EAudioAction action)
+    {
+        if (m_PendingMusic.audioKey == 0) return;
+
+        // Same outcome as on a track that had just started, once the load lands
+        switch (action)
+        {
+        case EAudioAction::kStop:
+            m_PendingMusic.held = true;
+            m_MusicPaused = false;
+            m_MusicStopped = true;
+            break;
+        case EAudioAction::kPause:
+            m_PendingMusic.held = true;
+            m_MusicPaused = true;
+            break;
+        case EAudioAction::kResume:
+        case EAudioAction::kReplay:
+            m_PendingMusic.held = false;
+            m_MusicPaused = false;
+            m_MusicActive = true;
+            m_MusicStopped = false;
+            break;
+        case EAudioAction::kLoop:
+        case EAudioAction::kStopLoop:
+            m_PendingMusic.looping = action == EAudioAction::kLoop;
+            break;
+        case EAudioAction::kMute:
+        case EAudioAction::kUnmute:
+            m_PendingMusic.muted = action == EAudioAction::kMute;
+            break;
+        case EAudioAction::kVolumeUp:
+            m_MusicVolume = std::min(m_MusicVolume + 0.1f, 1.0f);
+            break;
+        case EAudioAction::kVolumeDown:
+            m_MusicVolume = std::max(m_MusicVolume - 0.1f, 0.0f);
+            break;
+        case EAudioAction::kRewind:
+            m_PendingMusic.held = true;
+            break;
+        default:
+            printf("Invalid audio action\n");
+            break;
+        }
+    }
+
+    void SoftwareAudio::OperateCurrentSounds(EAudioAction action)
+    {
+        if (!m_Initialized) return;
+
+        AudioCommand command;
+        command.type = AudioCommand::EType::kOperateSounds;
+        command.action = action;
+        command.hash = 0;
+        command.pathLength = 0;
+        EnqueueCommand(command);
+    }
+
+    void SoftwareAudio::ApplySoundsAction(EAudioAction action)
+    {
+        if (action == EAudioAction::kStop)
+        {
+            m_Voices.clear();
+            return;
+        }
+
+        // Operate on every sound effect voice, mixed or not
+        for (const auto& voice : m_Voices)
+        {
+            switch (action)
+            {
+            case EAudioAction::kPause:
+                voice->SetPaused(true);
+                break;
+            case EAudioAction::kResume:
+                voice->SetPaused(false);
+                break;
+            case EAudioAction::kReplay:
+                voice->Rewind();
+                voice->SetPaused(false);
+                break;
+            case EAudioAction::kRewind:
+                voice->Rewind();
+                voice->SetPaused(true);
+                break;
+            case EAudioAction::kMute:
+                voice->SetMuted(true);
+                break;
+            case EAudioAction::kUnmute:
+                voice->SetMuted(false);
+                break;
+            case EAudioAction::kLoop:
+                voice->SetLooping(true);
+                break;
+            case EAudioAction::kStopLoop:
+                voice->SetLooping(false);
+                break;
+            case EAudioAction::kVolumeUp:
+                voice->SetGain(std::min(voice->GetGain() + 0.1f, 1.0f));
+                break;
+            case EAudioAction::kVolumeDown:
+                voice->SetGain(std::max(voice->GetGain() - 0.1f, 0.0f));
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    void SoftwareAudio::SetMusicPosition(double position_x, double /*position_y*/)
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+
+        // There is no listener, x pans the track between -1 (left) and 1 (right)
+        if (m_Music)
+        {
+            m_Music->SetPan(static_cast<float>(position_x));
+        }
+    }
+
+    void SoftwareAudio::FadeInMusic(const char* filepath, int loops, int ms)
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        if (PlayMusic(filepath))
+        {
+            m_FadeStartVolume = 0.0f;
+            m_FadeTargetVolume = m_MusicVolume;
+            m_FadeTimeRemaining = static_cast<float>(ms) / 1000.0f;
+            m_FadeDuration = m_FadeTimeRemaining;
+            m_MusicFading = true;
+
+            // A track still loading starts at the fade's first gain
+            if (m_Music)
+            {
+                m_Music->SetGain(0.0f);
+            }
+            ApplyMusicAction(loops == -1 ? EAudioAction::kLoop : EAudioAction::kStopLoop);
+        }
+    }
+
+    void SoftwareAudio::FadeOutMusic(int ms)
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        if (m_Music)
+        {
+            // The fade out takes over the current track's gain, the outgoing one goes now
+            m_Crossfade.outgoing.reset();
+            m_Crossfade.active = false;
+
+            m_FadeStartVolume = m_MusicVolume;
+            m_FadeTargetVolume = 0.0f;
+            m_FadeTimeRemaining = static_cast<float>(ms) / 1000.0f;
+            m_FadeDuration = m_FadeTimeRemaining;
+            m_MusicFading = true;
+        }
+    }
+
+    void SoftwareAudio::UpdateFading(float deltaSeconds)
+    {
+        if (!m_MusicFading || !m_Music) return;
+
+        m_FadeTimeRemaining -= deltaSeconds;
+        if (m_FadeTimeRemaining <= 0.0f)
+        {
+            m_MusicFading = false;
+            m_Music->SetGain(m_FadeTargetVolume);
+
+            // The stopped music is reported to the finished callback by UpdateMusicState
+            if (m_FadeTargetVolume == 0.0f)
+            {
+                ApplyMusicAction(EAudioAction::kStop);
+            }
+        }
+        else
+        {
+            float t = 1.0f - (m_FadeTimeRemaining / m_FadeDuration);
+            float currentVolume = m_FadeStartVolume + (m_FadeTargetVolume - m_FadeStartVolume) * t;
+            m_Music->SetGain(currentVolume);
+        }
+    }
+
+    bool SoftwareAudio::CrossfadeMusic(const char* filepath, int loops, int ms)
+    {
+        // The new track is always streamed, its header is parsed before taking the lock and its first
+        // block decodes in the next mix
+        std::unique_ptr<AudioDecoder> decoder = OpenMusicDecoder(filepath);
+        if (!decoder)
+        {
+            return false;
+        }
+
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        if (!m_Initialized) return false;
+
+        uint32_t audioKey = GenerateAudioKey(filepath);
+        auto incoming = std::make_unique<MixerVoice>(audioKey, std::move(decoder));
+        incoming->SetLooping(loops == -1);
+        incoming->SetGain(0.0f);
+
+        // A crossfade still running loses its outgoing track, the current one fades from where it is.
+        // A stopped track has nothing left to fade, and one still loading never starts
+        m_Crossfade.outgoing = m_MusicStopped ? nullptr : std::move(m_Music);
+        m_PendingMusic = PendingMusic();
+        m_Crossfade.outgoingGain = m_Crossfade.outgoing ? m_Crossfade.outgoing->GetGain() : 0.0f;
+        m_MusicFading = false;
+
+        // The incoming track is the current music from here on
+        m_Music = std::move(incoming);
+        m_CurrentMusicPathKey = audioKey;
+        m_MusicPaused = false;
+        m_MusicActive = true;
+        m_MusicStopped = false;
+
+        m_Crossfade.duration = static_cast<float>(std::max(ms, 0)) / 1000.0f;
+        m_Crossfade.elapsed = 0.0f;
+        m_Crossfade.active = true;
+        return true;
+    }
+
+    void SoftwareAudio::UpdateCrossfade(float deltaSeconds)
+    {
+        if (!m_Crossfade.active) return;
+
+        m_Crossfade.elapsed += deltaSeconds;
+        float t = m_Crossfade.duration > 0.0f ? std::min(m_Crossfade.elapsed / m_Crossfade.duration, 1.0f) : 1.0f;
+
+        // Equal power: sin^2 + cos^2 = 1 keeps the loudness constant through the overlap
+        const float angle = t * 1.57079632679f;
+        if (m_Music)
+        {
+            m_Music->SetGain(m_MusicVolume * std::sin(angle));
+        }
+        if (m_Crossfade.outgoing)
+        {
+            m_Crossfade.outgoing->SetGain(m_Crossfade.outgoingGain * std::cos(angle));
+        }
+
+        if (t >= 1.0f)
+        {
+            m_Crossfade.outgoing.reset();
+            m_Crossfade.active = false;
+        }
+    }
+
+    void SoftwareAudio::FreeMusicByKey(uint32_t audioKey)
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+
+        // The current track goes with its voice, a cached copy is dropped below
+        if (audioKey == m_CurrentMusicPathKey)
+        {
+            StopCurrentMusic();
+        }
+
+        ReleaseSound(audioKey);
+        m_AudioKeys.Erase(audioKey);
+    }
+
+    void SoftwareAudio::FreeSoundByKey(uint32_t audioKey)
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        ProcessCommands();
+
+        // Voices already playing the sound finish, the PCM goes once the last of them ends
+        ReleaseSound(audioKey);
+        m_AudioKeys.Erase(audioKey);
+    }
+
+    void SoftwareAudio::SetMusicVolume(int volume)
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        if (!m_Initialized) return;
+
+        ApplyMusicVolume(volume);
+    }
+
+    void SoftwareAudio::ApplyMusicVolume(int volume)
+    {
+        // Convert from 0-100 range to 0.0-1.0 range
+        m_MusicVolume = std::max(0.0f, std::min(static_cast<float>(volume) / 100.0f, 1.0f));
+
+        if (m_Music)
+        {
+            m_Music->SetGain(m_MusicVolume);
+        }
+    }
+
+    void SoftwareAudio::SetSoundVolume(const char* filepath, int volume)
+    {
+        if (!m_Initialized) return;
+
+        EnqueueSoundCommand(AudioCommand::EType::kSetSoundVolume, filepath, HashAudioPath(filepath), volume);
+    }
+
+    void SoftwareAudio::SetSoundVolume(SoundId sound, int volume)
+    {
+        if (!m_Initialized) return;
+
+        EnqueueSoundCommand(AudioCommand::EType::kSetSoundVolume, sound.GetPath(), sound.GetHash(), volume);
+    }
+
+    bool SoftwareAudio::EnqueueCommand(const AudioCommand& command)
+    {
+        if (!m_Commands.TryPush(command))
+        {
+            printf("Warning: Audio command queue is full, dropping the command\n");
+            m_Stats.RecordDroppedCommand();
+            return false;
+        }
+        return true;
+    }
+
+    bool SoftwareAudio::EnqueueSoundCommand(AudioCommand::EType type, std::string_view filepath, uint32_t hash, int value)
+    {
+        AudioCommand command;
+        command.type = type;
+        command.action = EAudioAction::kStop;
+        command.value = value;
+        command.hash = hash;
+        if (!command.SetPath(filepath))
+        {
+            printf("Error: Audio path '%.*s' is longer than %d characters\n",
+                static_cast<int>(filepath.size()), filepath.data(), static_cast<int>(AudioCommand::kMaxPathLength));
+            return false;
+        }
+        return EnqueueCommand(command);
+    }
+
+    void SoftwareAudio::ProcessCommands()
+    {
+        // Stop after one ring's worth so producers that never pause can't stall the block
+        AudioCommand command;
+        for (size_t i = 0; i < m_Commands.Capacity() && m_Commands.TryPop(command); ++i)
+        {
+            ApplyCommand(command);
+        }
+    }
+
+    void SoftwareAudio::ApplyCommand(const AudioCommand& command)
+    {
+        switch (command.type)
+        {
+        case AudioCommand::EType::kPlaySound:
+        {
+            // Known sounds are found by the hash the caller took, a first play registers the path
+            uint32_t audioKey = ResolveAudioKey(command.hash, command.GetPath());
+            PlayWhenReady(command.path, audioKey != 0 ? audioKey : GenerateAudioKey(command.GetPath()));
+            break;
+        }
+        case AudioCommand::EType::kSetSoundVolume:
+            SetSoundVolumeByKey(ResolveAudioKey(command.hash, command.GetPath()), command.value);
+            break;
+        case AudioCommand::EType::kOperateSounds:
+            ApplySoundsAction(command.action);
+            break;
+        }
+    }
+
+    void SoftwareAudio::SetSoundVolumeByKey(uint32_t audioKey, int volume)
+    {
+        float normalizedVolume = std::max(0.0f, std::min(static_cast<float>(volume) / 100.0f, 1.0f));
+
+        for (const auto& voice : m_Voices)
+        {
+            if (voice->GetAudioKey() == audioKey) voice->SetGain(normalizedVolume);
+        }
+    }
+
+    int SoftwareAudio::GetMusicVolume()
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        if (m_Music)
+        {
+            return static_cast<int>(m_Music->GetGain() * 100.0f);
+        }
+        return static_cast<int>(m_MusicVolume * 100.0f);
+    }
+
+    int SoftwareAudio::GetSoundVolume(const char* filepath)
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        ProcessCommands();
+        const uint32_t audioKey = FindAudioKey(filepath);
+        for (const auto& voice : m_Voices)
+        {
+            if (voice->GetAudioKey() == audioKey) return static_cast<int>(voice->GetGain() * 100.0f);
+        }
+        return 0;
+    }
+
+    int SoftwareAudio::GetMaxVolume()
+    {
+        return 100; // Gains are 0.0-1.0, we convert to 0-100 range
+    }
+
+    void SoftwareAudio::SetMusicStreaming(bool streaming)
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+
+        // Takes effect from the next PlayMusic call
+        m_StreamMusic = streaming;
+    }
+
+    void SoftwareAudio::SetFinishMusicCallback(void(*music_finished)())
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+
+        // The music is checked after every block and this is called once it stops
+        m_MusicFinishedCallback = music_finished;
+    }
+
+    IAudio::EAudioFormat SoftwareAudio::GetMusicType(const char* filepath)
+    {
+        return AudioAssets::GetFormat(filepath);
+    }
+
+    IAudio::SourcePoolStats SoftwareAudio::GetSourcePoolStats()
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        return m_VoiceStats;
+    }
+
+    IAudio::BufferCacheStats SoftwareAudio::GetBufferCacheStats()
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        return m_SoundCache.GetStats();
+    }
+
+    IAudio::AudioStats SoftwareAudio::GetAudioStats()
+    {
+        // Read straight from the atomics, the mixer thread may be in the middle of a block
+        return m_Stats.Snapshot();
+    }
+
+    void SoftwareAudio::SetAudioStatsDump(const char* filepath, int intervalMs)
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        m_Stats.SetDump(filepath, intervalMs);
+    }
+
+    bool SoftwareAudio::IsMusicPlaying()
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+
+        // A track still loading counts as playing, it starts as soon as it lands
+        if (m_PendingMusic.audioKey != 0) return !m_PendingMusic.held;
+        return m_Music && !m_Music->IsPaused() && !m_Music->IsFinished();
+    }
+
+    bool SoftwareAudio::IsMusicPaused()
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        return (m_Music || m_PendingMusic.audioKey != 0) && m_MusicPaused;
+    }
+
+    bool SoftwareAudio::IsMusicFading()
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_AudioMutex);
+        return m_MusicFading || m_Crossfade.active;
+    }
+}
@@ -0,0 +1,285 @@
+﻿// © 2025 Yanan Liu <yanan.liu0325@gmail.com>
+
+#pragma once
+
+#include "IAudio.h"
+#include "AudioAssets.h"
+#include "AudioBufferCache.h"
+#include "AudioCommand.h"
+#include "AudioDecodePool.h"
+#include "MixerKernels.h"
+#include "MixerSink.h"
+#include "MixerVoice.h"
+#include "../../Utility/MPSCQueue.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace Engine
+{
+    // Audio system mixing every voice itself with the SIMD kernels instead of leaving it to OpenAL.
+    // Each block resamples the voices to the output rate, sums them into a float bus with ramped gains and hands the
+    // bus to a MixerSink: an OpenAL streaming source, a WAV file or nothing. Behaves like OpenALAudio from the outside,
+    // with the same queued calls, background loads, music queue, fades and memory budget
+    class SoftwareAudio : public IAudio
+    {
+    public:
+        // Default constructor
+        explicit SoftwareAudio(const AudioSystemOptions& options);
+
+        // Default destructor
+        virtual ~SoftwareAudio();
+
+        // Initialize the audio system
+        virtual bool Init() override;
+
+        // Music playback functions
+        virtual bool PlayMusic(const char* filepath) override;
+        virtual bool PlayMusic(SoundId music) override;
+        virtual bool QueueMusic(const char* filepath) override;
+        virtual void ClearMusicQueue() override;
+        virtual bool PlaySoundEffect(const char* filepath) override;
+        virtual bool PlaySoundEffect(SoundId sound) override;
+        virtual bool PlaySoundEffectWhenReady(const char* filepath) override;
+        virtual AudioLoadHandle LoadAudioAsync(const char* filepath) override;
+        virtual void Update() override;
+        virtual bool RenderAudio(float* out, uint32_t frameCount) override;
+        virtual void OperateCurrentMusic(EAudioAction action) override;
+        virtual void OperateCurrentSounds(EAudioAction action) override;
+        virtual void FadeInMusic(const char* filepath, int loops, int ms) override;
+        virtual bool CrossfadeMusic(const char* filepath, int loops, int ms) override;
+        virtual void FadeOutMusic(int ms) override;
+        virtual void FreeMusicByKey(uint32_t audioKey) override;
+        virtual void FreeSoundByKey(uint32_t audioKey) override;
+
+        // Volume control
+        virtual void SetMusicVolume(int volume) override;
+        virtual void SetSoundVolume(const char* filepath, int volume) override;
+        virtual void SetSoundVolume(SoundId sound, int volume) override;
+        virtual int GetMusicVolume() override;
+        virtual int GetSoundVolume(const char* filepath) override;
+        virtual int GetMaxVolume() override;
+
+        // Position and callback
+        virtual void SetMusicPosition(double position_x, double position_y) override;
+        virtual void SetSoundPriority(const char* filepath, int priority) override;
+        virtual void SetSoundProgressive(const char* filepath, bool progressive) override;
+        virtual void SetMaxRealVoices(int count) override;
+        virtual void SetMusicStreaming(bool streaming) override;
+        virtual void SetAudioTickInterval(int ms) override;
+        virtual void SetAudioMemoryBudget(uint64_t bytes) override;
+        virtual void SetAudioMemoryBudget(EAudioCategory category, uint64_t bytes) override;
+        virtual bool MountSoundBank(const char* filepath) override;
+        virtual bool LoadCompressedAudio(const char* filepath) override;
+        virtual void FreeCompressedAudio(const char* filepath) override;
+        virtual bool EnableDecodedAudioCache(const char* directory, uint64_t maxBytes) override;
+        virtual void SetFinishMusicCallback(void(*music_finished)()) override;
+
+        // Status queries
+        virtual EAudioFormat GetMusicType(const char* filepath) override;
+        virtual bool IsMusicPlaying() override;
+        virtual bool IsMusicPaused() override;
+        virtual bool IsMusicFading() override;
+        virtual SourcePoolStats GetSourcePoolStats() override;
+        virtual BufferCacheStats GetBufferCacheStats() override;
+        virtual AudioStats GetAudioStats() override;
+        virtual void SetAudioStatsDump(const char* filepath, int intervalMs) override;
+
+    private:
+        // Mixer thread loop, renders a block whenever a real-time sink has room for one
+        void MixerThreadMain();
+
+        // Service everything, then mix frameCount frames into out as interleaved floats.
+        // Returns true when the music stopped in this block
+        bool RenderBlock(float* out, uint32_t frameCount);
+
+        // Sum every voice and the music into the bus
+        void MixVoices(uint32_t frameCount);
+
+        // Sample the voice and cache gauges after a block, and write the stats dump when it is due
+        void UpdateStats();
+
+        // Frames in one mixer tick
+        uint32_t GetBlockFrames() const;
+
+        // Queue a command for the mixer thread, never blocks. Returns false if the ring is full
+        bool EnqueueCommand(const AudioCommand& command);
+        bool EnqueueSoundCommand(AudioCommand::EType type, std::string_view filepath, uint32_t hash, int value);
+
+        // Apply the queued commands in one batch, run with m_AudioMutex held. Every block runs it, and so does every
+        // direct call that reads or changes sounds, so that call sees the sound calls queued before it
+        void ProcessCommands();
+        void ApplyCommand(const AudioCommand& command);
+
+        // Queue a background load of a file not loading yet, category picks the budget it is cached under
+        void SubmitLoad(const char* filepath, uint32_t audioKey, EAudioCategory category,
+            std::shared_ptr<ProgressiveAudio> progressive = nullptr);
+
+        // Keep the decoded sounds that finished loading and start the plays waiting on them
+        void ProcessCompletedLoads();
+
+        // Play a resident sound right away, otherwise load it in the background and play it when it lands
+        bool PlayWhenReady(const char* filepath, uint32_t audioKey);
+
+        // Start a voice on a decode that is still running, false when the sound has to wait for a full load
+        bool PlayProgressive(const char* filepath, uint32_t audioKey);
+
+        // Add a sound effect voice. Voices beyond the mixed cap keep advancing in silence
+        void StartVoice(std::unique_ptr<MixerVoice> voice);
+
+        // Resident sound for a play, counted as a cache hit or miss. Null if it has to be loaded
+        std::shared_ptr<const DecodedAudio> FindSoundForPlay(uint32_t audioKey);
+        void CacheSound(uint32_t audioKey, std::shared_ptr<const DecodedAudio> audio, EAudioCategory category);
+        void ReleaseSound(uint32_t audioKey);
+
+        // Evict least recently used sounds no voice is playing until the cache fits its budgets
+        void EnforceMemoryBudget();
+
+        // Open the decoder a music track streams from, only the header is parsed here.
+        // Touches nothing but the assets, so it runs before m_AudioMutex is taken
+        std::unique_ptr<AudioDecoder> OpenMusicDecoder(const char* filepath);
+
+        // Make the track waiting on its load the current music, or drop it if the load failed
+        void StartPendingMusic(std::shared_ptr<const DecodedAudio> audio);
+
+        // Work behind PlayMusic, run with m_AudioMutex held. The track plays from audio when it is already
+        // decoded, or streams from decoder when it was opened before the lock
+        bool StartMusic(const char* filepath, std::shared_ptr<const DecodedAudio> audio, std::unique_ptr<AudioDecoder> decoder);
+
+        // Work behind the calls of the same name, run with m_AudioMutex held
+        void ApplyMusicAction(EAudioAction action);
+        void ApplyPendingMusicAction(EAudioAction action);
+        void ApplySoundsAction(EAudioAction action);
+        void ApplyMusicVolume(int volume);
+        void SetSoundVolumeByKey(uint32_t audioKey, int volume);
+
+        void UpdateFading(float deltaSeconds);
+        void UpdateCrossfade(float deltaSeconds);
+        void StopCurrentMusic();
+
+        // Follow the music into the queue once it ends by itself. Returns true when the music stopped
+        bool UpdateMusicState();
+        bool PlayQueuedMusic();
+
+    private:
+        AudioSystemOptions m_Options;
+        const MixerKernels* m_Kernels;
+
+        // Health counters, before everything that records into them: the sink and m_Assets
+        AudioStatsRecorder m_Stats;
+
+        std::unique_ptr<MixerSink> m_Sink;
+
+        // One float array per output channel, and the interleaved block handed to the sink
+        std::vector<float> m_Bus[MixerVoice::kMaxChannels];
+        std::vector<float> m_Output;
+
+        // Sound effect voices, the first m_MaxRealVoices by priority and gain are mixed
+        std::vector<std::unique_ptr<MixerVoice>> m_Voices;
+        std::vector<MixerVoice*> m_Ranking;
+        uint32_t m_MaxRealVoices;
+        SourcePoolStats m_VoiceStats;
+
+        // Priority set per sound, 0 when not set
+        std::unordered_map<uint32_t, int> m_SoundPriorities;
+
+        // Sounds played while they decode
+        std::unordered_set<uint32_t> m_ProgressiveSounds;
+
+        // Commands from any thread, applied at the start of every block
+        MPSCQueue<AudioCommand> m_Commands;
+
+        // Sound banks, resident compressed files and the decoded PCM cache. Decode workers use it
+        AudioAssets m_Assets;
+
+        // Decoded sounds by audio path key, and their recency and byte budgets
+        std::unordered_map<uint32_t, std::shared_ptr<const DecodedAudio>> m_Sounds;
+        AudioBufferCache m_SoundCache;
+        std::vector<uint32_t> m_Evictions;
+
+        // A background load and the plays requested before it finished
+        struct PendingLoad
+        {
+            std::promise<bool> promise;
+            AudioLoadHandle future;
+            int playRequests = 0;
+            std::shared_ptr<ProgressiveAudio> progressive;    // Set for progressive loads
+            EAudioCategory category = EAudioCategory::kSound;
+        };
+
+        AudioDecodePool m_DecodePool;
+        std::unordered_map<uint32_t, PendingLoad> m_PendingLoads;
+        std::vector<AudioDecodePool::Result> m_CompletedLoads;
+
+        // Current music, and the outgoing track while a crossfade runs
+        std::unique_ptr<MixerVoice> m_Music;
+        uint32_t m_CurrentMusicPathKey;
+
+        // Also read by PlayMusic before it takes the lock
+        std::atomic<bool> m_StreamMusic;
+
+        // Music that isn't streamed is decoded on a worker and becomes the current track once it lands.
+        // Music calls made while it loads are kept here and applied when the voice starts
+        struct PendingMusic
+        {
+            uint32_t audioKey = 0;      // 0 when no track is loading
+            bool looping = false;
+            bool muted = false;
+            bool held = false;          // Starts paused
+        };
+        PendingMusic m_PendingMusic;
+
+        struct MusicCrossfade
+        {
+            std::unique_ptr<MixerVoice> outgoing;
+            float outgoingGain = 0.0f;      // Gain the outgoing track had when the fade began
+            float duration = 0.0f;
+            float elapsed = 0.0f;
+            bool active = false;
+        };
+        MusicCrossfade m_Crossfade;
+
+        // Audio state
+        bool m_Initialized;
+        float m_MusicVolume;
+        bool m_MusicPaused;
+        bool m_MusicFading;
+        bool m_MusicActive;     // Started and not reported as finished yet
+        bool m_MusicStopped;    // Stopped on purpose, the queue doesn't move on
+
+        // Tracks to play after the current music. Without streaming QueueMusic has the decode pool decode
+        // them right away, so moving on to one doesn't wait on its load
+        struct QueuedMusic
+        {
+            std::string filepath;
+            std::shared_ptr<const DecodedAudio> audio;    // Set once its load lands
+        };
+        std::deque<QueuedMusic> m_MusicQueue;
+
+        // Called on the mixer thread, without m_AudioMutex held
+        void(*m_MusicFinishedCallback)();
+
+        // Fading state
+        float m_FadeStartVolume;
+        float m_FadeTargetVolume;
+        float m_FadeTimeRemaining;
+        float m_FadeDuration;
+
+        // Thread feeding a real-time sink. The WAV and null sinks have none, RenderAudio drives the mix.
+        // Queued calls go through m_Commands, the remaining public calls and each block hold m_AudioMutex
+        std::thread m_MixerThread;
+        std::recursive_mutex m_AudioMutex;
+        std::condition_variable_any m_MixerWakeup;
+        bool m_MixerThreadExit;
+        std::chrono::microseconds m_TickInterval;
+    };
+}
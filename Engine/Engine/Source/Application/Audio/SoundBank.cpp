@@ -0,0 +1,130 @@
+﻿// © 2025 Yanan Liu <yanan.liu0325@gmail.com>
+
+#include "SoundBank.h"
+#include "SoundId.h"
+#include "Zlib/zlib.h"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace Engine
+{
+    // Deflate can't shrink data by more than about 1032:1, a larger inflated size is a corrupt entry
+    static constexpr uint64_t kMaxDeflateRatio = 1032;
+
+    SoundBank::SoundBank()
+        : m_Entries(nullptr)
+        , m_EntryCount(0)
+    {
+    }
+
+    bool SoundBank::Open(const char* filepath)
+    {
+        auto file = std::make_shared<MappedFile>();
+        if (!file->Open(filepath))
+        {
+            printf("Error: Failed to open sound bank '%s'\n", filepath);
+            return false;
+        }
+
+        SoundBankHeader header;
+        if (file->GetSize() < sizeof(header))
+        {
+            printf("Error: '%s' is not a valid sound bank\n", filepath);
+            return false;
+        }
+
+        std::memcpy(&header, file->GetData(), sizeof(header));
+        if (std::memcmp(header.magic, kSoundBankMagic, sizeof(kSoundBankMagic)) != 0 || header.version != kSoundBankVersion ||
+            header.entryCount > (file->GetSize() - sizeof(header)) / sizeof(SoundBankEntry))
+        {
+            printf("Error: '%s' is not a valid sound bank\n", filepath);
+            return false;
+        }
+
+        // Check every entry once here so lookups can trust the table
+        const SoundBankEntry* entries = reinterpret_cast<const SoundBankEntry*>(file->GetData() + sizeof(header));
+        for (uint32_t i = 0; i < header.entryCount; ++i)
+        {
+            const SoundBankEntry& entry = entries[i];
+            bool pathFits = entry.pathOffset <= file->GetSize() && entry.pathLength <= file->GetSize() - entry.pathOffset;
+            bool dataFits = entry.dataOffset <= file->GetSize() && entry.storedSize <= file->GetSize() - entry.dataOffset;
+            bool sorted = i == 0 || entries[i - 1].pathHash <= entry.pathHash;
+
+            // Read allocates the inflated size up front and zlib takes 32-bit sizes on Windows
+            bool sizeFits = !(entry.flags & kCompressed) ||
+                (entry.storedSize <= ULONG_MAX && entry.size <= ULONG_MAX && entry.size <= entry.storedSize * kMaxDeflateRatio);
+            if (!pathFits || !dataFits || !sorted || !sizeFits)
+            {
+                printf("Error: Sound bank '%s' has a corrupt table of contents\n", filepath);
+                return false;
+            }
+        }
+
+        m_Entries = entries;
+        m_EntryCount = header.entryCount;
+        m_File = std::move(file);
+        return true;
+    }
+
+    const SoundBankEntry* SoundBank::Find(std::string_view path) const
+    {
+        if (!m_File) return nullptr;
+
+        // Banks store '/' separators
+        std::string normalized;
+        if (path.find('\\') != std::string_view::npos)
+        {
+            normalized.assign(path.data(), path.size());
+            std::replace(normalized.begin(), normalized.end(), '\\', '/');
+            path = normalized;
+        }
+
+        uint32_t hash = HashAudioPath(path);
+        const SoundBankEntry* end = m_Entries + m_EntryCount;
+        const SoundBankEntry* it = std::lower_bound(m_Entries, end, hash,
+            [](const SoundBankEntry& entry, uint32_t value) { return entry.pathHash < value; });
+
+        for (; it != end && it->pathHash == hash; ++it)
+        {
+            std::string_view entryPath(reinterpret_cast<const char*>(m_File->GetData() + it->pathOffset), it->pathLength);
+            if (entryPath == path)
+            {
+                return it;
+            }
+        }
+        return nullptr;
+    }
+
+    bool SoundBank::Read(std::string_view path, EncodedAudio& out) const
+    {
+        const SoundBankEntry* entry = Find(path);
+        if (!entry) return false;
+
+        const uint8_t* stored = m_File->GetData() + entry->dataOffset;
+        if (!(entry->flags & kCompressed))
+        {
+            // Used in place, the bank's mapping stays alive as long as anything points into it
+            out.owner = m_File;
+            out.data = stored;
+            out.size = static_cast<size_t>(entry->storedSize);
+            return true;
+        }
+
+        auto inflated = std::make_shared<std::vector<uint8_t>>(static_cast<size_t>(entry->size));
+        uLongf inflatedSize = static_cast<uLongf>(entry->size);
+        if (uncompress(inflated->data(), &inflatedSize, stored, static_cast<uLong>(entry->storedSize)) != Z_OK ||
+            inflatedSize != entry->size)
+        {
+            printf("Error: Failed to inflate '%.*s' from its sound bank\n", static_cast<int>(path.size()), path.data());
+            return false;
+        }
+
+        out.data = inflated->data();
+        out.size = inflated->size();
+        out.owner = std::move(inflated);
+        return true;
+    }
+}
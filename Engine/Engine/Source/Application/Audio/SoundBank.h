@@ -0,0 +1,79 @@
+﻿// © 2025 Yanan Liu <yanan.liu0325@gmail.com>
+
+#pragma once
+
+#include "AudioDecoder.h"
+#include "../../Utility/MappedFile.h"
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+namespace Engine
+{
+    // Sound bank (.cbank) layout, written by AudioBake --bank:
+    //     SoundBankHeader
+    //     SoundBankEntry[entryCount]   sorted by pathHash
+    //     path strings                 '/' separated, not null terminated
+    //     entry data                   each entry starts on a kSoundBankAlignment boundary
+    // An entry holds a whole audio file (WAV/MP3/FLAC/OGG/cooked), optionally zlib-compressed
+    static constexpr char kSoundBankMagic[4] = { 'C', 'B', 'N', 'K' };
+    static constexpr uint32_t kSoundBankVersion = 1;
+    static constexpr uint32_t kSoundBankAlignment = 64;
+
+    struct SoundBankHeader
+    {
+        char magic[4];          // kSoundBankMagic
+        uint32_t version;       // kSoundBankVersion
+        uint32_t entryCount;
+        uint32_t reserved;
+    };
+
+    struct SoundBankEntry
+    {
+        uint32_t pathHash;      // HashAudioPath of the path
+        uint32_t pathOffset;    // From the start of the bank
+        uint32_t pathLength;
+        uint32_t flags;         // kCompressed
+        uint64_t dataOffset;    // From the start of the bank
+        uint64_t storedSize;    // Bytes in the bank
+        uint64_t size;          // Bytes once inflated
+    };
+
+    // A mounted bank. One mapping for the whole bank, sounds are found through the table of contents
+    // instead of the filesystem. Read-only once opened, so any thread can read from it
+    class SoundBank
+    {
+    public:
+        // Entry flags
+        static constexpr uint32_t kCompressed = 1u << 0;
+
+        // Default constructor
+        SoundBank();
+
+        SoundBank(const SoundBank&) = delete;
+        SoundBank& operator=(const SoundBank&) = delete;
+
+        // Map the bank and validate its table of contents
+        bool Open(const char* filepath);
+
+        // Hand out the file stored under the path, inflating it if needed. Returns false if the bank doesn't have it
+        bool Read(std::string_view path, EncodedAudio& out) const;
+
+        bool Contains(std::string_view path) const { return Find(path) != nullptr; }
+
+    public:
+        // --------------------------------------------------------------------- //
+        // Accessors
+        // --------------------------------------------------------------------- //
+        uint32_t GetEntryCount() const { return m_EntryCount; }
+
+    private:
+        // Binary search the table of contents by hash, then compare paths
+        const SoundBankEntry* Find(std::string_view path) const;
+
+    private:
+        std::shared_ptr<MappedFile> m_File;
+        const SoundBankEntry* m_Entries;
+        uint32_t m_EntryCount;
+    };
+}
@@ -0,0 +1,47 @@
+﻿// © 2025 Yanan Liu <yanan.liu0325@gmail.com>
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace Engine
+{
+	// 32-bit FNV-1a of an audio path, also used as the path's audio key
+	constexpr uint32_t HashAudioPath(std::string_view path) {
+		uint32_t hash = 2166136261u;
+		for (char c : path) {
+			hash ^= static_cast<uint8_t>(c);
+			hash *= 16777619u;
+		}
+		return hash;
+	}
+
+	// Sound identifier hashed at compile time. Build it from a string literal so the path outlives the id:
+	//     static constexpr SoundId kFootstep("Assets/sfx/footstep.wav");
+	//     audio->PlaySoundEffect(kFootstep);
+	class SoundId
+	{
+	public:
+		constexpr SoundId() : m_Path(), m_Hash(0) {}
+		constexpr explicit SoundId(std::string_view path) : m_Path(path), m_Hash(HashAudioPath(path)) {}
+
+		constexpr uint32_t GetHash() const { return m_Hash; }
+		constexpr std::string_view GetPath() const { return m_Path; }
+		constexpr bool IsValid() const { return !m_Path.empty(); }
+
+		constexpr bool operator==(const SoundId& other) const { return m_Hash == other.m_Hash && m_Path == other.m_Path; }
+		constexpr bool operator!=(const SoundId& other) const { return !(*this == other); }
+
+	private:
+		// Path the id was built from, only read the first time the sound is played
+		std::string_view m_Path;
+		uint32_t m_Hash;
+	};
+
+	// "Assets/sfx/footstep.wav"_sound
+	constexpr SoundId operator""_sound(const char* path, size_t length) {
+		return SoundId(std::string_view(path, length));
+	}
+}
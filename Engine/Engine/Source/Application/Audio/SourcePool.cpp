@@ -0,0 +1,223 @@
+﻿// © 2025 Yanan Liu <yanan.liu0325@gmail.com>
+
+#include "SourcePool.h"
+#include "AudioStatsRecorder.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace Engine
+{
+    SourcePool::SourcePool(AudioStatsRecorder& stats)
+        : m_Recorder(stats)
+    {
+    }
+
+    SourcePool::~SourcePool()
+    {
+        Shutdown();
+    }
+
+    uint32_t SourcePool::Init(uint32_t capacity)
+    {
+        Shutdown();
+
+        m_Slots.reserve(capacity);
+        m_FreeSlots.reserve(capacity);
+        m_SlotOf.reserve(capacity);
+
+        // One at a time: a batched alGenSources fails entirely when the device has fewer voices than asked for
+        for (uint32_t i = 0; i < capacity; ++i)
+        {
+            ALuint source = 0;
+            alGenSources(1, &source);
+            if (m_Recorder.TakeALError() != AL_NO_ERROR || source == 0)
+            {
+                m_Recorder.RecordFailedSourceGen();
+                break;
+            }
+
+            alSource3f(source, AL_POSITION, 0.0f, 0.0f, 0.0f);
+            alSource3f(source, AL_VELOCITY, 0.0f, 0.0f, 0.0f);
+            alSource3f(source, AL_DIRECTION, 0.0f, 0.0f, 0.0f);
+            alSourcef(source, AL_PITCH, 1.0f);
+            alSourcef(source, AL_GAIN, 1.0f);
+            alSourcei(source, AL_LOOPING, AL_FALSE);
+
+            Slot slot;
+            slot.source = source;
+            m_SlotOf[source] = static_cast<uint32_t>(m_Slots.size());
+            m_Slots.push_back(slot);
+        }
+
+        // Hand out the lowest ids first
+        for (uint32_t i = static_cast<uint32_t>(m_Slots.size()); i > 0; --i)
+        {
+            m_FreeSlots.push_back(i - 1);
+        }
+
+        m_Stats = Stats();
+        m_Stats.capacity = static_cast<uint32_t>(m_Slots.size());
+
+        if (m_Stats.capacity < capacity)
+        {
+            printf("Warning: Audio device only provided %u of %u requested sources.\n", m_Stats.capacity, capacity);
+        }
+        return m_Stats.capacity;
+    }
+
+    void SourcePool::Shutdown()
+    {
+        for (Slot& slot : m_Slots)
+        {
+            alSourceStop(slot.source);
+            alDeleteSources(1, &slot.source);
+        }
+
+        m_Slots.clear();
+        m_FreeSlots.clear();
+        m_SlotOf.clear();
+        m_Stats = Stats();
+    }
+
+    ALuint SourcePool::Acquire()
+    {
+        if (m_FreeSlots.empty())
+        {
+            ++m_Stats.exhausted;
+            return 0;
+        }
+
+        Slot& slot = m_Slots[m_FreeSlots.back()];
+        m_FreeSlots.pop_back();
+
+        ResetSlot(slot);
+        slot.leased = true;
+
+        ++m_Stats.leases;
+        ++m_Stats.inUse;
+        m_Stats.peakInUse = std::max(m_Stats.peakInUse, m_Stats.inUse);
+        return slot.source;
+    }
+
+    void SourcePool::Release(ALuint source)
+    {
+        auto it = m_SlotOf.find(source);
+        if (it == m_SlotOf.end() || !m_Slots[it->second].leased)
+        {
+            return;
+        }
+
+        // The buffer has to be detached, otherwise it can't be deleted while the source sits in the pool
+        alSourceStop(source);
+        alSourcei(source, AL_BUFFER, 0);
+
+        m_Slots[it->second].leased = false;
+        m_FreeSlots.push_back(it->second);
+        --m_Stats.inUse;
+    }
+
+    void SourcePool::ReleaseAll(const std::vector<ALuint>& sources)
+    {
+        if (sources.empty()) return;
+
+        // One call stops them all, the buffers still have to be detached one by one
+        alSourceStopv(static_cast<ALsizei>(sources.size()), sources.data());
+        for (ALuint source : sources)
+        {
+            auto it = m_SlotOf.find(source);
+            if (it == m_SlotOf.end() || !m_Slots[it->second].leased) continue;
+
+            alSourcei(source, AL_BUFFER, 0);
+            m_Slots[it->second].leased = false;
+            m_FreeSlots.push_back(it->second);
+            --m_Stats.inUse;
+        }
+    }
+
+    void SourcePool::ResetSlot(Slot& slot)
+    {
+        if (slot.gain != 1.0f)
+        {
+            alSourcef(slot.source, AL_GAIN, 1.0f);
+            slot.gain = 1.0f;
+        }
+        if (slot.pitch != 1.0f)
+        {
+            alSourcef(slot.source, AL_PITCH, 1.0f);
+            slot.pitch = 1.0f;
+        }
+        if (slot.looping)
+        {
+            alSourcei(slot.source, AL_LOOPING, AL_FALSE);
+            slot.looping = false;
+        }
+        if (slot.position[0] != 0.0f || slot.position[1] != 0.0f || slot.position[2] != 0.0f)
+        {
+            alSource3f(slot.source, AL_POSITION, 0.0f, 0.0f, 0.0f);
+            std::fill(std::begin(slot.position), std::end(slot.position), 0.0f);
+        }
+    }
+
+    SourcePool::Slot* SourcePool::FindSlot(ALuint source)
+    {
+        auto it = m_SlotOf.find(source);
+        return it != m_SlotOf.end() ? &m_Slots[it->second] : nullptr;
+    }
+
+    const SourcePool::Slot* SourcePool::FindSlot(ALuint source) const
+    {
+        auto it = m_SlotOf.find(source);
+        return it != m_SlotOf.end() ? &m_Slots[it->second] : nullptr;
+    }
+
+    void SourcePool::SetGain(ALuint source, float gain)
+    {
+        Slot* slot = FindSlot(source);
+        if (slot && slot->gain == gain) return;
+
+        alSourcef(source, AL_GAIN, gain);
+        if (slot) slot->gain = gain;
+    }
+
+    void SourcePool::SetPitch(ALuint source, float pitch)
+    {
+        Slot* slot = FindSlot(source);
+        if (slot && slot->pitch == pitch) return;
+
+        alSourcef(source, AL_PITCH, pitch);
+        if (slot) slot->pitch = pitch;
+    }
+
+    void SourcePool::SetLooping(ALuint source, bool looping)
+    {
+        Slot* slot = FindSlot(source);
+        if (slot && slot->looping == looping) return;
+
+        alSourcei(source, AL_LOOPING, looping ? AL_TRUE : AL_FALSE);
+        if (slot) slot->looping = looping;
+    }
+
+    void SourcePool::SetPosition(ALuint source, float x, float y, float z)
+    {
+        Slot* slot = FindSlot(source);
+        if (slot && slot->position[0] == x && slot->position[1] == y && slot->position[2] == z) return;
+
+        alSource3f(source, AL_POSITION, x, y, z);
+        if (slot)
+        {
+            slot->position[0] = x;
+            slot->position[1] = y;
+            slot->position[2] = z;
+        }
+    }
+
+    float SourcePool::GetGain(ALuint source) const
+    {
+        const Slot* slot = FindSlot(source);
+        if (slot) return slot->gain;
+
+        float gain = 0.0f;
+        alGetSourcef(source, AL_GAIN, &gain);
+        return gain;
+    }
+}
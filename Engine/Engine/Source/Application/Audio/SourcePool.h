@@ -0,0 +1,108 @@
+﻿// © 2025 Yanan Liu <yanan.liu0325@gmail.com>
+
+#pragma once
+
+#include "AL/al.h"
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+
+namespace Engine
+{
+    class AudioStatsRecorder;
+
+    // Fixed set of OpenAL sources generated once and leased to voices, so triggering a sound never
+    // creates or deletes driver objects. Properties are shadowed so a recycled source is only reset
+    // for what the previous voice actually changed
+    class SourcePool
+    {
+    public:
+        // Occupancy counters
+        struct Stats
+        {
+            uint32_t capacity = 0;     // Sources owned by the pool
+            uint32_t inUse = 0;        // Sources currently leased
+            uint32_t peakInUse = 0;    // Highest inUse since Init
+            uint64_t leases = 0;       // Successful Acquire calls
+            uint64_t exhausted = 0;    // Acquire calls that found no free source
+        };
+
+        // Failed source generations and AL errors are counted on stats
+        explicit SourcePool(AudioStatsRecorder& stats);
+
+        // Default destructor
+        ~SourcePool();
+
+        SourcePool(const SourcePool&) = delete;
+        SourcePool& operator=(const SourcePool&) = delete;
+
+        // Generate up to capacity sources, stops early if the device runs out of voices. Returns the number created
+        uint32_t Init(uint32_t capacity);
+
+        // Delete every source
+        void Shutdown();
+
+        // Lease a source with default properties, 0 if every source is in use
+        ALuint Acquire();
+
+        // Stop the source, detach its buffer and return it to the pool
+        void Release(ALuint source);
+
+        // Release many sources with a single stop call
+        void ReleaseAll(const std::vector<ALuint>& sources);
+
+        // Property setters skipping the AL call when the value doesn't change.
+        // Sources the pool doesn't own are forwarded to OpenAL unconditionally
+        void SetGain(ALuint source, float gain);
+        void SetPitch(ALuint source, float pitch);
+        void SetLooping(ALuint source, bool looping);
+        void SetPosition(ALuint source, float x, float y, float z);
+
+        // Shadowed gain, no driver round trip. Sources the pool doesn't own are read back from OpenAL
+        float GetGain(ALuint source) const;
+
+        bool Owns(ALuint source) const { return m_SlotOf.find(source) != m_SlotOf.end(); }
+
+        // Dense index of a pooled source in [0, capacity), kInvalidSlot for sources the pool doesn't own
+        static constexpr uint32_t kInvalidSlot = UINT32_MAX;
+        uint32_t GetSlotIndex(ALuint source) const
+        {
+            auto it = m_SlotOf.find(source);
+            return it != m_SlotOf.end() ? it->second : kInvalidSlot;
+        }
+
+        const Stats& GetStats() const { return m_Stats; }
+
+    private:
+        // Last values sent to OpenAL for one source
+        struct Slot
+        {
+            ALuint source = 0;
+            float gain = 1.0f;
+            float pitch = 1.0f;
+            bool looping = false;
+            float position[3] = { 0.0f, 0.0f, 0.0f };
+            bool leased = false;
+        };
+
+        Slot* FindSlot(ALuint source);
+        const Slot* FindSlot(ALuint source) const;
+
+        // Put the properties the previous lease changed back to their defaults
+        void ResetSlot(Slot& slot);
+
+    private:
+        std::vector<Slot> m_Slots;
+
+        // Indices of free slots, used as a stack so recently released (cache-warm) sources go out first
+        std::vector<uint32_t> m_FreeSlots;
+
+        // Source id -> slot index, built once in Init
+        std::unordered_map<ALuint, uint32_t> m_SlotOf;
+
+        Stats m_Stats;
+
+        // Health counters of the audio system owning the pool
+        AudioStatsRecorder& m_Recorder;
+    };
+}
@@ -0,0 +1,497 @@
+﻿// © 2025 Yanan Liu <yanan.liu0325@gmail.com>
+
+#include "VoiceManager.h"
+#include <algorithm>
+#include <cmath>
+
+namespace Engine
+{
+    VoiceManager::VoiceManager(SourcePool& pool)
+        : m_Pool(pool)
+        , m_MaxRealVoices(0)
+        , m_RealVoices(0)
+        , m_ExternalVoices(0)
+        , m_PollCursor(0)
+    {
+    }
+
+    void VoiceManager::SetMaxRealVoices(uint32_t count)
+    {
+        m_MaxRealVoices = count;
+
+        // Demote the weakest voices above the new cap, external voices keep theirs until they end
+        while (m_RealVoices > 0 && m_RealVoices + m_ExternalVoices > m_MaxRealVoices)
+        {
+            MakeVirtual(*FindWeakestReal());
+        }
+        RemoveFinished();
+    }
+
+    uint32_t VoiceManager::GetPausedVoiceCount() const
+    {
+        return static_cast<uint32_t>(std::count_if(m_Voices.begin(), m_Voices.end(),
+            [](const Voice& voice) { return voice.state != EVoiceState::kPlaying; }));
+    }
+
+    bool VoiceManager::Play(uint32_t audioKey, const AudioBufferHandle& buffer, int priority)
+    {
+        Voice voice;
+        voice.audioKey = audioKey;
+        voice.buffer = buffer;
+        voice.source = 0;
+        voice.priority = priority;
+        voice.gain = 1.0f;
+        voice.duration = buffer->duration;
+        voice.position = 0.0f;
+        voice.muted = false;
+        voice.looping = false;
+        voice.finished = false;
+        voice.state = EVoiceState::kPlaying;
+        m_Voices.push_back(std::move(voice));
+
+        Voice& added = m_Voices.back();
+        if (HasFreeSlot() && MakeReal(added))
+        {
+            return true;
+        }
+
+        // Every voice is busy: steal from the weakest if the new one matters more, otherwise start virtual
+        Voice* weakest = FindWeakestReal();
+        if (weakest && Outranks(added, *weakest))
+        {
+            MakeVirtual(*weakest);
+            MakeReal(added);
+            RemoveFinished();
+        }
+        return true;
+    }
+
+    bool VoiceManager::ReserveExternal(int priority)
+    {
+        if (!HasFreeSlot())
+        {
+            // Ranked like a voice played at full gain
+            Voice external = {};
+            external.priority = priority;
+            external.gain = 1.0f;
+
+            Voice* weakest = FindWeakestReal();
+            if (!weakest || !Outranks(external, *weakest))
+            {
+                return false;
+            }
+            MakeVirtual(*weakest);
+            RemoveFinished();
+        }
+
+        ++m_ExternalVoices;
+        return true;
+    }
+
+    void VoiceManager::ReleaseExternal()
+    {
+        if (m_ExternalVoices == 0) return;
+
+        // The freed slot goes to the strongest virtual voice on the next Update
+        --m_ExternalVoices;
+    }
+
+    void VoiceManager::Update(float deltaSeconds)
+    {
+        // Virtual voices play on in silence
+        for (size_t i = 0; i < m_Voices.size();)
+        {
+            Voice& voice = m_Voices[i];
+            if (voice.source == 0 && voice.state == EVoiceState::kPlaying)
+            {
+                voice.position += deltaSeconds;
+                if (voice.position >= voice.duration)
+                {
+                    if (!voice.looping || voice.duration <= 0.0f)
+                    {
+                        RemoveVoice(i);
+                        continue;
+                    }
+                    voice.position = std::fmod(voice.position, voice.duration);
+                }
+            }
+            ++i;
+        }
+
+        Rebalance();
+    }
+
+    void VoiceManager::OnSourceStopped(ALuint source)
+    {
+        uint32_t slot = m_Pool.GetSlotIndex(source);
+        if (slot >= m_VoiceBySlot.size() || m_VoiceBySlot[slot] == SourcePool::kInvalidSlot) return;
+
+        size_t index = m_VoiceBySlot[slot];
+        const Voice& voice = m_Voices[index];
+        if (voice.state != EVoiceState::kPlaying) return;
+
+        // The report may predate the source being leased again, only trust the current state
+        ALint state;
+        alGetSourcei(source, AL_SOURCE_STATE, &state);
+        if (state == AL_STOPPED)
+        {
+            RemoveVoice(index);
+        }
+    }
+
+    void VoiceManager::PollFinished(uint32_t maxPolls)
+    {
+        for (uint32_t polls = 0; polls < maxPolls && !m_Voices.empty(); ++polls)
+        {
+            if (m_PollCursor >= m_Voices.size())
+            {
+                m_PollCursor = 0;
+            }
+
+            const Voice& voice = m_Voices[m_PollCursor];
+            if (voice.source && voice.state == EVoiceState::kPlaying)
+            {
+                ALint state;
+                alGetSourcei(voice.source, AL_SOURCE_STATE, &state);
+                if (state == AL_STOPPED)
+                {
+                    // The last voice moves into this index, check it next
+                    RemoveVoice(m_PollCursor);
+                    continue;
+                }
+            }
+            ++m_PollCursor;
+        }
+    }
+
+    void VoiceManager::Clear()
+    {
+        m_Batch.clear();
+        for (const Voice& voice : m_Voices)
+        {
+            if (voice.source) m_Batch.push_back(voice.source);
+        }
+        m_Pool.ReleaseAll(m_Batch);
+
+        m_Voices.clear();
+        m_VoiceBySlot.assign(m_VoiceBySlot.size(), SourcePool::kInvalidSlot);
+        m_RealVoices = 0;
+        m_PollCursor = 0;
+    }
+
+    void VoiceManager::StopAll()
+    {
+        Clear();
+    }
+
+    void VoiceManager::PauseAll()
+    {
+        m_Batch.clear();
+        for (Voice& voice : m_Voices)
+        {
+            if (voice.state != EVoiceState::kPlaying) continue;
+
+            voice.state = EVoiceState::kPaused;
+            if (voice.source) m_Batch.push_back(voice.source);
+        }
+        SubmitBatch(EBatchOp::kPause);
+    }
+
+    void VoiceManager::ResumeAll()
+    {
+        m_Batch.clear();
+        for (Voice& voice : m_Voices)
+        {
+            if (voice.state == EVoiceState::kPlaying) continue;
+
+            voice.state = EVoiceState::kPlaying;
+            if (voice.source) m_Batch.push_back(voice.source);
+        }
+        SubmitBatch(EBatchOp::kPlay);
+        Rebalance();
+    }
+
+    void VoiceManager::ReplayAll()
+    {
+        m_Batch.clear();
+        for (Voice& voice : m_Voices)
+        {
+            voice.state = EVoiceState::kPlaying;
+            voice.position = 0.0f;
+            voice.finished = false;
+            if (voice.source) m_Batch.push_back(voice.source);
+        }
+        SubmitBatch(EBatchOp::kRewind);
+        SubmitBatch(EBatchOp::kPlay);
+        Rebalance();
+    }
+
+    void VoiceManager::RewindAll()
+    {
+        m_Batch.clear();
+        for (Voice& voice : m_Voices)
+        {
+            voice.state = EVoiceState::kRewound;
+            voice.position = 0.0f;
+            if (voice.source) m_Batch.push_back(voice.source);
+        }
+        SubmitBatch(EBatchOp::kRewind);
+    }
+
+    void VoiceManager::SetMutedAll(bool muted)
+    {
+        for (Voice& voice : m_Voices)
+        {
+            voice.muted = muted;
+            ApplyGain(voice);
+        }
+        Rebalance();
+    }
+
+    void VoiceManager::SetLoopingAll(bool looping)
+    {
+        for (Voice& voice : m_Voices)
+        {
+            voice.looping = looping;
+            if (voice.source) m_Pool.SetLooping(voice.source, looping);
+        }
+    }
+
+    void VoiceManager::AdjustGainAll(float delta)
+    {
+        for (Voice& voice : m_Voices)
+        {
+            voice.gain = std::max(0.0f, std::min(voice.gain + delta, 1.0f));
+            ApplyGain(voice);
+        }
+        Rebalance();
+    }
+
+    void VoiceManager::SetGain(uint32_t audioKey, float gain)
+    {
+        for (Voice& voice : m_Voices)
+        {
+            if (voice.audioKey != audioKey) continue;
+
+            voice.gain = gain;
+            ApplyGain(voice);
+        }
+        Rebalance();
+    }
+
+    float VoiceManager::GetGain(uint32_t audioKey) const
+    {
+        for (const Voice& voice : m_Voices)
+        {
+            if (voice.audioKey == audioKey) return voice.gain;
+        }
+        return -1.0f;
+    }
+
+    void VoiceManager::StopSound(uint32_t audioKey)
+    {
+        for (size_t i = 0; i < m_Voices.size();)
+        {
+            if (m_Voices[i].audioKey == audioKey)
+            {
+                RemoveVoice(i);
+                continue;
+            }
+            ++i;
+        }
+    }
+
+    bool VoiceManager::Outranks(const Voice& a, const Voice& b) const
+    {
+        if (a.priority != b.priority) return a.priority > b.priority;
+        return GetEffectiveGain(a) > GetEffectiveGain(b);
+    }
+
+    bool VoiceManager::MakeReal(Voice& voice)
+    {
+        if (voice.source || !IsAudible(voice)) return voice.source != 0;
+
+        ALuint source = m_Pool.Acquire();
+        if (source == 0) return false;
+
+        alSourcei(source, AL_BUFFER, voice.buffer->buffer);
+        m_Pool.SetGain(source, GetEffectiveGain(voice));
+        m_Pool.SetLooping(source, voice.looping);
+        if (voice.position > 0.0f)
+        {
+            alSourcef(source, AL_SEC_OFFSET, voice.position);
+        }
+        if (voice.state == EVoiceState::kPlaying)
+        {
+            alSourcePlay(source);
+        }
+
+        voice.source = source;
+        BindSlot(source, static_cast<size_t>(&voice - m_Voices.data()));
+        ++m_RealVoices;
+        return true;
+    }
+
+    void VoiceManager::MakeVirtual(Voice& voice)
+    {
+        if (!voice.source) return;
+
+        // A stopped source reads back offset 0, resuming from there would replay a sound that already ended
+        if (voice.state == EVoiceState::kPlaying)
+        {
+            ALint state;
+            alGetSourcei(voice.source, AL_SOURCE_STATE, &state);
+            voice.finished = state == AL_STOPPED;
+        }
+
+        // One readback so the voice resumes where it was when it gets a source again
+        if (!voice.finished)
+        {
+            alGetSourcef(voice.source, AL_SEC_OFFSET, &voice.position);
+        }
+
+        UnbindSlot(voice.source);
+        m_Pool.Release(voice.source);
+        voice.source = 0;
+        --m_RealVoices;
+    }
+
+    void VoiceManager::RemoveVoice(size_t index)
+    {
+        Voice& voice = m_Voices[index];
+        if (voice.source)
+        {
+            UnbindSlot(voice.source);
+            m_Pool.Release(voice.source);
+            --m_RealVoices;
+        }
+
+        // Dropping the voice drops its buffer reference
+        voice = std::move(m_Voices.back());
+        m_Voices.pop_back();
+
+        // The voice moved from the back now lives at index
+        if (index < m_Voices.size() && voice.source)
+        {
+            BindSlot(voice.source, index);
+        }
+    }
+
+    void VoiceManager::RemoveFinished()
+    {
+        for (size_t i = 0; i < m_Voices.size();)
+        {
+            if (m_Voices[i].finished)
+            {
+                RemoveVoice(i);
+                continue;
+            }
+            ++i;
+        }
+    }
+
+    void VoiceManager::BindSlot(ALuint source, size_t voiceIndex)
+    {
+        uint32_t slot = m_Pool.GetSlotIndex(source);
+        if (slot == SourcePool::kInvalidSlot) return;
+
+        if (slot >= m_VoiceBySlot.size())
+        {
+            m_VoiceBySlot.resize(m_Pool.GetStats().capacity, SourcePool::kInvalidSlot);
+        }
+        m_VoiceBySlot[slot] = static_cast<uint32_t>(voiceIndex);
+    }
+
+    void VoiceManager::UnbindSlot(ALuint source)
+    {
+        uint32_t slot = m_Pool.GetSlotIndex(source);
+        if (slot < m_VoiceBySlot.size())
+        {
+            m_VoiceBySlot[slot] = SourcePool::kInvalidSlot;
+        }
+    }
+
+    VoiceManager::Voice* VoiceManager::FindWeakestReal()
+    {
+        Voice* weakest = nullptr;
+        for (Voice& voice : m_Voices)
+        {
+            if (voice.source && (!weakest || Outranks(*weakest, voice)))
+            {
+                weakest = &voice;
+            }
+        }
+        return weakest;
+    }
+
+    VoiceManager::Voice* VoiceManager::FindStrongestVirtual()
+    {
+        Voice* strongest = nullptr;
+        for (Voice& voice : m_Voices)
+        {
+            // Paused voices can wait, they aren't heard either way
+            if (voice.source || voice.state != EVoiceState::kPlaying || voice.finished || !IsAudible(voice)) continue;
+
+            if (!strongest || Outranks(voice, *strongest))
+            {
+                strongest = &voice;
+            }
+        }
+        return strongest;
+    }
+
+    void VoiceManager::Rebalance()
+    {
+        // Voices nobody can hear don't deserve a source
+        for (Voice& voice : m_Voices)
+        {
+            if (voice.source && !IsAudible(voice))
+            {
+                MakeVirtual(voice);
+            }
+        }
+
+        // Every swap strictly improves the set of real voices, the bound is only a safety net
+        for (size_t swaps = 0; swaps < m_Voices.size(); ++swaps)
+        {
+            Voice* strongest = FindStrongestVirtual();
+            if (!strongest) break;
+
+            if (HasFreeSlot() && MakeReal(*strongest)) continue;
+
+            Voice* weakest = FindWeakestReal();
+            if (!weakest || !Outranks(*strongest, *weakest)) break;
+
+            MakeVirtual(*weakest);
+            if (!MakeReal(*strongest)) break;
+        }
+        RemoveFinished();
+    }
+
+    void VoiceManager::SubmitBatch(EBatchOp op)
+    {
+        if (m_Batch.empty()) return;
+
+        ALsizei count = static_cast<ALsizei>(m_Batch.size());
+        switch (op)
+        {
+        case EBatchOp::kPlay:
+            alSourcePlayv(count, m_Batch.data());
+            break;
+        case EBatchOp::kPause:
+            alSourcePausev(count, m_Batch.data());
+            break;
+        case EBatchOp::kRewind:
+            alSourceRewindv(count, m_Batch.data());
+            break;
+        }
+    }
+
+    void VoiceManager::ApplyGain(Voice& voice)
+    {
+        if (voice.source)
+        {
+            m_Pool.SetGain(voice.source, GetEffectiveGain(voice));
+        }
+    }
+}
@@ -0,0 +1,162 @@
+﻿// © 2025 Yanan Liu <yanan.liu0325@gmail.com>
+
+#pragma once
+
+#include "SourcePool.h"
+#include "AudioBuffer.h"
+#include "AL/al.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Engine
+{
+    // Sound effect voices with priorities and a cap on how many are actually mixed.
+    // A voice only holds an OpenAL source while it is "real"; inaudible or outranked voices are
+    // "virtual": their playback position keeps advancing but nothing is mixed, and they get a
+    // source back as soon as one frees up or they outrank a real voice
+    class VoiceManager
+    {
+    public:
+        // Gain at or below which a voice is considered inaudible and isn't worth a source
+        static constexpr float kInaudibleGain = 0.001f;
+
+        // Default constructor
+        explicit VoiceManager(SourcePool& pool);
+
+        VoiceManager(const VoiceManager&) = delete;
+        VoiceManager& operator=(const VoiceManager&) = delete;
+
+        // Start a voice for the buffer, which the voice keeps alive until it ends. Returns false only if the voice was dropped outright
+        bool Play(uint32_t audioKey, const AudioBufferHandle& buffer, int priority);
+
+        // Count a voice playing outside the manager on its own pooled source (a progressive voice) against the cap.
+        // Takes the place of the weakest real voice when every slot is used and it ranks lower, returns false
+        // if every real voice matters more. Such voices can't be made virtual, they keep their slot until released
+        bool ReserveExternal(int priority);
+        void ReleaseExternal();
+
+        // Advance virtual voices, reclaim finished ones and hand free sources to the most important voices
+        void Update(float deltaSeconds);
+
+        // Reclaim the voice playing on a source OpenAL reported as stopped. Stale reports are ignored
+        void OnSourceStopped(ALuint source);
+
+        // Fallback when OpenAL can't report stopped sources: check at most maxPolls real voices,
+        // continuing where the previous call stopped
+        void PollFinished(uint32_t maxPolls);
+
+        // Release every voice, real or virtual
+        void Clear();
+
+        // Operations applied to every voice
+        void StopAll();
+        void PauseAll();
+        void ResumeAll();
+        void ReplayAll();
+        void RewindAll();
+        void SetMutedAll(bool muted);
+        void SetLoopingAll(bool looping);
+        void AdjustGainAll(float delta);
+
+        // Operations on the voices of one sound
+        void SetGain(uint32_t audioKey, float gain);
+        float GetGain(uint32_t audioKey) const;    // -1 if the sound has no voice
+        void StopSound(uint32_t audioKey);
+
+    public:
+        // --------------------------------------------------------------------- //
+        // Accessors & Mutators
+        // --------------------------------------------------------------------- //
+        void SetMaxRealVoices(uint32_t count);
+        uint32_t GetMaxRealVoices() const { return m_MaxRealVoices; }
+        uint32_t GetRealVoiceCount() const { return m_RealVoices; }
+        uint32_t GetExternalVoiceCount() const { return m_ExternalVoices; }
+        uint32_t GetVirtualVoiceCount() const { return static_cast<uint32_t>(m_Voices.size()) - m_RealVoices; }
+        uint32_t GetPausedVoiceCount() const;
+
+    private:
+        enum class EVoiceState
+        {
+            kPlaying,   // Advancing, mixed if real
+            kPaused,    // Holding its position
+            kRewound    // Holding at the beginning until resumed
+        };
+
+        struct Voice
+        {
+            uint32_t audioKey;
+            AudioBufferHandle buffer;
+            ALuint source;      // 0 while virtual
+            int priority;
+            float gain;
+            float duration;     // Seconds of audio in the buffer
+            float position;     // Seconds, only tracked here while virtual
+            bool muted;
+            bool looping;
+            bool finished;      // Its source stopped before it was reclaimed, removed by RemoveFinished
+            EVoiceState state;
+        };
+
+        float GetEffectiveGain(const Voice& voice) const { return voice.muted ? 0.0f : voice.gain; }
+        bool IsAudible(const Voice& voice) const { return GetEffectiveGain(voice) > kInaudibleGain; }
+
+        // True if a should get a source before b
+        bool Outranks(const Voice& a, const Voice& b) const;
+
+        // Lease a source and continue the voice from its tracked position
+        bool MakeReal(Voice& voice);
+
+        // Remember the voice's position and give its source back. A voice whose source already played out
+        // is marked finished instead, it has no position to resume from
+        void MakeVirtual(Voice& voice);
+
+        // Release the voice and swap-remove it
+        void RemoveVoice(size_t index);
+
+        // Remove the voices MakeVirtual found finished, once no Voice pointer is held
+        void RemoveFinished();
+
+        // Keep m_VoiceBySlot pointing at the voice using the source
+        void BindSlot(ALuint source, size_t voiceIndex);
+        void UnbindSlot(ALuint source);
+
+        Voice* FindWeakestReal();
+        Voice* FindStrongestVirtual();
+
+        // Demote inaudible voices and promote or swap in the strongest virtual ones
+        void Rebalance();
+
+        // Push the voice's gain to its source
+        void ApplyGain(Voice& voice);
+
+        // True while another voice can get a source without going over the cap
+        bool HasFreeSlot() const { return m_RealVoices + m_ExternalVoices < m_MaxRealVoices; }
+
+        enum class EBatchOp
+        {
+            kPlay,
+            kPause,
+            kRewind
+        };
+
+        // Issue one vector call for every source gathered in m_Batch
+        void SubmitBatch(EBatchOp op);
+
+    private:
+        SourcePool& m_Pool;
+        std::vector<Voice> m_Voices;
+        uint32_t m_MaxRealVoices;
+        uint32_t m_RealVoices;
+        uint32_t m_ExternalVoices;    // Reserved by ReserveExternal, included in the cap
+
+        // Pool slot -> index of the voice holding that source, so a stopped source is found in O(1)
+        std::vector<uint32_t> m_VoiceBySlot;
+
+        // Where the next PollFinished call starts
+        size_t m_PollCursor;
+
+        // Contiguous sound effect sources gathered for one alSource*v call, reused between calls
+        std::vector<ALuint> m_Batch;
+    };
+}
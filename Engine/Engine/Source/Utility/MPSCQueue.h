@@ -0,0 +1,102 @@
+﻿// © 2025 Yanan Liu <yanan.liu0325@gmail.com>
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace Engine
+{
+	// Bounded lock-free queue: any number of threads push, one thread pops.
+	// Producers never block or take a lock, a push into a full queue fails instead.
+	// Each cell carries a sequence number telling whether it is free, written, or being written (D. Vyukov's ring)
+	template <typename T>
+	class MPSCQueue
+	{
+	public:
+		// Capacity is rounded up to a power of two
+		explicit MPSCQueue(size_t capacity)
+		{
+			size_t size = 2;
+			while (size < capacity) {
+				size <<= 1;
+			}
+
+			m_Cells.reset(new Cell[size]);
+			m_Mask = size - 1;
+			for (size_t i = 0; i < size; ++i) {
+				m_Cells[i].sequence.store(i, std::memory_order_relaxed);
+			}
+			m_EnqueuePos.store(0, std::memory_order_relaxed);
+			m_DequeuePos = 0;
+		}
+
+		MPSCQueue(const MPSCQueue&) = delete;
+		MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+		// Safe from any thread, returns false if the queue is full
+		bool TryPush(const T& value) {
+			size_t pos = m_EnqueuePos.load(std::memory_order_relaxed);
+			Cell* cell;
+			for (;;) {
+				cell = &m_Cells[pos & m_Mask];
+				size_t sequence = cell->sequence.load(std::memory_order_acquire);
+				intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+				if (diff == 0) {
+					// The cell is free, claim it
+					if (m_EnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+						break;
+					}
+				}
+				else if (diff < 0) {
+					// The consumer hasn't freed this cell yet
+					return false;
+				}
+				else {
+					// Another producer claimed it first
+					pos = m_EnqueuePos.load(std::memory_order_relaxed);
+				}
+			}
+
+			cell->value = value;
+			cell->sequence.store(pos + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Consumer thread only, returns false if nothing is ready
+		bool TryPop(T& out) {
+			Cell& cell = m_Cells[m_DequeuePos & m_Mask];
+			size_t sequence = cell.sequence.load(std::memory_order_acquire);
+			if (static_cast<intptr_t>(sequence) - static_cast<intptr_t>(m_DequeuePos + 1) < 0) {
+				return false;
+			}
+
+			out = cell.value;
+
+			// Hand the cell back to producers one lap later
+			cell.sequence.store(m_DequeuePos + m_Mask + 1, std::memory_order_release);
+			++m_DequeuePos;
+			return true;
+		}
+
+		size_t Capacity() const {
+			return m_Mask + 1;
+		}
+
+	private:
+		struct Cell
+		{
+			std::atomic<size_t> sequence;
+			T value;
+		};
+
+		std::unique_ptr<Cell[]> m_Cells;
+		size_t m_Mask;
+
+		// Producers and the consumer work on separate cache lines
+		alignas(64) std::atomic<size_t> m_EnqueuePos;
+		alignas(64) size_t m_DequeuePos;
+	};
+}
@@ -0,0 +1,48 @@
+﻿// © 2025 Yanan Liu <yanan.liu0325@gmail.com>
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Engine
+{
+    // Read-only view of a whole file mapped into memory. Pages are loaded by the OS on first
+    // touch, so reading it costs no read calls and no copy into a user buffer
+    class MappedFile
+    {
+    public:
+        // Default constructor
+        MappedFile();
+
+        // Default destructor
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        // Map the file under the filepath, returns false if it can't be opened or is empty
+        bool Open(const char* filepath);
+
+        // Unmap the file, pointers into it become invalid
+        void Close();
+
+    public:
+        // --------------------------------------------------------------------- //
+        // Accessors
+        // --------------------------------------------------------------------- //
+        bool IsOpen() const { return m_Data != nullptr; }
+        const uint8_t* GetData() const { return m_Data; }
+        size_t GetSize() const { return m_Size; }
+
+    private:
+        const uint8_t* m_Data;
+        size_t m_Size;
+
+#ifdef _WIN32
+        // File and mapping handles, kept until the view is unmapped
+        void* m_File;
+        void* m_Mapping;
+#endif
+    };
+}